@@ -0,0 +1,49 @@
+#ifndef _COB_READ_TEXT_BEZIER_CURVE_
+#define _COB_READ_TEXT_BEZIER_CURVE_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Different includes
+#include <utility>
+#include <vector>
+
+// Quadratic Bézier curve C(t) = A*t² + B*t + D with the coefficients of the 2x3 curve matrices of DetectText:
+// coefficients[0] = (A.x, B.x, D.x), coefficients[1] = (A.y, B.y, D.y)
+// Kept in a plain struct, so the RANSAC of DetectText can create and evaluate many curves without allocating memory.
+struct BezierCurve
+{
+  BezierCurve();
+
+  // 2x3 CV_32FC1 curve matrix
+  explicit BezierCurve(const cv::Mat& curve);
+
+  // curve through the 3 points, same as DetectText::createBezierCurve: the points are reordered so that points[0] and
+  // points[2] are the ends of the curve and points[0].x <= points[2].x
+  // returns false if there are not exactly 3 points
+  bool fit(std::vector<cv::Point>& points);
+
+  // 2x3 CV_32FC1 curve matrix
+  cv::Mat toMat() const;
+
+  // distance from Q to the curve and t of the nearest point C(t), same as DetectText::getBezierDistance
+  std::pair<float, float> distance(cv::Point Q) const;
+
+  // point C(t)
+  cv::Point2f point(float t) const
+  {
+    return cv::Point2f(coefficients[0][0] * t * t + coefficients[0][1] * t + coefficients[0][2],
+                       coefficients[1][0] * t * t + coefficients[1][1] * t + coefficients[1][2]);
+  }
+
+  // arc length of the curve from C(mint) to C(maxt)
+  float length(float mint, float maxt) const;
+
+  // Sampling grid (CV_32FC2, map of cv::remap) that straightens the band around the curve from C(mint) on:
+  // column x lies at arc length x along the curve, row y at distance size.height/2 - y along the normal of that curve point.
+  void rectificationGrid(float mint, float maxt, cv::Size size, cv::Mat& grid) const;
+
+  float coefficients[2][3];
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _COB_READ_TEXT_BUFFER_ARENA_
+#define _COB_READ_TEXT_BUFFER_ARENA_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Different includes
+#include <algorithm>
+
+// Working images of DetectText that are kept over several detect() calls.
+// A buffer only grows (or is reallocated when its type changes), so a stream of camera images or the differently sized
+// regions of interest of one image are processed without allocating the working memory for every frame or region.
+// Every buffer has its own slot, so the font color passes may request their buffers concurrently.
+// A copied arena is empty: copies of DetectText (e.g. one per worker thread) never share their working memory.
+class BufferArena
+{
+public:
+  enum Buffer
+  {
+    GRAY_IMAGE = 0,
+    RESULT_IMAGE,
+    EDGE_MAP,
+    GRADIENT_X,
+    GRADIENT_Y,
+    COLOR_INTEGRAL,
+    GRAY_INTEGRAL,
+    SWT_BRIGHT,
+    SWT_DARK,
+    CCMAP_BRIGHT,
+    CCMAP_DARK,
+    CC_PARENT_BRIGHT, // union-find parents of the connected component labelling
+    CC_PARENT_DARK,
+    CCMAP_FRAME_BRIGHT, // whole image cc maps, assembled from the cc maps of the regions of interest
+    CCMAP_FRAME_DARK,
+    NUMBER_BUFFERS
+  };
+
+  BufferArena()
+  {
+  }
+
+  BufferArena(const BufferArena&)
+  {
+  }
+
+  BufferArena& operator=(const BufferArena&)
+  {
+    return *this;
+  }
+
+  // continuous buffer with the given size and type, the content is undefined
+  // Results that refer to a buffer are overwritten by the next detect() call (or the next region of interest).
+  cv::Mat& get(Buffer buffer, cv::Size size, int type)
+  {
+    int area = size.area();
+    if (storage_[buffer].type() != type || storage_[buffer].cols < area)
+      storage_[buffer].create(1, std::max(area, 1), type);
+    buffers_[buffer] = storage_[buffer].colRange(0, area).reshape(0, size.height);
+    return buffers_[buffer];
+  }
+
+private:
+  cv::Mat storage_[NUMBER_BUFFERS]; // one row of at least the largest requested area
+  cv::Mat buffers_[NUMBER_BUFFERS]; // the requested size, a view of storage_
+};
+
+#endif
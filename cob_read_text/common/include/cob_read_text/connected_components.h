@@ -0,0 +1,74 @@
+#ifndef _COB_READ_TEXT_CONNECTED_COMPONENTS_
+#define _COB_READ_TEXT_CONNECTED_COMPONENTS_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Different includes
+#include <vector>
+
+// Statistics of one connected component, gathered while labelling
+struct ComponentStatistics
+{
+  ComponentStatistics() :
+    minX(0x7fffffff), minY(0x7fffffff), maxX(-1), maxY(-1), pixelCount(0), strokeWidthSum(0.), strokeWidthSquareSum(0.), strokeWidthMax(0.f), graySum(0.)
+  {
+    colorSum[0] = colorSum[1] = colorSum[2] = 0.;
+  }
+
+  cv::Rect boundingBox() const
+  {
+    return cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+  }
+
+  int minX, minY, maxX, maxY; // bounding box, inclusive
+  int pixelCount;
+  double strokeWidthSum;
+  double strokeWidthSquareSum; // variance of the stroke width = strokeWidthSquareSum / pixelCount - mean²
+  float strokeWidthMax;
+  double colorSum[3]; // sum of b, g, r values of all component pixels
+  double graySum; // sum of gray values of all component pixels
+};
+
+// Connected component labelling of a stroke width map with union-find.
+// Two neighboring pixels (8-neighborhood) belong together if their stroke widths are similar:
+// max(sw1, sw2) <= swCompareParameter * min(sw1, sw2), or if the ratio is below 1.5 * swCompareParameter
+// and the mean intensity and color of their 3x3 neighborhoods differ less than colorCompareParameter.
+// The first pass runs in parallel on bands of rows, the bands are joined afterwards.
+class ConnectedComponentLabeling
+{
+public:
+  ConnectedComponentLabeling(double swCompareParameter, int colorCompareParameter);
+
+  // swtmap: CV_32FC1 or compact CV_16UC1 stroke width map of StrokeWidthTransform (0 = no stroke), image: CV_8UC3 (BGR), grayImage: CV_8UC1
+  // labels: CV_32SC1, -2 = no component, 0..n-1 = components in raster order of their first pixel
+  // statistics[i]: statistics of component i
+  // strokeWidths[strokeWidthOffsets[i] .. strokeWidthOffsets[i+1]-1]: stroke widths of all pixels of component i (raster order)
+  // parents: CV_32SC1 working buffer of the union-find, (re)allocated to the size of swtmap if necessary
+  // returns n, components consisting of a single pixel are discarded
+  int label(const cv::Mat& swtmap, const cv::Mat& image, const cv::Mat& grayImage, int numberThreads, cv::Mat& labels,
+            std::vector<ComponentStatistics>& statistics, std::vector<float>& strokeWidths, std::vector<int>& strokeWidthOffsets,
+            cv::Mat& parents) const;
+
+private:
+  // T: element type of swtmap (float or unsigned short)
+  template <typename T>
+  int labelMap(const cv::Mat& swtmap, const cv::Mat& image, const cv::Mat& grayImage, int numberThreads, cv::Mat& labels,
+               std::vector<ComponentStatistics>& statistics, std::vector<float>& strokeWidths, std::vector<int>& strokeWidthOffsets,
+               cv::Mat& parents) const;
+
+  // first pass: union of similar neighbors within the rows [rowStart, rowEnd)
+  template <typename T>
+  void labelBand(const cv::Mat& swtmap, const cv::Mat& image, const cv::Mat& grayImage, int* parent, int rowStart, int rowEnd) const;
+
+  // whether the neighboring pixels (x1,y1) and (x2,y2) with stroke widths sw1, sw2 > 0 belong to the same component
+  bool similar(const cv::Mat& image, const cv::Mat& grayImage, float sw1, float sw2, int x1, int y1, int x2, int y2) const;
+
+  // mean gray value and b, g, r values of the 3x3 neighborhood of (x,y)
+  void localMean(const cv::Mat& image, const cv::Mat& grayImage, int x, int y, double* mean) const;
+
+  double swCompareParameter_;
+  int colorCompareParameter_;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef _COB_READ_TEXT_DETECTION_STATISTICS_
+#define _COB_READ_TEXT_DETECTION_STATISTICS_
+
+// ROS includes
+#include <ros/ros.h>
+
+// Wall time and item counts of the stages of one DetectText::detect() call.
+// The stages from STROKE_WIDTH_TRANSFORM to BREAK_LINES run once per font color pass (possibly concurrently),
+// their times and counts are the sums over both passes.
+struct DetectionStatistics
+{
+  enum Stage
+  {
+    PREPROCESS = 0, // gray image, smoothing, result image
+    EDGE_MAP, // computeEdgeMap, gradients, integral images
+    STROKE_WIDTH_TRANSFORM,
+    CONNECT_COMPONENTS,
+    IDENTIFY_LETTERS,
+    GROUP_LETTERS,
+    CHAIN_PAIRS,
+    BREAK_LINES, // breakLines and breakLinesIntoWords (ORIGINAL_EPSHTEIN) or ransacPipeline without transformBezier (BORMANN)
+    OCR_PREPROCESS, // transformBezier, flipping and sharpening of the text patches
+    OCR,
+    TOTAL,
+    NUMBER_STAGES
+  };
+
+  enum Counter
+  {
+    REGIONS = 0, // image regions processed at full resolution (1 without regions of interest or pyramid)
+    EDGE_POINTS,
+    COMPONENTS,
+    LETTERS,
+    PAIRS,
+    BOXES, // final bounding boxes
+    OCR_CALLS, // text patches read by tesseract
+    OCR_CACHE_HITS, // text patches whose result was taken from the OCR cache
+    SKIPPED_BOXES, // boxes left out (not rectified or not read) to meet the deadline of detect()
+    UNREAD_BOXES, // boxes not read because no tesseract engine could be initialized
+    NUMBER_COUNTERS
+  };
+
+  DetectionStatistics()
+  {
+    clear();
+  }
+
+  void clear()
+  {
+    for (int s = 0; s < NUMBER_STAGES; s++)
+      seconds[s] = 0.;
+    for (int c = 0; c < NUMBER_COUNTERS; c++)
+      counts[c] = 0;
+  }
+
+  void add(const DetectionStatistics& other)
+  {
+    for (int s = 0; s < NUMBER_STAGES; s++)
+      seconds[s] += other.seconds[s];
+    for (int c = 0; c < NUMBER_COUNTERS; c++)
+      counts[c] += other.counts[c];
+  }
+
+  static const char* stageName(int stage)
+  {
+    static const char* names[NUMBER_STAGES] = {"preprocess", "computeEdgeMap", "strokeWidthTransform", "connectComponentAnalysis",
+                                               "identifyLetters", "groupLetters", "chainPairs", "breakLines", "ocrPreprocess", "ocr",
+                                               "total"};
+    return names[stage];
+  }
+
+  static const char* counterName(int counter)
+  {
+    static const char* names[NUMBER_COUNTERS] = {"regions", "edgePoints", "components", "letters", "pairs", "boxes", "ocrCalls", "ocrCacheHits", "skippedBoxes",
+                                                 "unreadBoxes"};
+    return names[counter];
+  }
+
+  double seconds[NUMBER_STAGES];
+  long counts[NUMBER_COUNTERS];
+};
+
+// Wall time since construction or the last restart(), unlike clock() it does not add up the time of several threads
+class StageTimer
+{
+public:
+  StageTimer() :
+    start_(ros::WallTime::now())
+  {
+  }
+
+  // returns the seconds since the last restart
+  double restart()
+  {
+    ros::WallTime now = ros::WallTime::now();
+    double seconds = (now - start_).toSec();
+    start_ = now;
+    return seconds;
+  }
+
+  double elapsed() const
+  {
+    return (ros::WallTime::now() - start_).toSec();
+  }
+
+private:
+  ros::WallTime start_;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _COB_READ_TEXT_DICTIONARY_INDEX_
+#define _COB_READ_TEXT_DICTIONARY_INDEX_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Different includes
+#include <string>
+#include <vector>
+
+// Trie over the dictionary words for finding the k dictionary words with the smallest edit distance to a word.
+// The edit distance matrix is computed column by column while walking down the trie, so words with a common
+// prefix share their columns. A subtree is skipped as soon as a lower bound for all words below (column entry plus the
+// insertions/deletions needed to reach the lengths of the words below) is worse than the current k-th best score.
+// The search starts with a small score limit that is widened until k words are found.
+// Both distances of DetectText are supported and give the same scores as DetectText::editDistance/editDistanceFont:
+// - plain: insertion, deletion and substitution cost 1
+// - correlation: insertion and deletion cost penalty, substitution costs 1 - correlation(dictionary letter, word letter),
+//   a '-' in the word matches every letter
+class DictionaryIndex
+{
+public:
+  struct Match
+  {
+    Match(int wordIndex, float score) :
+      wordIndex(wordIndex), score(score)
+    {
+    }
+    int wordIndex; // position in the word list given to build()
+    float score;
+  };
+
+  DictionaryIndex();
+
+  void build(const std::vector<std::string>& words);
+
+  // correlation: 256x256 CV_32F letter correlation (row: dictionary letter, column: word letter), only ASCII letters are used
+  void setCorrelation(const cv::Mat& correlation, float penalty);
+
+  // k best words with score < maxScore, sorted by score and position in the word list
+  void search(const std::string& word, int k, bool useCorrelation, float maxScore, std::vector<Match>& matches) const;
+
+private:
+  struct Node
+  {
+    Node(unsigned char letter) :
+      letter(letter), firstChild(-1), nextSibling(-1), numberChildren(0), terminal(-1), minRemaining(0), maxRemaining(0)
+    {
+    }
+    unsigned char letter;
+    int firstChild; // the children are stored next to each other, sorted by letter
+    int nextSibling; // only used while building
+    int numberChildren;
+    int terminal; // index into terminals_ if a word ends here, else -1
+    int minRemaining, maxRemaining; // number of letters from here to the shortest/longest word end below
+  };
+
+  // search state, one per search() call
+  struct Search
+  {
+    const std::string* word;
+    const float* correlation; // NULL: plain distance
+    float penalty;
+    bool prune;
+    int k;
+    float maxScore;
+    std::vector<float> columns; // column of each trie depth, word.length()+1 entries each
+    std::vector<Match>* matches;
+  };
+
+  void searchChildren(int node, int depth, Search& search) const;
+
+  void insertMatch(const Match& match, Search& search) const;
+
+  std::vector<Node> nodes_; // nodes_[0]: root
+  std::vector<std::vector<int> > terminals_; // word indices of every word end (the dictionary may contain duplicates)
+  int maxWordLength_;
+
+  std::vector<float> correlation_; // 256*256, [dictionary letter * 256 + word letter], 1 for word letter '-'
+  float penalty_;
+  bool correlationAdmissible_; // all correlations <= 1, i.e. no negative costs, otherwise subtrees are never skipped
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _COB_READ_TEXT_EDIT_DISTANCE_
+#define _COB_READ_TEXT_EDIT_DISTANCE_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Boost includes
+#include <boost/cstdint.hpp>
+
+// Different includes
+#include <string>
+#include <vector>
+
+// Edit distance kernels of the spell check.
+// An instance keeps its buffers between calls and does not allocate any more once they have grown to the longest words,
+// so every thread should use its own instance.
+class EditDistance
+{
+public:
+  EditDistance();
+
+  // correlation: 256x256 CV_32F letter correlation (row: dictionary letter, column: word letter), only ASCII letters are used
+  // penalty: cost of an insertion or deletion in fontDistance()
+  void setCorrelation(const cv::Mat& correlation, float penalty);
+
+  // Levenshtein distance, Myers' bit-parallel algorithm if the shorter string has at most 64 letters
+  int levenshtein(const std::string& s, const std::string& t);
+
+  // same score as DetectText::editDistanceFont: insertion and deletion cost penalty, substitution costs
+  // 1 - correlation(dictionary letter, word letter), a '-' in the word matches every letter
+  // (the dictionary search of the spell check computes this score in DictionaryIndex)
+  float fontDistance(const std::string& word, const std::string& dictionaryWord);
+
+private:
+  // pattern.length() <= 64
+  int levenshteinBitParallel(const std::string& pattern, const std::string& text);
+
+  boost::uint64_t patternMasks_[256]; // bit i of patternMasks_[c]: pattern[i] == c, all zero between calls
+  std::vector<int> rows_; // two rows of the Levenshtein matrix for longer words
+  std::vector<float> fontRows_; // two rows of the fontDistance matrix
+
+  std::vector<float> correlation_; // 256*256, [dictionary letter * 256 + word letter], 1 for word letter '-'
+  float penalty_;
+};
+
+#endif
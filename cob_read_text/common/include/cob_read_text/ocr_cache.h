@@ -0,0 +1,62 @@
+#ifndef _COB_READ_TEXT_OCR_CACHE_
+#define _COB_READ_TEXT_OCR_CACHE_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Boost includes
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+// Different includes
+#include <list>
+#include <string>
+
+// Bounded LRU cache of OCR results (text after spell checking and score) of text patches.
+// The key is a perceptual hash of the patch: the signs of the horizontal gray value differences of the patch scaled to
+// 33x8 pixels (difference hash, 256 bit) and the aspect ratio of the patch. A patch hits an entry if the Hamming distance
+// of the hashes is at most maxDistance and the aspect ratios differ by less than 10%, so the same label seen in the
+// next camera frame (slightly shifted, different exposure) is not read again.
+// All methods may be called from several threads.
+class OcrResultCache
+{
+public:
+  struct Key
+  {
+    boost::uint64_t bits[4];
+    float aspectRatio; // width / height
+  };
+
+  // capacity: maximum number of entries, maxDistance: maximum Hamming distance of a hit (0..256)
+  OcrResultCache(unsigned int capacity, int maxDistance);
+
+  static Key hash(const cv::Mat& patch);
+
+  // cached text and score of the most similar patch, false if there is none
+  bool find(const Key& key, std::string& text, float& score);
+
+  // adds a result, the least recently used entry is removed if the cache is full
+  void insert(const Key& key, const std::string& text, float score);
+
+  // lookups since construction
+  unsigned long hits();
+  unsigned long misses();
+
+private:
+  struct Entry
+  {
+    Key key;
+    std::string text;
+    float score;
+  };
+
+  static int distance(const Key& a, const Key& b);
+
+  boost::mutex mutex_;
+  std::list<Entry> entries_; // most recently used first
+  unsigned int capacity_;
+  int maxDistance_;
+  unsigned long hits_, misses_;
+};
+
+#endif
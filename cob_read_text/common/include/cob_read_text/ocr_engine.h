@@ -0,0 +1,55 @@
+#ifndef _COB_READ_TEXT_OCR_ENGINE_
+#define _COB_READ_TEXT_OCR_ENGINE_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Different includes
+#include <string>
+#include <vector>
+
+namespace tesseract
+{
+class TessBaseAPI;
+}
+
+// Pool of initialized Tesseract engines (from cob_tesseract) that read image patches directly from memory.
+// Loading the language data is expensive, so the engines are initialized once and kept for all following images.
+// One engine must only be used by one thread at a time, i.e. each worker thread uses its own engine index.
+// Engines are never shared between pools: a copied pool is empty and has to be initialized again.
+class OcrEnginePool
+{
+public:
+  OcrEnginePool();
+  OcrEnginePool(const OcrEnginePool& other);
+  ~OcrEnginePool();
+
+  OcrEnginePool& operator=(const OcrEnginePool& other);
+
+  // initializes numberEngines engines with language (e.g. "deu") and a config file from tessdata/configs (e.g. "letters")
+  // returns false if an engine could not be initialized, a failed pool is not initialized again (the error is reported once)
+  bool init(unsigned int numberEngines, const std::string& language, const std::string& config);
+
+  // true if the initialization of the engines has failed
+  bool failed() const;
+
+  // number of initialized engines
+  unsigned int size() const;
+
+  // reads a single text line from patch (8 bit gray or BGR image) with engine engineIndex, output is UTF-8
+  std::string recognize(unsigned int engineIndex, const cv::Mat& patch);
+
+private:
+  void release();
+
+  // directory containing tessdata/ (language data and configs)
+  static std::string getTessdataPrefix();
+
+  // sets the variables of a tesseract config file ("name value" per line) from tessdataPrefix/tessdata/configs for one engine
+  bool readConfig(tesseract::TessBaseAPI* engine, const std::string& tessdataPrefix, const std::string& config);
+
+  std::vector<tesseract::TessBaseAPI*> engines_;
+  bool failed_;
+};
+
+#endif
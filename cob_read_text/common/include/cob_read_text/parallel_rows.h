@@ -0,0 +1,62 @@
+#ifndef _COB_READ_TEXT_PARALLEL_ROWS_
+#define _COB_READ_TEXT_PARALLEL_ROWS_
+
+// Boost includes
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+// Different includes
+#include <algorithm>
+#include <vector>
+
+// Helpers for processing an image in horizontal bands of rows with several threads.
+
+// number of threads to use, numberThreads <= 0 means one per cpu core
+inline int resolveNumberThreads(int numberThreads)
+{
+  if (numberThreads > 0)
+    return numberThreads;
+  return std::max(1, (int)boost::thread::hardware_concurrency());
+}
+
+// splits [0, rows) into at most numberBands bands with at least minBandRows rows each
+// returns the band borders: band b covers the rows [borders[b], borders[b+1])
+inline std::vector<int> rowBands(int rows, int numberBands, int minBandRows = 16)
+{
+  numberBands = std::max(1, std::min(numberBands, rows / std::max(1, minBandRows)));
+  std::vector<int> borders(numberBands + 1);
+  for (int b = 0; b <= numberBands; b++)
+    borders[b] = (int)(((long long)rows * b) / numberBands);
+  return borders;
+}
+
+// calls body(rowStart, rowEnd) for every band, each band in its own thread (the last band in the calling thread)
+template<typename Body>
+void parallelRows(const std::vector<int>& borders, Body body)
+{
+  int numberBands = (int)borders.size() - 1;
+  if (numberBands <= 0)
+    return;
+
+  boost::thread_group threads;
+  for (int b = 0; b < numberBands - 1; b++)
+    threads.create_thread(boost::bind<void>(body, borders[b], borders[b + 1]));
+  body(borders[numberBands - 1], borders[numberBands]);
+  threads.join_all();
+}
+
+// calls body(task) for task = 0..numberTasks-1, each task in its own thread (the last task in the calling thread)
+template<typename Body>
+void parallelTasks(int numberTasks, Body body)
+{
+  if (numberTasks <= 0)
+    return;
+
+  boost::thread_group threads;
+  for (int task = 0; task < numberTasks - 1; task++)
+    threads.create_thread(boost::bind<void>(body, task));
+  body(numberTasks - 1);
+  threads.join_all();
+}
+
+#endif
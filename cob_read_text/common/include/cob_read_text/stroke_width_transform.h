@@ -0,0 +1,107 @@
+#ifndef _COB_READ_TEXT_STROKE_WIDTH_TRANSFORM_
+#define _COB_READ_TEXT_STROKE_WIDTH_TRANSFORM_
+
+// OpenCV includes
+#include "opencv2/core/core.hpp"
+
+// Different includes
+#include <vector>
+
+// Stroke width transform (Epshtein et al.) on a precomputed edge map.
+// From every edge pixel a ray is cast along the gradient (searchDirection 1: bright font, -1: dark font) until it meets
+// an edge pixel with roughly opposite gradient. The pixels of such a ray get the ray length as stroke width (update),
+// afterwards every ray is set to the median stroke width along it (refine).
+// The edge pixels are processed in bands of rows by several threads. Rays may leave their band by up to maxStrokeWidth
+// rows, so every band writes into its own buffer with halo rows above and below, the buffers are merged with min().
+// The gradients only depend on the image, one instance can compute both search directions concurrently.
+// Compact maps halve the working memory: stroke widths in fixed point (CV_16UC1, 1/STROKE_WIDTH_SCALE pixels) and
+// the gradient as packed pairs of int16 (CV_16SC2, unit length = GRADIENT_ONE).
+class StrokeWidthTransform
+{
+public:
+  enum
+  {
+    STROKE_WIDTH_SCALE = 16, // compact stroke widths up to 4095 pixels
+    GRADIENT_ONE = 1 << 14
+  };
+
+  StrokeWidthTransform();
+
+  // maxStrokeWidth: maximum ray length, initialStrokeWidth: value of unvisited pixels during the computation (> maxStrokeWidth)
+  // compareGradientParameter: maximum deviation (radian) of the gradient at the ray end from the opposite start gradient
+  // numberThreads <= 0: one thread per cpu core
+  StrokeWidthTransform(int maxStrokeWidth, float initialStrokeWidth, double compareGradientParameter, int numberThreads);
+
+  // edgemap: CV_8UC1 (255 = edge), dx, dy: CV_32FC1 derivatives of the gray image
+  // dx and dy are normalized in place (the gradient direction is kept) and used without copying them
+  void setGradients(const cv::Mat& edgemap, cv::Mat& dx, cv::Mat& dy);
+
+  // edgemap: CV_8UC1 (255 = edge), grayImage: CV_8UC1
+  // gradients: CV_16SC2, set to the 3x3 Sobel gradient of grayImage normalized to GRADIENT_ONE and used without copying it
+  // (like cv::Sobel, a region of interest uses the pixels of the whole image around it)
+  void setGradients(const cv::Mat& edgemap, const cv::Mat& grayImage, cv::Mat& gradients);
+
+  // swtmap: type CV_32FC1 (pixels) or CV_16UC1 (compact), 0 = no stroke
+  void compute(int searchDirection, cv::Mat& swtmap, int type = CV_32FC1) const;
+
+  // stroke width of an element of a CV_32FC1 or CV_16UC1 stroke width map in pixels
+  static float strokeWidth(float value)
+  {
+    return value;
+  }
+
+  static float strokeWidth(unsigned short value)
+  {
+    return value * (1.f / STROKE_WIDTH_SCALE);
+  }
+
+  // CV_32FC1 copy of a stroke width map of either type
+  static void toPixels(const cv::Mat& swtmap, cv::Mat& strokeWidths);
+
+private:
+  // stroke width buffer and stroke rays of one band of rows
+  struct Tile
+  {
+    int rowStart, rowEnd; // edge pixels of the band
+    int haloStart, haloEnd; // rows covered by strokeWidths
+    cv::Mat strokeWidths; // type of the stroke width map, rows [haloStart, haloEnd)
+    std::vector<int> rayPixels; // pixel indices (y*cols+x) of all stroke rays
+    std::vector<int> rayEnds; // ray r: rayPixels[rayEnds[r-1] .. rayEnds[r]-1]
+  };
+
+  // normalizes the gradients of rows [rowStart, rowEnd)
+  void normalizeGradients(int rowStart, int rowEnd);
+
+  // packed normalized Sobel gradients of rows [rowStart, rowEnd)
+  void packGradients(const cv::Mat& grayImage, int rowStart, int rowEnd);
+
+  // normalized gradient at pixel index i (y*cols+x) of either representation
+  void gradientAt(int i, float& gx, float& gy) const;
+
+  // T: element type of the stroke width map (float or unsigned short)
+  template <typename T>
+  void computeMap(int searchDirection, cv::Mat& swtmap) const;
+
+  // casts the rays of all edge pixels of a tile and writes the ray lengths
+  template <typename T>
+  void castRays(int searchDirection, std::vector<Tile>& tiles, int tileIndex) const;
+
+  // sets the stroke rays of a tile to the median stroke width along each ray
+  template <typename T>
+  void refineRays(const cv::Mat& swtmap, std::vector<Tile>& tiles, int tileIndex) const;
+
+  // swtmap = min(swtmap, all tile buffers) for rows [rowStart, rowEnd), unvisited pixels are set to 0
+  template <typename T>
+  void mergeTiles(const std::vector<Tile>& tiles, cv::Mat& swtmap, int rowStart, int rowEnd) const;
+
+  int maxStrokeWidth_;
+  float initialStrokeWidth_;
+  double tanCompareGradient_;
+  int numberThreads_;
+
+  cv::Mat edgemap_;
+  cv::Mat gradientX_, gradientY_; // CV_32FC1, normalized gradient, (0,0) where the gradient vanishes, shared with the caller
+  cv::Mat gradients_; // CV_16SC2 packed gradient instead of gradientX_, gradientY_ (compact maps), shared with the caller
+};
+
+#endif
@@ -10,7 +10,21 @@
 #include "cv.h"
 #include "highgui.h"
 
+// Boost includes
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
 // Different includes
+#include <cob_read_text/ocr_engine.h>
+#include <cob_read_text/ocr_cache.h>
+#include <cob_read_text/connected_components.h>
+#include <cob_read_text/stroke_width_transform.h>
+#include <cob_read_text/dictionary_index.h>
+#include <cob_read_text/edit_distance.h>
+#include <cob_read_text/detection_statistics.h>
+#include <cob_read_text/buffer_arena.h>
+#include <cob_read_text/bezier_curve.h>
+#include <cob_read_text/parallel_rows.h>
 #include <set>
 #include <iostream>
 #include <fstream>
@@ -25,16 +39,29 @@ public:
   // API
   void detect(std::string filename);
   void detect(cv::Mat& image);
+  // Anytime version: the boxes are read in the order of their quality score and rectification and OCR are skipped for the boxes
+  // that cannot be finished before the deadline. isPartial() tells whether boxes were left out.
+  void detect(cv::Mat& image, ros::WallTime deadline);
+  // Only the regions of interest (or the bounding boxes of the areas of the binary mask, CV_8UC1 of the image size) are
+  // searched for text, the results are given in image coordinates. With a mask only edges inside the mask are used.
+  void detect(cv::Mat& image, const std::vector<cv::Rect>& regionsOfInterest, ros::WallTime deadline = ros::WallTime());
+  void detect(cv::Mat& image, const cv::Mat& mask, ros::WallTime deadline = ros::WallTime());
 
   // read correlation, dictionary and params.yaml
   void readLetterCorrelation(const char* filename);
   void readWordList(const char* filename);
   void setParams(ros::NodeHandle & nh);
+  // for numberWorkers copies of this detector that detect in parallel: limits ocrThreads, tileThreads and ransacThreads to
+  // the cpu cores / numberWorkers (at least 1), with a single thread per worker the font passes run serially as well
+  void divideThreads(int numberWorkers);
 
   // getters
   cv::Mat& getDetection();
   std::vector<std::string>& getWords();
   std::vector<cv::RotatedRect>& getBoxes();
+  DetectionStatistics& getStatistics(); // stage times and counts of the last detect() call
+  bool isPartial(); // the last detect() call skipped boxes to meet its deadline
+  bool showsDebugWindows(); // some debug window is enabled (params.yaml show...), detect() must not run in several threads then
 
 private:
   // internal structures
@@ -48,11 +75,6 @@ private:
     BRIGHT = 1, DARK = 2
   };
 
-  enum Purpose // for SWT
-  {
-    UPDATE = 1, REFINE = 2
-  };
-
   struct Pair
   {
     Pair(int left, int right) :
@@ -96,6 +118,20 @@ private:
     }
   };
 
+  // mean colors of all regions, one array per channel
+  struct MeanColors
+  {
+    void assign(std::size_t n)
+    {
+      r.assign(n, 0.f);
+      g.assign(n, 0.f);
+      b.assign(n, 0.f);
+      gray.assign(n, 0.f);
+    }
+
+    std::vector<float> r, g, b, gray;
+  };
+
   struct connectedComponent
   {
     cv::Rect r;
@@ -103,39 +139,152 @@ private:
     FontColor clr;
   };
 
+  // one hypothesis of ransac(): curve through 3 sampled letters and its support by all letters of the box
+  struct BezierHypothesis
+  {
+    std::vector<cv::Point> points; // the sampled middle points, ordered by BezierCurve::fit
+    BezierCurve curve;
+    float angleDifference; // bending of the curve
+    bool rejected; // letter heights along the curve too different
+    std::vector<float> distances; // distance of every letter to the curve
+    std::vector<float> ts; // t of the nearest curve point of every letter
+    unsigned int numberInliers;
+    double inlierDistance; // summed distances of the supporting letters
+    float score;
+  };
+
+  // one text line found by ransacPipeline
+  struct BezierLine
+  {
+    cv::Mat transformedImage;
+    cv::Mat notTransformedImage;
+    cv::Rect box;
+    cv::RotatedRect rotatedBox;
+    double qualityScore; // number of letters on the line
+  };
+
+  // boxes of ocrRead(), taken one after the other by the OCR workers
+  struct OcrSchedule
+  {
+    OcrSchedule() :
+      next(0), completed(0), cacheHits(0), seconds(0.)
+    {
+    }
+
+    boost::mutex mutex;
+    std::vector<unsigned int> order; // box indices, best quality score first
+    unsigned int next; // position in order of the next box to read
+    unsigned int completed; // boxes read so far
+    unsigned int cacheHits; // patches of the completed boxes found in ocrCache_
+    double seconds; // summed OCR time of the completed boxes
+  };
+
+  // All data of one font color pass (bright or dark font) through the pipeline.
+  // Both passes only read the shared image data (gray image, edges, gradients), so they can run concurrently.
+  struct PassContext
+  {
+    PassContext(FontColor fontColor) :
+      fontColor(fontColor), searchDirection(fontColor == BRIGHT ? 1 : -1), candidatesOnly(false), rng(0x5eed + fontColor),
+          nComponent(0), nLetter(0)
+    {
+    }
+
+    FontColor fontColor; // BRIGHT: first pass, DARK: second pass
+    int searchDirection; // SWT ray direction relative to the gradient: 1 for bright font, -1 for dark font
+    bool candidatesOnly; // pyramid mode: stop after chainPairs, the chained boxes are the only result (finalBoundingBoxes)
+    cv::RNG rng; // random numbers of breakLines, seeded per font color so that the result does not depend on the thread scheduling
+
+    // SWT and Connect Component
+    cv::Mat swtmap;
+    cv::Mat ccmap; // CV_32SC1, -2 = no component, 0..nComponent-1 = component label
+    std::vector<cv::Rect> labeledRegions; // all regions (with label) that could be a letter
+    std::size_t nComponent; // =labeledRegions.size()
+    std::vector<ComponentStatistics> componentStatistics; // pixel count, stroke width and color sums of every region
+    std::vector<float> componentStrokeWidths; // stroke widths of all pixels, grouped by region
+    std::vector<int> componentStrokeWidthOffsets; // region i: componentStrokeWidths[offsets[i] .. offsets[i+1]-1]
+
+    // Identify Letters
+    std::vector<bool> isLetterRegion; // which region is letter
+    std::vector<double> medianStrokeWidth; // median stroke width for each letter region
+    MeanColors meanRGB; // mean R,G,B and Gray value of foreground pixels of every region
+    MeanColors meanBgRGB; // same with background pixels
+    unsigned int nLetter; // how many regions are letters
+
+    // Group Letters
+    std::vector<Pair> letterGroups; // 2 int values, correspond to indexes at isLetterRegion, for letters that belong together
+
+    // Chain to Box
+    std::vector<std::vector<connectedComponent> > connectedComponents; // letters of each chained box
+    std::vector<cv::Rect> letters; // letter boxes of this font color
+
+    // Results, merged into the DetectText members after both passes finished
+    std::vector<cv::Rect> finalBoundingBoxes;
+    std::vector<cv::RotatedRect> finalRotatedBoundingBoxes;
+    std::vector<double> finalBoundingBoxesQualityScore;
+    std::vector<cv::Mat> transformedImage;
+    std::vector<cv::Mat> notTransformedImage;
+
+    DetectionStatistics statistics; // stage times and counts of this pass
+  };
+
   // main method
   void detect();
+  void clearResults();
+  bool deadlinePassed(double secondsNeeded = 0.) const; // true if the deadline would be missed by work of secondsNeeded
   void detect_original_epshtein();
   void detect_bormann();
 
   void preprocess();
 
-  void pipeline();
+  // parameters depending on the image size: maxStrokeWidth_, initialStrokeWidth_, minLetterHeight_
+  void setSizeParameters(cv::Size size);
 
-  void strokeWidthTransform(const cv::Mat &image, cv::Mat &swtmap, int searchDirection);
+  void runPasses();
 
-  cv::Mat computeEdgeMap(bool rgbCanny);
+  // regions of originalImage_ that are processed: the whole image or the joined regions of interest with a margin
+  void getRegions(std::vector<cv::Rect>& regions);
+
+  // pyramid mode: text candidates of the downscaled image, in full resolution coordinates
+  void findCandidateRegions(std::vector<cv::Rect>& candidates);
+
+  // both passes on one region, originalImage_ and grayImage_ show only the region meanwhile
+  void runPasses(const cv::Rect& region);
+
+  // edges and gradients of the region, then both passes (concurrently if allowed)
+  void processPasses(const cv::Rect& region, PassContext& brightPass, PassContext& darkPass);
+
+  void pipeline(PassContext& pass);
 
-  void updateStrokeWidth(cv::Mat &swtmap, std::vector<cv::Point> &startPoints, std::vector<cv::Point> &strokePoints,
-                         int searchDirection, Purpose purpose);
+  void mergePassResults(PassContext& pass, cv::Point offset);
+
+  void computeGradients(const cv::Rect& region);
+
+  void strokeWidthTransform(cv::Mat &swtmap, int searchDirection);
+
+  cv::Mat computeEdgeMap(bool rgbCanny);
 
   void closeOutline(cv::Mat& edgemap);
 
-  int connectComponentAnalysis(const cv::Mat& swtmap, cv::Mat& ccmap);
+  int connectComponentAnalysis(PassContext& pass);
 
-  void identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap);
+  void identifyLetters(PassContext& pass);
 
-  int countInnerLetterCandidates(std::vector<bool> & array);
+  // overlaps[i]: letters whose bounding box overlaps the box of letter i (inner letter candidates of rule #6 of identifyLetters)
+  void overlappingLetters(const PassContext& pass, std::vector<std::vector<int> >& overlaps);
 
-  std::vector<float> getMeanIntensity(const cv::Mat& ccmap, const cv::Rect& rect, int element, bool background);
+  void getMeanIntensity(const ComponentStatistics& component, const cv::Rect& rect, bool background, MeanColors& means, std::size_t index);
 
-  void groupLetters(const cv::Mat& swtmap, const cv::Mat& ccmap);
+  void groupLetters(PassContext& pass);
 
-  float getMedianStrokeWidth(const cv::Mat& ccmap, const cv::Mat& swtmap, const cv::Rect& rect, int element);
+  // candidates[i]: letters j > i whose center is close enough to the center of letter i for rule 1a of groupLetters,
+  // found with a uniform grid of cells of median letter height
+  void letterPairCandidates(const PassContext& pass, double largeLetterCountFactor, std::vector<std::vector<int> >& candidates);
 
-  std::vector<cv::Rect> chainPairs();
+  float getMedianStrokeWidth(const PassContext& pass, int element);
 
-  void chainToBox(std::vector<std::vector<int> >& chain, std::vector<cv::Rect>& boundingBox);
+  std::vector<cv::Rect> chainPairs(PassContext& pass);
+
+  void chainToBox(PassContext& pass, std::vector<std::vector<int> >& chain, std::vector<cv::Rect>& boundingBox);
 
   void mergePairs(const std::vector<Pair>& groups, std::vector<std::vector<int> >& chains);
 
@@ -145,12 +294,10 @@ private:
 
   void combineNeighborBoxes(std::vector<cv::Rect> & boundingBoxes);
 
-  void breakLines(std::vector<cv::Rect> & boundingBoxes, std::vector<cv::RotatedRect>& lineEquations);
+  void breakLines(PassContext& pass, std::vector<cv::Rect> & boundingBoxes, std::vector<cv::RotatedRect>& lineEquations);
 
   static bool spatialOrderX(cv::Rect a, cv::Rect b);
 
-  void disposal();
-
   void deleteDoubleBrokenWords(std::vector<cv::Rect>& brokenWords_);
 
   void ocrPreprocess(std::vector<cv::Mat> &images);
@@ -169,7 +316,10 @@ private:
 
   void ocrRead(std::vector<cv::Mat> textImages);
 
-  float ocrRead(const cv::Mat& imagePatch, std::string& output);
+  void ocrReadWorker(const std::vector<cv::Mat>& textImages, unsigned int imageVersions, unsigned int engineIndex, OcrSchedule& schedule,
+                     std::vector<float>& scores, std::vector<std::string>& results, std::vector<std::string>& logs);
+
+  float ocrRead(const cv::Mat& imagePatch, std::string& output, unsigned int engineIndex, std::ostream& log);
 
   float spellCheck(std::string& str, std::string& output, int method);
 
@@ -177,7 +327,7 @@ private:
 
   void getTopkWords(const std::string& str, const int k, std::vector<Word>& words);
 
-  static int editDistance(const std::string& s, const std::string& t);
+  int editDistance(const std::string& s, const std::string& t);
 
   float editDistanceFont(const std::string& s, const std::string& t);
 
@@ -191,10 +341,20 @@ private:
 
   void writeTxtsForEval();
 
-  void ransacPipeline(std::vector<cv::Rect> & boundingBoxes);
+  void ransacPipeline(PassContext& pass, std::vector<cv::Rect> & boundingBoxes);
 
+  void ransacBoxes(const PassContext& pass, const std::vector<unsigned int>& order, unsigned int numberTasks, int ransacThreads,
+                   std::vector<std::vector<BezierLine> >& lines, std::vector<double>& taskSeconds, std::vector<double>& bezierSeconds,
+                   unsigned int task);
+
+  void fitBezierLines(const PassContext& pass, unsigned int boxIndex, int ransacThreads, std::vector<BezierLine>& lines, double& bezierSeconds);
+
+  // seed: seed of the random sampling (box index), the result does not depend on numberThreads or on other boxes
   std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > >
-  ransac(std::vector<connectedComponent> dataset);
+  ransac(std::vector<connectedComponent> dataset, int numberThreads, unsigned int seed);
+
+  void evaluateBezierHypotheses(const std::vector<connectedComponent>& dataset, float maxDistance, std::vector<BezierHypothesis>& hypotheses,
+                                unsigned int numberTasks, unsigned int task);
 
   cv::Mat createBezierCurve(std::vector<cv::Point> & points, bool p);
 
@@ -202,7 +362,7 @@ private:
 
   float getBezierLength(cv::Mat curve, float mint, float maxt);
 
-  void transformBezier(cv::Rect newR, cv::Mat curve, cv::Mat & transformedImage, float mint, float maxt);
+  void transformBezier(cv::Rect newR, cv::Mat curve, cv::Mat & transformedImage, float mint, float maxt, FontColor fontColor);
 
   unsigned int calculateRealLetterHeight(cv::Point2f p, cv::Rect r, cv::Point2f alpha);
 
@@ -213,7 +373,7 @@ private:
   // Methods not used at the moment:
   //------------------------------------------
 
-  void filterBoundingBoxes(std::vector<cv::Rect>& boundingBoxes, cv::Mat& ccmap, int rejectRatio);
+  void filterBoundingBoxes(const PassContext& pass, std::vector<cv::Rect>& boundingBoxes, int rejectRatio);
 
   static bool spatialOrder(cv::Rect a, cv::Rect b);
 
@@ -226,23 +386,29 @@ private:
   int decideWhichBreaks(float negPosRatio, float max_Bin, float baselineStddev, unsigned int howManyNegative,
                         unsigned int shift, int maxPeakDistance, int secondMaxPeakDistance, int maxPeakNumbers,
                         int secondMaxPeakNumbers, unsigned int boxWidth, unsigned int boxHeight,
-                        unsigned int numberBinsNotZero, std::vector<DetectText::Pair> wordBreaks, cv::Rect box,
+                        unsigned int numberBinsNotZero, const std::vector<DetectText::Pair>& wordBreaks, cv::Rect box,
                         bool textIsRotated, float relativeY, bool SteadyStructure, float sameArea);
 
   void DFT(cv::Mat& input);
 
   cv::Mat filterPatch(const cv::Mat& patch);
 
-  void breakLinesIntoWords(std::vector<cv::Rect> & boundingBoxes, std::vector<cv::RotatedRect>& lineEquations, std::vector<double>& qualityScore);
+  void breakLinesIntoWords(PassContext& pass, std::vector<cv::Rect> & boundingBoxes, std::vector<cv::RotatedRect>& lineEquations, std::vector<double>& qualityScore);
+
+  // for all boxes in one call, with the letters sorted by x once:
+  // boxLetters[b]: indices (ascending) of the letters completely inside boxes[b]
+  // wordBreaks[b]: for every letter of boxLetters[b] with a letter of the box starting right of it, (x of the nearest such letter, gap to it)
+  void letterGaps(const std::vector<cv::Rect>& letters, const std::vector<cv::Rect>& boxes, std::vector<std::vector<int> >& boxLetters,
+                  std::vector<std::vector<Pair> >& wordBreaks);
 
   // Methods for debugging only
   //------------------------------------------
 
   void showEdgeMap();
-  void showCcmap(cv::Mat& ccmap);
-  void showSwtmap(cv::Mat& swtmap);
-  void showLetterDetection();
-  void showLetterGroup();
+  void showCcmap(const PassContext& pass);
+  void showSwtmap(const PassContext& pass);
+  void showLetterDetection(const PassContext& pass);
+  void showLetterGroup(const PassContext& pass);
   void testGetCorrelationIndex();
   void testEditDistance();
   void testInsertToList();
@@ -255,46 +421,43 @@ private:
   // I/O
   std::string filename_;
   std::string outputPrefix_;
+  Mode mode_; // streaming from topic (result image is not written to disk) or reading image file
   cv::Mat correlation_; // read from argv[1]
   std::vector<std::string> wordList_; // read from argv[2]
+  DictionaryIndex dictionaryIndex_; // trie over wordList_ for getTopkWords
+  EditDistance editDistanceKernel_; // buffers and letter correlation of editDistance and editDistanceFont
+
+  // working images (gray image, edges, gradients, swt and cc maps, ...), kept over several images of the same size
+  BufferArena buffers_;
 
   // important images
   cv::Mat originalImage_;
   cv::Mat grayImage_;
   cv::Mat resultImage_;
 
-  // general
-  bool firstPass_; //  white font: true, black font: false
-
   // SWT
   int maxStrokeWidth_;
   float initialStrokeWidth_;
   cv::Mat edgemap_; // edges detected at gray image
-  cv::Mat theta_; // gradient map, arctan(dy,dx)
-  cv::Mat dx_;
-  cv::Mat dy_;
-  std::vector<cv::Point> edgepoints_; // all points where an edge is
-
-  // Connect Component
-  std::vector<cv::Rect> labeledRegions_; // all regions (with label) that could be a letter
-  std::size_t nComponent_; // =labeledRegions_.size()
-  cv::Mat ccmapBright_, ccmapDark_; // copy of whole cc map
-  std::vector<std::vector<connectedComponent> > connectedComponents_;
+  cv::Mat dx_; // normalized to unit length by swtEngine_, with compactMaps_ the packed gradient (CV_16SC2)
+  cv::Mat dy_; // empty with compactMaps_
+  StrokeWidthTransform swtEngine_; // edges and normalized gradients of the current image, shared by both passes
 
   // Identify Letters
-  std::vector<bool> isLetterRegion_; // which region is letter
-  std::vector<double> medianStrokeWidth_;	// median stroke width for each letter region
-  std::vector<std::vector<float> > meanRGB_; // mean R,G,B and Gray value of foreground pixels of every region
-  std::vector<std::vector<float> > meanBgRGB_; // same with background pixels
-  unsigned int nLetter_; // how many regions are letters
+  cv::Mat colorIntegral_; // integral image of originalImage_ (CV_64FC3), for background colors of the components
+  cv::Mat grayIntegral_; // integral image of grayImage_ (CV_64FC1)
+
+  // Connect Component
+  cv::Mat ccmapBright_, ccmapDark_; // copy of whole cc map, taken from the passes
+  cv::Mat ccmapBrightRegion_, ccmapDarkRegion_; // cc maps of the region processed last
 
-  // Group Letters
-  std::vector<Pair> letterGroups_; // 2 int values, correspond to indexes at isLetterComponects_, for letters that belong together
+  // Regions of interest of the current detect() call (none: whole image)
+  std::vector<cv::Rect> regionsOfInterest_;
+  cv::Mat regionMask_;
 
   // Chain to Box
   std::vector<cv::Rect> boundingBoxes_; // all boundingBoxes, black and white font combined
   std::vector<cv::Rect> brightBoxes_, darkBoxes_; // separate b/w font
-  std::vector<cv::Rect> brightLetters_, darkLetters_; // b/w font letter boxes
   std::vector<FontColor> boxFontColor_; //remember which boundingBox had which font color
 
   // OCR Preprocess
@@ -312,35 +475,48 @@ private:
   // OCR
   bool enableOCR_;
   int result_;
+  OcrEnginePool ocrEngines_; // initialized tesseract engines, kept over several images
+  boost::shared_ptr<OcrResultCache> ocrCache_; // results of recently read patches, shared by the copies of this detector, null = no cache
   std::vector<cv::Mat> textImages_;
   std::vector<cv::RotatedRect> finalBoxes_;
   std::vector<std::string> finalTexts_;
   std::vector<float> finalScores_;
+  double ocrSecondsPerBox_; // mean OCR time of one box in the last detect() call, estimate for the deadline of the next call
+
+  // Deadline
+  ros::WallTime deadline_; // zero = no deadline
+  bool partial_; // boxes were skipped to meet the deadline
 
   // Debug etc.
   std::map<std::string, bool> debug;
+  DetectionStatistics statistics_; // stage times and counts of the last detect() call, both passes summed up
   bool eval_; //true=evaluation (read_evaluation) false=standard
 
-  // Not used but useful variables:
-  //Mode mode_; // streaming from topic or reading image file
-
   // Parameters given by yaml
   // --- general ---
   enum ProcessingMethod {ORIGINAL_EPSHTEIN=0, BORMANN};
   ProcessingMethod processing_method_;				// defines the method for finding texts in the image
+  bool parallelPasses_; // default: true, run bright and dark font pass in separate threads (always serial when debug windows are shown)
+  int ocrThreads_; // default: 0 = one per cpu core, number of tesseract engines reading text patches in parallel
+  int tileThreads_; // default: 0 = one per cpu core, number of threads processing bands of image rows (strokeWidthTransform, connectComponentAnalysis)
+  int ransacThreads_; // default: 0 = one per cpu core, number of threads fitting the text lines of the boxes and evaluating ransac hypotheses (BORMANN)
+  int ocrCacheSize_; // default: 0 = no cache, number of OCR results of recently read patches that are kept, ignored in eval mode
+  int ocrCacheMaxDistance_; // default: 8, maximum Hamming distance of the 256 bit patch hashes of a cache hit
 
   // --- transform ---
   bool transformImages;
 
   // --- preprocess ---
   bool smoothImage; // default: false, smoothing leads to merging of letters within small texts (that is bad)
+  int pyramidLevels_; // default: 0 = off, find the text candidates at 1/2^pyramidLevels_ resolution, full resolution only inside the candidates
   int maxStrokeWidthParameter; // default: maxStrokeWidthParameter = 50, good for big text: <50, good for careobot/small texts: >50
   // --- strokeWidthTransform ---
   bool useColorEdge; // true = use rgb channels to compute edgeMap, false = only gray image is used
+  bool compactMaps_; // default: false, CV_16UC1 stroke width maps and CV_16SC2 packed gradients (StrokeWidthTransform) instead of CV_32FC1 maps
   // --- computeEdgeMap ---
   int cannyThreshold1; // default: 120
   int cannyThreshold2; // default: 50 , cannyThreshold1 > cannyThreshold2
-  // --- updateStrokeWidth ---
+  // --- strokeWidthTransform ---
   double compareGradientParameter_; // default: 3.14 / 2, in paper: 3.14 / 6 -> unrealistic
   // --- connectComponentAnalysis ---
   double swCompareParameter; // default: 3.0
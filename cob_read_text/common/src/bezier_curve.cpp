@@ -0,0 +1,350 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * Closed form quadratic Bezier curves of the RANSAC text line fitting.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/bezier_curve.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+// t and arc length from C(mint) at the vertices of a polyline along the curve with segments of at most about half a pixel
+void arcLengthTable(const BezierCurve& curve, float mint, float maxt, std::vector<float>& ts, std::vector<float>& lengths)
+{
+	cv::Point2f first = curve.point(mint), middle = curve.point(0.5f * (mint + maxt)), last = curve.point(maxt);
+	float chordLength = std::sqrt((middle - first).dot(middle - first)) + std::sqrt((last - middle).dot(last - middle));
+	int segments = std::max(16, std::min(100000, (int)std::ceil(2.f * chordLength)));
+
+	ts.resize(segments + 1);
+	lengths.resize(segments + 1);
+	ts[0] = mint;
+	lengths[0] = 0.f;
+	cv::Point2f previous = first;
+	for (int i = 1; i <= segments; i++)
+	{
+		ts[i] = mint + (maxt - mint) * i / (float)segments;
+		cv::Point2f p = curve.point(ts[i]);
+		lengths[i] = lengths[i - 1] + std::sqrt((p - previous).dot(p - previous));
+		previous = p;
+	}
+}
+}
+
+BezierCurve::BezierCurve()
+{
+	for (int row = 0; row < 2; row++)
+		for (int col = 0; col < 3; col++)
+			coefficients[row][col] = 0.f;
+}
+
+BezierCurve::BezierCurve(const cv::Mat& curve)
+{
+	for (int row = 0; row < 2; row++)
+		for (int col = 0; col < 3; col++)
+			coefficients[row][col] = curve.at<float>(row, col);
+}
+
+bool BezierCurve::fit(std::vector<cv::Point>& points)
+{
+	if (points.size() != 3)
+		return false;
+
+	// the 3 points as columns
+	float R[2][3];
+	for (int col = 0; col < 3; col++)
+	{
+		R[0][col] = points[col].x;
+		R[1][col] = points[col].y;
+	}
+
+	// 1.) compute distances of all 3 points and position them into right order,
+	// i.e. the points with largest distance go to position 1 and 3
+	float distance12 = std::sqrt((points[0].y - points[1].y) * (points[0].y - points[1].y) + (points[0].x - points[1].x) * (points[0].x - points[1].x));
+	float distance13 = std::sqrt((points[0].y - points[2].y) * (points[0].y - points[2].y) + (points[0].x - points[2].x) * (points[0].x - points[2].x));
+	float distance23 = std::sqrt((points[1].y - points[2].y) * (points[1].y - points[2].y) + (points[1].x - points[2].x) * (points[1].x - points[2].x));
+
+	float t0 = distance12 / (float) (distance12 + distance23); // relation of distances, i.e. percentage of t at the point in the middle
+
+	if (distance12 > distance13 && distance12 > distance23)
+	{
+		for (int row = 0; row < 2; row++)
+			std::swap(R[row][1], R[row][2]);
+		t0 = distance13 / (float) (distance13 + distance23);
+		std::swap(points[1], points[2]);
+	}
+	else if (distance23 > distance12 && distance23 > distance13)
+	{
+		for (int row = 0; row < 2; row++)
+			std::swap(R[row][1], R[row][0]);
+		t0 = distance12 / (float) (distance13 + distance12);
+		std::swap(points[1], points[0]);
+	}
+
+	// why? to avoid head-over as first guess!
+	if (points[0].x > points[2].x)
+	{
+		for (int row = 0; row < 2; row++)
+			std::swap(R[row][0], R[row][2]);
+		std::swap(points[0], points[2]);
+		t0 = 1 - t0;
+	}
+
+	// 2.) compute the Bezier point and the coefficients
+	for (int row = 0; row < 2; row++)
+	{
+		R[row][1] = (R[row][1] + R[row][0] * (-1 + 2 * t0 - t0 * t0) - R[row][2] * t0 * t0) / (2 * t0 - 2 * t0 * t0);
+
+		coefficients[row][0] = R[row][0] - 2 * R[row][1] + R[row][2];
+		coefficients[row][1] = -2 * R[row][0] + 2 * R[row][1];
+		coefficients[row][2] = R[row][0];
+	}
+	return true;
+}
+
+cv::Mat BezierCurve::toMat() const
+{
+	cv::Mat curve(2, 3, CV_32FC1);
+	for (int row = 0; row < 2; row++)
+		for (int col = 0; col < 3; col++)
+			curve.at<float>(row, col) = coefficients[row][col];
+	return curve;
+}
+
+std::pair<float, float> BezierCurve::distance(cv::Point Q) const
+{
+	const float Ax = coefficients[0][0], Bx = coefficients[0][1], Dx = coefficients[0][2];
+	const float Ay = coefficients[1][0], By = coefficients[1][1], Dy = coefficients[1][2];
+
+	// compute distance from Q to curve and t when C(t) is nearest Point to Q on curve
+	float a = 2 * (Ax * Ax + Ay * Ay); //coefficients
+	float b = 3 * (Ax * Bx + Ay * By);
+	float c = 2 * (Ax * (Dx - Q.x) + Ay * (Dy - Q.y)) + Bx * Bx + By * By;
+	float d = Bx * (Dx - Q.x) + By * (Dy - Q.y);
+
+	// distinguish between several cases
+	float ts = 0;
+
+	if (std::abs(a) == 0)
+	{
+		if (std::abs(b) == 0)
+		{
+			if (c == 0)
+				std::cout << "Error: a=0, b=0, c=0" << std::endl;
+			else
+				// c*ts+d = 0
+				ts = -d / c;
+		}
+		else
+		{
+			float p2 = c / (2 * b);
+			float q = d / b;
+			if (p2 * p2 - q < 0)
+				std::cout << "Error: a=0, b~=0, p2^2-q < 0" << std::endl;
+			float t1 = -p2 - std::sqrt(p2 * p2 - q);
+			float t2 = -p2 + std::sqrt(p2 * p2 - q);
+
+			float dist1 = ((Ax * t1 * t1 + Bx * t1 + Dx - Q.x) * (Ax * t1 * t1 + Bx * t1 + Dx - Q.x) + (Ay * t1 * t1 + By * t1 + Dy - Q.y) * (Ay * t1 * t1
+					+ By * t1 + Dy - Q.y));
+			float dist2 = ((Ax * t2 * t2 + Bx * t2 + Dx - Q.x) * (Ax * t2 * t2 + Bx * t2 + Dx - Q.x) + (Ay * t2 * t2 + By * t2 + Dy - Q.y) * (Ay * t2 * t2
+					+ By * t2 + Dy - Q.y));
+			if (dist1 < dist2)
+				ts = t1;
+			else
+				ts = t2;
+		}
+	}
+	else // a*ts³+b*ts²+c*ts+d=0
+	{
+		//  If discrimant > 0, then the equation has three distinct real roots.
+		//  If discrimant = 0, then the equation has a multiple root and all its roots are real.
+		//  If discrimant < 0, then the equation has one real root and two nonreal complex conjugate roots.
+
+		float discriminant = 18 * a * b * c * d - 4 * b * b * b * d + b * b * c * c - 4 * a * c * c * c - 27 * a * a * d * d;
+		if (discriminant < 0)
+		{
+			// analytic real root of cubic function
+			float ts_p1, ts_p2;
+			if (2 * b * b * b - 9 * a * b * c + 27 * a * a * d + a * sqrt(-27 * discriminant) < 0)
+			{
+				ts_p1 = std::pow(-0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d + a * sqrt(-27 * discriminant)), (1.0 / 3.0));
+				ts_p1 *= -1;
+			}
+			else
+			{
+				ts_p1 = std::pow(0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d + a * sqrt(-27 * discriminant)), (1.0 / 3.0));
+			}
+			if (2 * b * b * b - 9 * a * b * c + 27 * a * a * d - a * sqrt(-27 * discriminant) < 0)
+			{
+				ts_p2 = std::pow(-0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d - a * sqrt(-27 * discriminant)), (1.0 / 3.0));
+				ts_p2 *= -1;
+			}
+			else
+			{
+				ts_p2 = std::pow(0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d - a * sqrt(-27 * discriminant)), (1.0 / 3.0));
+			}
+			ts = (-b / (3 * a)) - (1 / (3 * a)) * ts_p1 - (1 / (3 * a)) * ts_p2;
+		}
+		else
+		{
+			// 2 or 3 solutions, use Newton root approximation and choose the closest point on C(t)
+			// a) roots of 1st derivative of cubic function -> get estimates for initial values for Newton method
+			float p2 = b / (3 * a);
+			float q = c / (3 * a);
+			float tis[3]; // initial values for Newton method
+			int numberTis = 0;
+
+			if (p2 * p2 - q < 0) // no real roots in derivative? -> one real root for cubic function
+			{
+				tis[numberTis++] = 0.5; // should probably never happen because discriminant would be < 0
+			}
+			else if (p2 * p2 - q == 0) // one double real root in derivative -> one real root for cubic function
+			{
+				tis[numberTis++] = -p2 - 0.25;
+				tis[numberTis++] = -p2 + 0.25;
+			}
+			else
+			{
+				// two distinct real roots in derivative -> three distinct real roots for cubic function
+				float t1 = -p2 - std::sqrt(p2 * p2 - q);
+				float t2 = -p2 + std::sqrt(p2 * p2 - q); // t1 < t2
+				tis[numberTis++] = t1 - 0.25;
+				tis[numberTis++] = (t1 + t2) / 2;
+				tis[numberTis++] = t2 + 0.25;
+			}
+
+			// b) Newton method for each initial value and comparison for
+			float tss = 0;
+			long mindist = 1e10;
+			for (int ii = 0; ii < numberTis; ii++)
+			{
+				tss = tis[ii];
+				float i = 0;
+				float f = a * tss * tss * tss + b * tss * tss + c * tss + d;
+				while (i < 100 && std::abs(f) > 1e-5)
+				{
+					tss = tss - f / (3 * a * tss * tss + 2 * b * tss + c);
+					f = a * tss * tss * tss + b * tss * tss + c * tss + d;
+					i = i + 1;
+				}
+
+				// get closest distance if multiple real roots present
+				float dist_tss = ((Ax * tss * tss + Bx * tss + Dx - Q.x) * (Ax * tss * tss + Bx * tss + Dx - Q.x) + (Ay * tss * tss + By * tss + Dy - Q.y)
+						* (Ay * tss * tss + By * tss + Dy - Q.y)); // length of line between C(tss) and Q
+
+				if (mindist > dist_tss && std::abs(tss) < 10)
+				{
+					ts = tss;
+					mindist = dist_tss;
+				}
+			}
+		}
+	}
+
+	// closest point to Q on C(t)
+	float Csx = Ax * ts * ts + Bx * ts + Dx;
+	float Csy = Ay * ts * ts + By * ts + Dy;
+
+	float shortestDistance = std::sqrt((Csx - Q.x) * (Csx - Q.x) + (Csy - Q.y) * (Csy - Q.y));
+
+	return std::pair<float, float>(shortestDistance, ts);
+}
+
+float BezierCurve::length(float mint, float maxt) const
+{
+	std::vector<float> ts, lengths;
+	arcLengthTable(*this, mint, maxt, ts, lengths);
+	return lengths.back();
+}
+
+void BezierCurve::rectificationGrid(float mint, float maxt, cv::Size size, cv::Mat& grid) const
+{
+	grid.create(size, CV_32FC2);
+	if (size.width <= 0 || size.height <= 0)
+		return;
+
+	std::vector<float> ts, lengths;
+	arcLengthTable(*this, mint, maxt, ts, lengths);
+
+	// curve point and unit normal of every column, the arc length table is walked once from left to right
+	std::vector<cv::Point2f> centers(size.width), normals(size.width);
+	cv::Point2f normal(0.f, -1.f);
+	std::size_t segment = 0;
+	for (int x = 0; x < size.width; x++)
+	{
+		float s = std::min((float)x, lengths.back());
+		while (segment + 2 < lengths.size() && lengths[segment + 1] < s)
+			segment++;
+		float segmentLength = lengths[segment + 1] - lengths[segment];
+		float t = ts[segment];
+		if (segmentLength > 0.f)
+			t += (s - lengths[segment]) / segmentLength * (ts[segment + 1] - ts[segment]);
+
+		// C'(t) = 2At+B rotated by -90 degrees, the previous normal is kept where the curve stands still
+		cv::Point2f n(2 * coefficients[1][0] * t + coefficients[1][1], -(2 * coefficients[0][0] * t + coefficients[0][1]));
+		float absN = std::sqrt(n.dot(n));
+		if (absN > 0.f)
+			normal = n * (1.f / absN);
+
+		centers[x] = point(t);
+		normals[x] = normal;
+	}
+
+	const int middleRow = size.height / 2;
+	for (int y = 0; y < size.height; y++)
+	{
+		float offset = middleRow - y;
+		cv::Vec2f* row = grid.ptr<cv::Vec2f>(y);
+		for (int x = 0; x < size.width; x++)
+			row[x] = cv::Vec2f(centers[x].x + offset * normals[x].x, centers[x].y + offset * normals[x].y);
+	}
+}
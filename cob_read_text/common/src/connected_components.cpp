@@ -0,0 +1,272 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * Union-find connected component labelling of the stroke width map.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/connected_components.h>
+#include <cob_read_text/parallel_rows.h>
+#include <cob_read_text/stroke_width_transform.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// parent[i] <= i always holds, so the root of a tree is its first pixel in raster order
+inline int findRoot(int* parent, int i)
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]]; // path halving
+		i = parent[i];
+	}
+	return i;
+}
+
+inline void unite(int* parent, int a, int b)
+{
+	a = findRoot(parent, a);
+	b = findRoot(parent, b);
+	if (a < b)
+		parent[b] = a;
+	else if (b < a)
+		parent[a] = b;
+}
+}
+
+ConnectedComponentLabeling::ConnectedComponentLabeling(double swCompareParameter, int colorCompareParameter) :
+	swCompareParameter_(swCompareParameter), colorCompareParameter_(colorCompareParameter)
+{
+}
+
+int ConnectedComponentLabeling::label(const cv::Mat& swtmap, const cv::Mat& image, const cv::Mat& grayImage, int numberThreads, cv::Mat& labels,
+		std::vector<ComponentStatistics>& statistics, std::vector<float>& strokeWidths, std::vector<int>& strokeWidthOffsets, cv::Mat& parents) const
+{
+	if (swtmap.type() == CV_16UC1)
+		return labelMap<unsigned short>(swtmap, image, grayImage, numberThreads, labels, statistics, strokeWidths, strokeWidthOffsets, parents);
+	return labelMap<float>(swtmap, image, grayImage, numberThreads, labels, statistics, strokeWidths, strokeWidthOffsets, parents);
+}
+
+template <typename T>
+int ConnectedComponentLabeling::labelMap(const cv::Mat& swtmap, const cv::Mat& image, const cv::Mat& grayImage, int numberThreads, cv::Mat& labels,
+		std::vector<ComponentStatistics>& statistics, std::vector<float>& strokeWidths, std::vector<int>& strokeWidthOffsets, cv::Mat& parents) const
+{
+	const int rows = swtmap.rows;
+	const int cols = swtmap.cols;
+
+	labels.create(rows, cols, CV_32SC1);
+	parents.create(rows, cols, CV_32SC1);
+	int* parent = parents.ptr<int>(0);
+	int* labelData = labels.ptr<int>(0);
+
+	// first pass: union-find in every band of rows
+	std::vector<int> borders = rowBands(rows, resolveNumberThreads(numberThreads));
+	parallelRows(borders, boost::bind(&ConnectedComponentLabeling::labelBand<T>, this, boost::cref(swtmap), boost::cref(image), boost::cref(grayImage), parent, _1, _2));
+
+	// join the bands: first row of every band with the last row of the band above
+	for (size_t b = 1; b + 1 < borders.size(); b++)
+	{
+		int y = borders[b];
+		const T* sw = swtmap.ptr<T>(y);
+		const T* swUp = swtmap.ptr<T>(y - 1);
+		for (int x = 0; x < cols; x++)
+		{
+			if (sw[x] == 0)
+				continue;
+			for (int nx = std::max(0, x - 1); nx <= std::min(cols - 1, x + 1); nx++)
+				if (swUp[nx] != 0 && similar(image, grayImage, StrokeWidthTransform::strokeWidth(sw[x]), StrokeWidthTransform::strokeWidth(swUp[nx]), x, y, nx, y - 1))
+					unite(parent, y * cols + x, (y - 1) * cols + nx);
+		}
+	}
+
+	// second pass: provisional labels in raster order of the roots and component statistics
+	std::vector<ComponentStatistics> provisional;
+	for (int y = 0; y < rows; y++)
+	{
+		const T* sw = swtmap.ptr<T>(y);
+		const uchar* bgr = image.ptr<uchar>(y);
+		const uchar* gray = grayImage.ptr<uchar>(y);
+		for (int x = 0, i = y * cols; x < cols; x++, i++)
+		{
+			if (sw[x] == 0)
+			{
+				labelData[i] = -2;
+				continue;
+			}
+
+			int l;
+			if (parent[i] == i)
+			{
+				l = provisional.size();
+				provisional.push_back(ComponentStatistics());
+			}
+			else
+				l = labelData[parent[i]]; // parent[i] < i, its label is already final
+
+			labelData[i] = l;
+			float strokeWidth = StrokeWidthTransform::strokeWidth(sw[x]);
+			ComponentStatistics& s = provisional[l];
+			s.minX = std::min(s.minX, x);
+			s.minY = std::min(s.minY, y);
+			s.maxX = std::max(s.maxX, x);
+			s.maxY = std::max(s.maxY, y);
+			s.pixelCount++;
+			s.strokeWidthSum += strokeWidth;
+			s.strokeWidthSquareSum += (double) strokeWidth * strokeWidth;
+			s.strokeWidthMax = std::max(s.strokeWidthMax, strokeWidth);
+			s.colorSum[0] += bgr[3 * x];
+			s.colorSum[1] += bgr[3 * x + 1];
+			s.colorSum[2] += bgr[3 * x + 2];
+			s.graySum += gray[x];
+		}
+	}
+
+	// discard single pixels (they have no similar neighbor) and compact the labels
+	std::vector<int> finalLabel(provisional.size(), -2);
+	statistics.clear();
+	strokeWidthOffsets.assign(1, 0);
+	for (size_t l = 0; l < provisional.size(); l++)
+	{
+		if (provisional[l].pixelCount < 2)
+			continue;
+		finalLabel[l] = statistics.size();
+		statistics.push_back(provisional[l]);
+		strokeWidthOffsets.push_back(strokeWidthOffsets.back() + provisional[l].pixelCount);
+	}
+
+	// relabel and collect the stroke widths of every component
+	strokeWidths.resize(strokeWidthOffsets.back());
+	std::vector<int> position(strokeWidthOffsets.begin(), strokeWidthOffsets.end() - 1);
+	for (int y = 0; y < rows; y++)
+	{
+		const T* sw = swtmap.ptr<T>(y);
+		for (int x = 0, i = y * cols; x < cols; x++, i++)
+		{
+			if (labelData[i] < 0)
+				continue;
+			int l = finalLabel[labelData[i]];
+			labelData[i] = l;
+			if (l >= 0)
+				strokeWidths[position[l]++] = StrokeWidthTransform::strokeWidth(sw[x]);
+		}
+	}
+
+	return statistics.size();
+}
+
+template <typename T>
+void ConnectedComponentLabeling::labelBand(const cv::Mat& swtmap, const cv::Mat& image, const cv::Mat& grayImage, int* parent, int rowStart, int rowEnd) const
+{
+	const int cols = swtmap.cols;
+	for (int y = rowStart; y < rowEnd; y++)
+	{
+		const T* sw = swtmap.ptr<T>(y);
+		const T* swUp = (y > rowStart) ? swtmap.ptr<T>(y - 1) : 0;
+		for (int x = 0, i = y * cols; x < cols; x++, i++)
+		{
+			parent[i] = i;
+			if (sw[x] == 0)
+				continue;
+
+			// already visited neighbors: left, upper left, upper, upper right
+			float strokeWidth = StrokeWidthTransform::strokeWidth(sw[x]);
+			if (x > 0 && sw[x - 1] != 0 && similar(image, grayImage, strokeWidth, StrokeWidthTransform::strokeWidth(sw[x - 1]), x, y, x - 1, y))
+				unite(parent, i, i - 1);
+			if (swUp != 0)
+				for (int nx = std::max(0, x - 1); nx <= std::min(cols - 1, x + 1); nx++)
+					if (swUp[nx] != 0 && similar(image, grayImage, strokeWidth, StrokeWidthTransform::strokeWidth(swUp[nx]), x, y, nx, y - 1))
+						unite(parent, i, i - cols + nx - x);
+		}
+	}
+}
+
+bool ConnectedComponentLabeling::similar(const cv::Mat& image, const cv::Mat& grayImage, float sw1, float sw2, int x1, int y1, int x2, int y2) const
+{
+	float swMax = std::max(sw1, sw2);
+	float swMin = std::min(sw1, sw2);
+
+	// do the pixels have similar strokewidth?
+	if (swMax <= swCompareParameter_ * swMin)
+		return true;
+	if (swMax > 1.5 * swCompareParameter_ * swMin)
+		return false;
+
+	// slightly different stroke width is accepted for pixels with similar intensity and color
+	double mean1[4], mean2[4];
+	localMean(image, grayImage, x1, y1, mean1);
+	localMean(image, grayImage, x2, y2, mean2);
+	for (int c = 0; c < 4; c++)
+		if (fabs(mean1[c] - mean2[c]) >= colorCompareParameter_)
+			return false;
+	return true;
+}
+
+void ConnectedComponentLabeling::localMean(const cv::Mat& image, const cv::Mat& grayImage, int x, int y, double* mean) const
+{
+	mean[0] = mean[1] = mean[2] = mean[3] = 0.;
+	int count = 0;
+	for (int my = std::max(0, y - 1); my <= std::min(image.rows - 1, y + 1); my++)
+	{
+		const uchar* bgr = image.ptr<uchar>(my);
+		const uchar* gray = grayImage.ptr<uchar>(my);
+		for (int mx = std::max(0, x - 1); mx <= std::min(image.cols - 1, x + 1); mx++)
+		{
+			mean[0] += gray[mx];
+			mean[1] += bgr[3 * mx];
+			mean[2] += bgr[3 * mx + 1];
+			mean[3] += bgr[3 * mx + 2];
+			count++;
+		}
+	}
+	for (int c = 0; c < 4; c++)
+		mean[c] /= count;
+}
@@ -0,0 +1,266 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * Trie index for the dictionary lookup of the spell check.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/dictionary_index.h>
+
+#include <algorithm>
+#include <limits>
+
+DictionaryIndex::DictionaryIndex() :
+	maxWordLength_(0), penalty_(1.f), correlationAdmissible_(true)
+{
+	nodes_.push_back(Node(0));
+}
+
+void DictionaryIndex::build(const std::vector<std::string>& words)
+{
+	nodes_.clear();
+	terminals_.clear();
+	nodes_.push_back(Node(0));
+	maxWordLength_ = 0;
+
+	for (size_t w = 0; w < words.size(); w++)
+	{
+		int node = 0;
+		for (size_t c = 0; c < words[w].length(); c++)
+		{
+			unsigned char letter = words[w][c];
+
+			// children are sorted by letter
+			int previous = -1;
+			int child = nodes_[node].firstChild;
+			while (child != -1 && nodes_[child].letter < letter)
+			{
+				previous = child;
+				child = nodes_[child].nextSibling;
+			}
+			if (child == -1 || nodes_[child].letter != letter)
+			{
+				Node newNode(letter);
+				newNode.nextSibling = child;
+				nodes_.push_back(newNode);
+				child = nodes_.size() - 1;
+				if (previous == -1)
+					nodes_[node].firstChild = child;
+				else
+					nodes_[previous].nextSibling = child;
+			}
+			node = child;
+		}
+
+		if (nodes_[node].terminal == -1)
+		{
+			nodes_[node].terminal = terminals_.size();
+			terminals_.push_back(std::vector<int>());
+		}
+		terminals_[nodes_[node].terminal].push_back(w);
+		maxWordLength_ = std::max(maxWordLength_, (int)words[w].length());
+	}
+
+	// breadth first order: the children of a node are stored next to each other, which keeps the search cache friendly
+	std::vector<Node> ordered;
+	ordered.reserve(nodes_.size());
+	ordered.push_back(nodes_[0]);
+	for (size_t node = 0; node < ordered.size(); node++)
+	{
+		int child = ordered[node].firstChild;
+		ordered[node].firstChild = ordered.size();
+		for (; child != -1; child = nodes_[child].nextSibling)
+		{
+			ordered.push_back(nodes_[child]);
+			ordered.back().nextSibling = -1;
+			ordered[node].numberChildren++;
+		}
+	}
+	nodes_.swap(ordered);
+
+	// word lengths below every node, children always have a larger index than their parent
+	for (int node = nodes_.size() - 1; node >= 0; node--)
+	{
+		int minRemaining = (nodes_[node].terminal != -1) ? 0 : maxWordLength_;
+		int maxRemaining = 0;
+		for (int child = nodes_[node].firstChild; child < nodes_[node].firstChild + nodes_[node].numberChildren; child++)
+		{
+			minRemaining = std::min(minRemaining, nodes_[child].minRemaining + 1);
+			maxRemaining = std::max(maxRemaining, nodes_[child].maxRemaining + 1);
+		}
+		nodes_[node].minRemaining = minRemaining;
+		nodes_[node].maxRemaining = maxRemaining;
+	}
+}
+
+void DictionaryIndex::setCorrelation(const cv::Mat& correlation, float penalty)
+{
+	penalty_ = penalty;
+	correlationAdmissible_ = (penalty >= 0.f);
+	correlation_.assign(256 * 256, 0.f);
+	for (int dictionaryLetter = 1; dictionaryLetter < 128; dictionaryLetter++)
+		for (int wordLetter = 1; wordLetter < 128; wordLetter++)
+		{
+			float c = correlation.at<float>(dictionaryLetter, wordLetter);
+			correlation_[dictionaryLetter * 256 + wordLetter] = c;
+			correlationAdmissible_ = correlationAdmissible_ && (c <= 1.f);
+		}
+
+	// '-' in the word is a wildcard
+	for (int dictionaryLetter = 0; dictionaryLetter < 256; dictionaryLetter++)
+		correlation_[dictionaryLetter * 256 + (unsigned char)'-'] = 1.f;
+}
+
+void DictionaryIndex::search(const std::string& word, int k, bool useCorrelation, float maxScore, std::vector<Match>& matches) const
+{
+	matches.clear();
+	if (k <= 0)
+		return;
+
+	Search search;
+	search.word = &word;
+	search.correlation = (useCorrelation && !correlation_.empty()) ? &correlation_[0] : 0;
+	search.penalty = useCorrelation ? penalty_ : 1.f;
+	search.prune = !useCorrelation || correlationAdmissible_;
+	search.k = k;
+	search.matches = &matches;
+
+	// column of the root: distance of every prefix of word to the empty string
+	int n = word.length();
+	search.columns.resize((maxWordLength_ + 1) * (n + 1));
+	for (int i = 0; i <= n; i++)
+		search.columns[i] = i;
+
+	// the k-th best score is unknown at the beginning, so the search starts with a small score limit, which prunes most
+	// of the trie, and widens the limit until k words are found: all words that were not found score worse
+	float scoreLimit = search.prune ? std::min(1.f, maxScore) : maxScore;
+	while (true)
+	{
+		search.maxScore = scoreLimit;
+		matches.clear();
+		searchChildren(0, 0, search);
+		if ((int)matches.size() == k || scoreLimit >= maxScore)
+			break;
+		scoreLimit = std::min(2.f * scoreLimit, maxScore);
+	}
+}
+
+void DictionaryIndex::searchChildren(int node, int depth, Search& search) const
+{
+	const std::string& word = *search.word;
+	const int n = word.length();
+	const float* previous = &search.columns[depth * (n + 1)];
+	float* current = &search.columns[(depth + 1) * (n + 1)];
+
+	const int childrenEnd = nodes_[node].firstChild + nodes_[node].numberChildren;
+	for (int child = nodes_[node].firstChild; child < childrenEnd; child++)
+	{
+		// next column of the edit distance matrix: d[i][depth+1], same arithmetic as DetectText::editDistanceFont
+		const Node& childNode = nodes_[child];
+		unsigned char letter = childNode.letter;
+		current[0] = depth + 1;
+		for (int i = 1; i <= n; i++)
+		{
+			unsigned char wordLetter = word[i - 1];
+			float v = previous[i - 1];
+			if (letter != wordLetter)
+			{
+				float correlate = (search.correlation != 0) ? search.correlation[letter * 256 + wordLetter] : 0.f;
+				v = v + 1 - correlate;
+			}
+			current[i] = std::min(std::min(current[i - 1] + search.penalty, previous[i] + search.penalty), v);
+		}
+
+		if (childNode.terminal != -1)
+		{
+			const std::vector<int>& wordIndices = terminals_[childNode.terminal];
+			for (size_t w = 0; w < wordIndices.size(); w++)
+				insertMatch(Match(wordIndices[w], current[n]), search);
+		}
+
+		if (childNode.numberChildren == 0)
+			continue;
+
+		// lower bound for all words below: from d[i][depth+1] at least |remaining word letters - remaining dictionary letters|
+		// insertions or deletions are needed (up to rounding: the wildcard step v + 1 - 1 may end slightly below v, hence the tolerance)
+		if (search.prune)
+		{
+			float lowerBound = std::numeric_limits<float>::max();
+			for (int i = 0; i <= n; i++)
+			{
+				int remaining = n - i;
+				int lengthDifference = std::max(0, std::max(childNode.minRemaining - remaining, remaining - childNode.maxRemaining));
+				lowerBound = std::min(lowerBound, current[i] + search.penalty * lengthDifference);
+			}
+
+			const float tolerance = 1e-3f;
+			if (lowerBound > search.maxScore + tolerance)
+				continue;
+			if ((int)search.matches->size() == search.k && lowerBound > search.matches->back().score + tolerance)
+				continue;
+		}
+		searchChildren(child, depth + 1, search);
+	}
+}
+
+void DictionaryIndex::insertMatch(const Match& match, Search& search) const
+{
+	std::vector<Match>& matches = *search.matches;
+	if (match.score >= search.maxScore)
+		return;
+
+	// sorted by score, equal scores by position in the word list
+	std::vector<Match>::iterator it = matches.begin();
+	while (it != matches.end() && (it->score < match.score || (it->score == match.score && it->wordIndex < match.wordIndex)))
+		++it;
+	if (it - matches.begin() >= search.k)
+		return;
+	matches.insert(it, match);
+	if ((int)matches.size() > search.k)
+		matches.pop_back();
+}
@@ -0,0 +1,183 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * Edit distance kernels of the spell check.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/edit_distance.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+EditDistance::EditDistance() :
+	penalty_(1.f)
+{
+	memset(patternMasks_, 0, sizeof(patternMasks_));
+}
+
+void EditDistance::setCorrelation(const cv::Mat& correlation, float penalty)
+{
+	penalty_ = penalty;
+	correlation_.assign(256 * 256, 0.f);
+	for (int dictionaryLetter = 1; dictionaryLetter < 128; dictionaryLetter++)
+		for (int wordLetter = 1; wordLetter < 128; wordLetter++)
+			correlation_[dictionaryLetter * 256 + wordLetter] = correlation.at<float>(dictionaryLetter, wordLetter);
+
+	// '-' in the word is a wildcard
+	for (int dictionaryLetter = 0; dictionaryLetter < 256; dictionaryLetter++)
+		correlation_[dictionaryLetter * 256 + (unsigned char)'-'] = 1.f;
+}
+
+int EditDistance::levenshtein(const std::string& s, const std::string& t)
+{
+	const std::string& shorter = (s.length() <= t.length()) ? s : t;
+	const std::string& longer = (s.length() <= t.length()) ? t : s;
+	int n = shorter.length();
+	int m = longer.length();
+
+	if (n == 0)
+		return m;
+	if (n <= 64)
+		return levenshteinBitParallel(shorter, longer);
+
+	// two rows of the matrix d[j][i] (j: letters of longer, i: letters of shorter)
+	rows_.resize(2 * (n + 1));
+	int* previous = &rows_[0];
+	int* current = &rows_[n + 1];
+	for (int i = 0; i <= n; i++)
+		previous[i] = i;
+	for (int j = 1; j <= m; j++)
+	{
+		char tc = longer[j - 1];
+		current[0] = j;
+		for (int i = 1; i <= n; i++)
+		{
+			int v = previous[i - 1];
+			if (shorter[i - 1] != tc)
+				v++;
+			current[i] = std::min(std::min(previous[i] + 1, current[i - 1] + 1), v);
+		}
+		std::swap(previous, current);
+	}
+	return previous[n];
+}
+
+int EditDistance::levenshteinBitParallel(const std::string& pattern, const std::string& text)
+{
+	// Myers (1999), in the formulation of Hyyrö (2001): bit i of the vertical deltas pv/mv is set if
+	// d[i+1][j] - d[i][j] is +1/-1, one column of the matrix is computed with a few word operations
+	const int n = pattern.length();
+	for (int i = 0; i < n; i++)
+		patternMasks_[(unsigned char)pattern[i]] |= (boost::uint64_t)1 << i;
+
+	const boost::uint64_t last = (boost::uint64_t)1 << (n - 1);
+	boost::uint64_t pv = (n == 64) ? ~(boost::uint64_t)0 : (((boost::uint64_t)1 << n) - 1);
+	boost::uint64_t mv = 0;
+	int score = n;
+	for (size_t j = 0; j < text.length(); j++)
+	{
+		boost::uint64_t eq = patternMasks_[(unsigned char)text[j]];
+		boost::uint64_t xv = eq | mv;
+		boost::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		boost::uint64_t ph = mv | ~(xh | pv);
+		boost::uint64_t mh = pv & xh;
+		if (ph & last)
+			score++;
+		else if (mh & last)
+			score--;
+		// the first row d[0][j] = j grows by one in every column
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+	}
+
+	for (int i = 0; i < n; i++)
+		patternMasks_[(unsigned char)pattern[i]] = 0;
+	return score;
+}
+
+float EditDistance::fontDistance(const std::string& word, const std::string& dictionaryWord)
+{
+	const int n = word.length();
+	const int m = dictionaryWord.length();
+
+	if (n == 0)
+		return m;
+	if (m == 0)
+		return n;
+
+	// two rows of the matrix d[i][j] (i: letters of word, j: letters of dictionaryWord)
+	const float* correlation = correlation_.empty() ? 0 : &correlation_[0];
+	fontRows_.resize(2 * (m + 1));
+	float* previous = &fontRows_[0];
+	float* current = &fontRows_[m + 1];
+	for (int j = 0; j <= m; j++)
+		previous[j] = j;
+
+	for (int i = 1; i <= n; i++)
+	{
+		current[0] = i;
+		unsigned char wordLetter = word[i - 1];
+		for (int j = 1; j <= m; j++)
+		{
+			unsigned char letter = dictionaryWord[j - 1];
+			float v = previous[j - 1];
+			if (letter != wordLetter)
+			{
+				float correlate = (correlation != 0) ? correlation[letter * 256 + wordLetter] : 0.f;
+				v = v + 1 - correlate;
+			}
+			current[j] = std::min(std::min(previous[j] + penalty_, current[j - 1] + penalty_), v);
+		}
+		std::swap(previous, current);
+	}
+	return previous[m];
+}
@@ -0,0 +1,157 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * LRU cache of OCR results keyed by a perceptual hash of the text patches.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/ocr_cache.h>
+
+#include "cv.h"
+
+#include <algorithm>
+#include <cmath>
+
+OcrResultCache::OcrResultCache(unsigned int capacity, int maxDistance) :
+	capacity_(capacity), maxDistance_(maxDistance), hits_(0), misses_(0)
+{
+}
+
+OcrResultCache::Key OcrResultCache::hash(const cv::Mat& patch)
+{
+	Key key;
+	for (int i = 0; i < 4; i++)
+		key.bits[i] = 0;
+	key.aspectRatio = 0.f;
+	if (patch.empty())
+		return key;
+	key.aspectRatio = patch.cols / (float)patch.rows;
+
+	cv::Mat gray, small;
+	if (patch.channels() == 3)
+		cv::cvtColor(patch, gray, CV_BGR2GRAY);
+	else
+		gray = patch;
+	cv::resize(gray, small, cv::Size(33, 8), 0, 0, cv::INTER_AREA);
+
+	for (int y = 0; y < 8; y++)
+	{
+		const uchar* row = small.ptr<uchar>(y);
+		for (int x = 0; x < 32; x++)
+		{
+			int bit = y * 32 + x;
+			if (row[x + 1] > row[x])
+				key.bits[bit / 64] |= (boost::uint64_t)1 << (bit % 64);
+		}
+	}
+	return key;
+}
+
+bool OcrResultCache::find(const Key& key, std::string& text, float& score)
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	std::list<Entry>::iterator best = entries_.end();
+	int bestDistance = maxDistance_ + 1;
+	for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+	{
+		if (std::fabs(it->key.aspectRatio - key.aspectRatio) >= 0.1f * std::max(it->key.aspectRatio, key.aspectRatio))
+			continue;
+		int d = distance(it->key, key);
+		if (d < bestDistance)
+		{
+			bestDistance = d;
+			best = it;
+		}
+	}
+
+	if (best == entries_.end())
+	{
+		misses_++;
+		return false;
+	}
+	hits_++;
+	text = best->text;
+	score = best->score;
+	entries_.splice(entries_.begin(), entries_, best);
+	return true;
+}
+
+void OcrResultCache::insert(const Key& key, const std::string& text, float score)
+{
+	if (capacity_ == 0)
+		return;
+	boost::mutex::scoped_lock lock(mutex_);
+	Entry entry;
+	entry.key = key;
+	entry.text = text;
+	entry.score = score;
+	entries_.push_front(entry);
+	if (entries_.size() > capacity_)
+		entries_.pop_back();
+}
+
+unsigned long OcrResultCache::hits()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return hits_;
+}
+
+unsigned long OcrResultCache::misses()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	return misses_;
+}
+
+int OcrResultCache::distance(const Key& a, const Key& b)
+{
+	int d = 0;
+	for (int i = 0; i < 4; i++)
+		for (boost::uint64_t x = a.bits[i] ^ b.bits[i]; x != 0; x &= x - 1)
+			d++;
+	return d;
+}
@@ -0,0 +1,197 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * Pool of in-process Tesseract engines for reading text patches.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/ocr_engine.h>
+
+#include <ros/ros.h>
+#include <ros/package.h>
+
+#include "cv.h"
+
+#include <tesseract/baseapi.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+OcrEnginePool::OcrEnginePool() :
+	failed_(false)
+{
+}
+
+OcrEnginePool::OcrEnginePool(const OcrEnginePool& other) :
+	failed_(false)
+{
+}
+
+OcrEnginePool::~OcrEnginePool()
+{
+	release();
+}
+
+OcrEnginePool& OcrEnginePool::operator=(const OcrEnginePool& other)
+{
+	if (this != &other)
+		release();
+	return *this;
+}
+
+bool OcrEnginePool::init(unsigned int numberEngines, const std::string& language, const std::string& config)
+{
+	// loading the language data again would fail again
+	if (failed_)
+		return false;
+
+	release();
+
+	const std::string tessdataPrefix = getTessdataPrefix();
+	for (unsigned int i = 0; i < numberEngines; i++)
+	{
+		tesseract::TessBaseAPI* engine = new tesseract::TessBaseAPI();
+
+		// language data and config are read from the same directory
+		if (engine->Init(tessdataPrefix.c_str(), language.c_str(), tesseract::OEM_DEFAULT) != 0)
+		{
+			ROS_ERROR("OcrEnginePool::init: Cannot initialize tesseract with language %s from %stessdata.", language.c_str(), tessdataPrefix.c_str());
+			delete engine;
+			release();
+			failed_ = true;
+			return false;
+		}
+
+		if (!config.empty() && !readConfig(engine, tessdataPrefix, config))
+			ROS_WARN("OcrEnginePool::init: Cannot read tesseract config %s, using default settings.", config.c_str());
+
+		engine->SetPageSegMode(tesseract::PSM_SINGLE_LINE); // was: tesseract -psm 7
+
+		engines_.push_back(engine);
+	}
+
+	ROS_INFO("OcrEnginePool::init: Initialized %u tesseract engine(s) with language %s.", (unsigned int) engines_.size(), language.c_str());
+	return true;
+}
+
+bool OcrEnginePool::failed() const
+{
+	return failed_;
+}
+
+unsigned int OcrEnginePool::size() const
+{
+	return engines_.size();
+}
+
+std::string OcrEnginePool::recognize(unsigned int engineIndex, const cv::Mat& patch)
+{
+	assert(engineIndex < engines_.size());
+
+	// tesseract expects RGB (the tiff files written before were RGB as well)
+	cv::Mat image;
+	if (patch.channels() == 3)
+		cv::cvtColor(patch, image, CV_BGR2RGB);
+	else
+		image = patch;
+
+	tesseract::TessBaseAPI* engine = engines_[engineIndex];
+	engine->SetImage(image.data, image.cols, image.rows, image.channels(), image.step);
+
+	std::string text;
+	char* utf8Text = engine->GetUTF8Text();
+	if (utf8Text != NULL)
+	{
+		text = utf8Text;
+		delete[] utf8Text;
+	}
+	engine->Clear();
+
+	return text;
+}
+
+void OcrEnginePool::release()
+{
+	for (unsigned int i = 0; i < engines_.size(); i++)
+	{
+		engines_[i]->End();
+		delete engines_[i];
+	}
+	engines_.clear();
+}
+
+std::string OcrEnginePool::getTessdataPrefix()
+{
+	// $TESSDATA_PREFIX like tesseract, default is the install prefix of cob_tesseract
+	const char* tessdataPrefixEnv = getenv("TESSDATA_PREFIX");
+	if (tessdataPrefixEnv != NULL)
+		return tessdataPrefixEnv;
+	return ros::package::getPath("cob_tesseract") + "/share/";
+}
+
+bool OcrEnginePool::readConfig(tesseract::TessBaseAPI* engine, const std::string& tessdataPrefix, const std::string& config)
+{
+	std::ifstream fin((tessdataPrefix + "tessdata/configs/" + config).c_str());
+	if (!fin.is_open())
+		return false;
+
+	std::string line;
+	while (std::getline(fin, line))
+	{
+		std::stringstream ss(line);
+		std::string name, value;
+		if (!(ss >> name) || name[0] == '#')
+			continue;
+		std::getline(ss >> std::ws, value);
+		if (!engine->SetVariable(name.c_str(), value.c_str()))
+			ROS_WARN("OcrEnginePool::readConfig: Unknown tesseract variable %s.", name.c_str());
+	}
+	return true;
+}
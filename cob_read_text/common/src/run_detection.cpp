@@ -1,23 +1,83 @@
 #include <cob_read_text/text_detect.h>
 #include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+// images of a list, taken one after the other by the detection workers
+struct BatchQueue
+{
+  BatchQueue() :
+    next(0), processed(0)
+  {
+  }
+
+  boost::mutex mutex;
+  std::vector<std::string> images;
+  size_t next; // index of the next image to detect
+  size_t processed;
+  DetectionStatistics statistics; // summed over all processed images
+};
+
+// every worker has its own detector (own tesseract engines and working images)
+void detectionWorker(DetectText detector, BatchQueue& queue)
+{
+  while (true)
+  {
+    std::string image;
+    {
+      boost::mutex::scoped_lock lock(queue.mutex);
+      if (queue.next == queue.images.size())
+        return;
+      image = queue.images[queue.next++];
+    }
+
+    detector.detect(image);
+
+    boost::mutex::scoped_lock lock(queue.mutex);
+    queue.statistics.add(detector.getStatistics());
+    queue.processed++;
+  }
+}
+
+// image paths of a list file, one per line, relative paths are relative to the directory of the list
+bool readImageList(const std::string& filename, std::vector<std::string>& images)
+{
+  std::ifstream fin(filename.c_str());
+  if (!fin.is_open())
+    return false;
+  std::string directory = filename.substr(0, filename.find_last_of("/") + 1);
+  std::string line;
+  while (std::getline(fin, line))
+  {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (line.empty() || line[0] == '#')
+      continue;
+    images.push_back(line[0] == '/' ? line : directory + line);
+  }
+  return true;
+}
 
 int main(int argc, char* argv[])
 {
   if (argc < 4)
   {
-    std::cout << "not enought input: detect_text <image> <correlation> <dictionary>" << std::endl;
+    std::cout << "not enought input: detect_text <image or image list (.txt)> <correlation> <dictionary> [eval] [OCRoff] [workers=<n>]" << std::endl;
     return -1;
   }
 
   bool eval = false;
-  if (argc > 4)
-    if ((std::string)argv[4] == "eval")
-      eval = true;
-
   bool enableOCR = true;
-  if (argc > 5)
-	  if ((std::string)argv[5] == "OCRoff")
-		  enableOCR = false;
+  int numberWorkers = 1; // 0 = one per cpu core, always 1 with debug windows
+  for (int i = 4; i < argc; i++)
+  {
+    std::string option = argv[i];
+    if (option == "eval")
+      eval = true;
+    else if (option == "OCRoff")
+      enableOCR = false;
+    else if (option.compare(0, 8, "workers=") == 0)
+      numberWorkers = atoi(option.substr(8).c_str());
+  }
 
   DetectText detector = DetectText(eval, enableOCR);
   detector.readLetterCorrelation(argv[2]);
@@ -26,7 +86,44 @@ int main(int argc, char* argv[])
   ros::init(argc, argv, "run_detection");
   ros::NodeHandle nh;
   detector.setParams(nh);
-  detector.detect(std::string(argv[1]));
+
+  std::string input = argv[1];
+  if (input.length() < 4 || input.substr(input.length() - 4) != ".txt")
+  {
+    detector.detect(input);
+    ros::shutdown();
+    return 0;
+  }
+
+  // batch mode: all images of the list, each worker thread with its own copy of the detector
+  BatchQueue queue;
+  if (!readImageList(input, queue.images))
+  {
+    std::cout << "Cannot read image list " << input << std::endl;
+    return -1;
+  }
+  numberWorkers = std::min<int>(resolveNumberThreads(numberWorkers), std::max<int>(1, queue.images.size()));
+  // debug windows (cv::imshow/cv::waitKey) must not be opened from several threads
+  if (detector.showsDebugWindows() && numberWorkers > 1)
+  {
+    std::cout << "Debug windows are enabled, detecting with a single worker" << std::endl;
+    numberWorkers = 1;
+  }
+  // the workers share the cpu cores instead of each starting one OCR, tile and ransac thread per core
+  detector.divideThreads(numberWorkers);
+
+  StageTimer timer;
+  parallelTasks(numberWorkers, boost::bind(&detectionWorker, detector, boost::ref(queue)));
+  double seconds = timer.elapsed();
+
+  // throughput and mean stage times and counts per image
+  std::cout << std::endl << "Processed " << queue.processed << " images with " << numberWorkers << " workers in " << seconds << " s: "
+      << queue.processed / std::max(seconds, 1e-9) << " images/s" << std::endl;
+  double n = std::max<double>(1., queue.processed);
+  for (int s = 0; s < DetectionStatistics::NUMBER_STAGES; s++)
+    std::cout << "  " << DetectionStatistics::stageName(s) << ": " << queue.statistics.seconds[s] / n << " s per image" << std::endl;
+  for (int c = 0; c < DetectionStatistics::NUMBER_COUNTERS; c++)
+    std::cout << "  " << DetectionStatistics::counterName(c) << ": " << queue.statistics.counts[c] / n << " per image" << std::endl;
 
   ros::shutdown();
 
@@ -0,0 +1,352 @@
+/*!
+ *****************************************************************
+ * \file
+ *
+ * \note
+ * Copyright (c) 2012 \n
+ * Fraunhofer Institute for Manufacturing Engineering
+ * and Automation (IPA) \n\n
+ *
+ *****************************************************************
+ *
+ * \note
+ * Project name: cob_read_text
+ * \note
+ * ROS stack name: cob_object_perception
+ * \note
+ * ROS package name: cob_read_text
+ *
+ * \brief
+ * Tile-parallel stroke width transform.
+ *
+ *****************************************************************
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer. \n
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution. \n
+ * - Neither the name of the Fraunhofer Institute for Manufacturing
+ * Engineering and Automation (IPA) nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission. \n
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License LGPL as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License LGPL for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License LGPL along with this program.
+ * If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <cob_read_text/stroke_width_transform.h>
+#include <cob_read_text/parallel_rows.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+// stroke width in pixels as element of a stroke width map
+template <typename T>
+T encodeStrokeWidth(float strokeWidth);
+
+template <>
+inline float encodeStrokeWidth<float>(float strokeWidth)
+{
+	return strokeWidth;
+}
+
+template <>
+inline unsigned short encodeStrokeWidth<unsigned short>(float strokeWidth)
+{
+	return (unsigned short)std::min(strokeWidth * StrokeWidthTransform::STROKE_WIDTH_SCALE + 0.5f, 65535.f);
+}
+
+// border index of cv::BORDER_REFLECT_101, the default border of cv::Sobel
+inline int reflect101(int i, int n)
+{
+	if (i < 0)
+		return std::min(-i, n - 1);
+	if (i >= n)
+		return std::max(2 * n - 2 - i, 0);
+	return i;
+}
+}
+
+StrokeWidthTransform::StrokeWidthTransform() :
+	maxStrokeWidth_(0), initialStrokeWidth_(0.f), tanCompareGradient_(0.), numberThreads_(1)
+{
+}
+
+StrokeWidthTransform::StrokeWidthTransform(int maxStrokeWidth, float initialStrokeWidth, double compareGradientParameter, int numberThreads) :
+	maxStrokeWidth_(maxStrokeWidth), initialStrokeWidth_(initialStrokeWidth), tanCompareGradient_(tan(compareGradientParameter)),
+	numberThreads_(resolveNumberThreads(numberThreads))
+{
+}
+
+void StrokeWidthTransform::setGradients(const cv::Mat& edgemap, cv::Mat& dx, cv::Mat& dy)
+{
+	edgemap_ = edgemap;
+	gradientX_ = dx;
+	gradientY_ = dy;
+	gradients_.release();
+	parallelRows(rowBands(dx.rows, numberThreads_), boost::bind(&StrokeWidthTransform::normalizeGradients, this, _1, _2));
+}
+
+void StrokeWidthTransform::setGradients(const cv::Mat& edgemap, const cv::Mat& grayImage, cv::Mat& gradients)
+{
+	edgemap_ = edgemap;
+	gradients.create(grayImage.size(), CV_16SC2);
+	gradients_ = gradients;
+	gradientX_.release();
+	gradientY_.release();
+	parallelRows(rowBands(grayImage.rows, numberThreads_), boost::bind(&StrokeWidthTransform::packGradients, this, boost::cref(grayImage), _1, _2));
+}
+
+void StrokeWidthTransform::compute(int searchDirection, cv::Mat& swtmap, int type) const
+{
+	if (type == CV_16UC1)
+		computeMap<unsigned short>(searchDirection, swtmap);
+	else
+		computeMap<float>(searchDirection, swtmap);
+}
+
+void StrokeWidthTransform::toPixels(const cv::Mat& swtmap, cv::Mat& strokeWidths)
+{
+	swtmap.convertTo(strokeWidths, CV_32FC1, swtmap.type() == CV_16UC1 ? 1. / STROKE_WIDTH_SCALE : 1.);
+}
+
+template <typename T>
+void StrokeWidthTransform::computeMap(int searchDirection, cv::Mat& swtmap) const
+{
+	swtmap.create(edgemap_.size(), cv::DataType<T>::type);
+	swtmap.setTo(cv::Scalar(encodeStrokeWidth<T>(initialStrokeWidth_)));
+
+	// a ray moves at most maxStrokeWidth-1 rows away from its edge pixel
+	std::vector<int> borders = rowBands(edgemap_.rows, numberThreads_);
+	std::vector<Tile> tiles(borders.size() - 1);
+	for (size_t t = 0; t < tiles.size(); t++)
+	{
+		tiles[t].rowStart = borders[t];
+		tiles[t].rowEnd = borders[t + 1];
+		tiles[t].haloStart = std::max(0, borders[t] - maxStrokeWidth_);
+		tiles[t].haloEnd = std::min(edgemap_.rows, borders[t + 1] + maxStrokeWidth_);
+	}
+
+	// update: stroke width = ray length
+	parallelTasks(tiles.size(), boost::bind(&StrokeWidthTransform::castRays<T>, this, searchDirection, boost::ref(tiles), _1));
+	parallelRows(borders, boost::bind(&StrokeWidthTransform::mergeTiles<T>, this, boost::cref(tiles), boost::ref(swtmap), _1, _2));
+
+	// refine: stroke width = median along the ray, the medians are taken from the complete update result
+	parallelTasks(tiles.size(), boost::bind(&StrokeWidthTransform::refineRays<T>, this, boost::cref(swtmap), boost::ref(tiles), _1));
+	parallelRows(borders, boost::bind(&StrokeWidthTransform::mergeTiles<T>, this, boost::cref(tiles), boost::ref(swtmap), _1, _2));
+}
+
+void StrokeWidthTransform::normalizeGradients(int rowStart, int rowEnd)
+{
+	for (int y = rowStart; y < rowEnd; y++)
+	{
+		float* gxRow = gradientX_.ptr<float>(y);
+		float* gyRow = gradientY_.ptr<float>(y);
+		for (int x = 0; x < gradientX_.cols; x++)
+		{
+			float magnitude = std::sqrt(gxRow[x] * gxRow[x] + gyRow[x] * gyRow[x]);
+			float scale = (magnitude > 0.f) ? 1.f / magnitude : 0.f;
+			gxRow[x] *= scale;
+			gyRow[x] *= scale;
+		}
+	}
+}
+
+void StrokeWidthTransform::packGradients(const cv::Mat& grayImage, int rowStart, int rowEnd)
+{
+	// like cv::Sobel on a region of interest: the neighbours outside the region are read from the whole image,
+	// only the border of the whole image is reflected (rows and columns relative to the region, may be -1 or rows/cols)
+	cv::Size wholeSize;
+	cv::Point offset;
+	grayImage.locateROI(wholeSize, offset);
+	const int cols = grayImage.cols;
+	for (int y = rowStart; y < rowEnd; y++)
+	{
+		const uchar* up = grayImage.data + (reflect101(offset.y + y - 1, wholeSize.height) - offset.y) * (ptrdiff_t)grayImage.step;
+		const uchar* row = grayImage.ptr<uchar>(y);
+		const uchar* down = grayImage.data + (reflect101(offset.y + y + 1, wholeSize.height) - offset.y) * (ptrdiff_t)grayImage.step;
+		short* gradientRow = gradients_.ptr<short>(y);
+		for (int x = 0; x < cols; x++)
+		{
+			int left = reflect101(offset.x + x - 1, wholeSize.width) - offset.x, right = reflect101(offset.x + x + 1, wholeSize.width) - offset.x;
+			int gx = (up[right] + 2 * row[right] + down[right]) - (up[left] + 2 * row[left] + down[left]);
+			int gy = (down[left] + 2 * down[x] + down[right]) - (up[left] + 2 * up[x] + up[right]);
+			float magnitude = std::sqrt((float)(gx * gx + gy * gy));
+			float scale = (magnitude > 0.f) ? GRADIENT_ONE / magnitude : 0.f;
+			gradientRow[2 * x] = (short)floor(gx * scale + 0.5f);
+			gradientRow[2 * x + 1] = (short)floor(gy * scale + 0.5f);
+		}
+	}
+}
+
+inline void StrokeWidthTransform::gradientAt(int i, float& gx, float& gy) const
+{
+	if (gradients_.empty())
+	{
+		gx = ((const float*)gradientX_.data)[i];
+		gy = ((const float*)gradientY_.data)[i];
+	}
+	else
+	{
+		const short* gradient = (const short*)gradients_.data + 2 * i;
+		gx = gradient[0] * (1.f / GRADIENT_ONE);
+		gy = gradient[1] * (1.f / GRADIENT_ONE);
+	}
+}
+
+template <typename T>
+void StrokeWidthTransform::castRays(int searchDirection, std::vector<Tile>& tiles, int tileIndex) const
+{
+	const int rows = edgemap_.rows;
+	const int cols = edgemap_.cols;
+	const int fixedShift = 16; // ray positions in 16.16 fixed point
+	const int fixedHalf = 1 << (fixedShift - 1);
+
+	Tile& tile = tiles[tileIndex];
+	tile.strokeWidths.create(tile.haloEnd - tile.haloStart, cols, cv::DataType<T>::type);
+	tile.strokeWidths.setTo(cv::Scalar(encodeStrokeWidth<T>(initialStrokeWidth_)));
+	T* strokeWidths = tile.strokeWidths.ptr<T>(0) - tile.haloStart * cols; // indexed with global pixel indices
+	const uchar* edges = edgemap_.ptr<uchar>(0);
+
+	std::vector<int> ray;
+	for (int iy = tile.rowStart; iy < tile.rowEnd; iy++)
+	{
+		const uchar* edgeRow = edgemap_.ptr<uchar>(iy);
+		for (int ix = 0; ix < cols; ix++)
+		{
+			if (edgeRow[ix] != 255)
+				continue;
+
+			int start = iy * cols + ix;
+			float gx, gy;
+			gradientAt(start, gx, gy);
+
+			// direction of the ray, atan2(0,0) = 0 pointed along x for a vanishing gradient
+			int stepX = (gx == 0.f && gy == 0.f) ? searchDirection << fixedShift : (int)floor(gx * searchDirection * (1 << fixedShift) + 0.5f);
+			int stepY = (int)floor(gy * searchDirection * (1 << fixedShift) + 0.5f);
+			int fixedX = (ix << fixedShift) + fixedHalf; // + 0.5 to round to the nearest pixel
+			int fixedY = (iy << fixedShift) + fixedHalf;
+
+			ray.clear();
+			ray.push_back(start);
+			int currX = ix, currY = iy;
+			bool isStroke = false;
+			for (int step = 1; step < maxStrokeWidth_;)
+			{
+				// going one pixel in the direction of the gradient to check if next pixel is also an edge
+				int nextX = (fixedX + step * stepX) >> fixedShift;
+				int nextY = (fixedY + step * stepY) >> fixedShift;
+				if (nextX < 0 || nextY < 0 || nextX >= cols || nextY >= rows)
+					break;
+
+				step++;
+
+				if (currX == nextX && currY == nextY)
+					continue;
+
+				currX = nextX;
+				currY = nextY;
+				int current = currY * cols + currX;
+				ray.push_back(current);
+
+				// search in 5-neighborhood for suitable counter edge points
+				if (std::abs(currX - ix) < 2 && std::abs(currY - iy) < 2)
+					continue;
+				bool foundEdgePoint = edges[current] == 255 || (currX > 0 && edges[current - 1] == 255) || (currX < cols - 1 && edges[current + 1] == 255)
+						|| (currY > 0 && edges[current - cols] == 255) || (currY < rows - 1 && edges[current + cols] == 255);
+				if (foundEdgePoint == false)
+					continue;
+
+				// if opposite point of stroke with roughly opposite gradient is found (gradient compared at the ray end pixel)
+				float endX, endY;
+				gradientAt(current, endX, endY);
+				double tn = gy * endX - gx * endY;
+				double td = gx * endX + gy * endY;
+				isStroke = (tn < -td * tanCompareGradient_ && tn > td * tanCompareGradient_);
+				break;
+			}
+
+			if (isStroke == false)
+				continue;
+
+			// set all pixels of the ray to its length except they are smaller because of another stroke
+			T newSwtVal = encodeStrokeWidth<T>(std::sqrt((float)((currY - iy) * (currY - iy) + (currX - ix) * (currX - ix))) + 0.5f);
+			for (size_t i = 0; i < ray.size(); i++)
+				strokeWidths[ray[i]] = std::min(strokeWidths[ray[i]], newSwtVal);
+
+			tile.rayPixels.insert(tile.rayPixels.end(), ray.begin(), ray.end());
+			tile.rayEnds.push_back(tile.rayPixels.size());
+		}
+	}
+}
+
+template <typename T>
+void StrokeWidthTransform::refineRays(const cv::Mat& swtmap, std::vector<Tile>& tiles, int tileIndex) const
+{
+	Tile& tile = tiles[tileIndex];
+	tile.strokeWidths.setTo(cv::Scalar(encodeStrokeWidth<T>(initialStrokeWidth_)));
+	T* strokeWidths = tile.strokeWidths.ptr<T>(0) - tile.haloStart * edgemap_.cols;
+	const T* swt = swtmap.ptr<T>(0);
+
+	std::vector<T> swtValues;
+	int rayStart = 0;
+	for (size_t r = 0; r < tile.rayEnds.size(); r++)
+	{
+		swtValues.clear();
+		for (int i = rayStart; i < tile.rayEnds[r]; i++)
+			swtValues.push_back(swt[tile.rayPixels[i]]);
+		std::nth_element(swtValues.begin(), swtValues.begin() + swtValues.size() / 2, swtValues.end());
+		T newSwtVal = swtValues[swtValues.size() / 2];
+
+		for (int i = rayStart; i < tile.rayEnds[r]; i++)
+			strokeWidths[tile.rayPixels[i]] = std::min(strokeWidths[tile.rayPixels[i]], newSwtVal);
+		rayStart = tile.rayEnds[r];
+	}
+}
+
+template <typename T>
+void StrokeWidthTransform::mergeTiles(const std::vector<Tile>& tiles, cv::Mat& swtmap, int rowStart, int rowEnd) const
+{
+	const T initialStrokeWidth = encodeStrokeWidth<T>(initialStrokeWidth_);
+	for (size_t t = 0; t < tiles.size(); t++)
+	{
+		const Tile& tile = tiles[t];
+		for (int y = std::max(rowStart, tile.haloStart); y < std::min(rowEnd, tile.haloEnd); y++)
+		{
+			const T* tileRow = tile.strokeWidths.ptr<T>(y - tile.haloStart);
+			T* swtRow = swtmap.ptr<T>(y);
+			for (int x = 0; x < swtmap.cols; x++)
+				swtRow[x] = std::min(swtRow[x], tileRow[x]);
+		}
+	}
+
+	// set initial unchanged value back to 0
+	for (int y = rowStart; y < rowEnd; y++)
+	{
+		T* swtRow = swtmap.ptr<T>(y);
+		for (int x = 0; x < swtmap.cols; x++)
+			if (swtRow[x] == initialStrokeWidth)
+				swtRow[x] = 0;
+	}
+}
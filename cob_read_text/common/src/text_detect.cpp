@@ -68,16 +68,40 @@
 
 #include <cob_read_text/text_detect.h>
 
+#include <climits>
+
 DetectText::DetectText()
 {
 	eval_ = false;
 	enableOCR_ = true;
+	parallelPasses_ = true;
+	ocrThreads_ = 0;
+	tileThreads_ = 0;
+	ransacThreads_ = 0;
+	pyramidLevels_ = 0;
+	compactMaps_ = false;
+	ocrCacheSize_ = 0;
+	ocrCacheMaxDistance_ = 8;
+	ocrSecondsPerBox_ = 0.;
+	partial_ = false;
+	mode_ = IMAGE;
 }
 
 DetectText::DetectText(bool eval, bool enableOCR)
 {
 	eval_ = eval;
 	enableOCR_ = enableOCR;
+	parallelPasses_ = true;
+	ocrThreads_ = 0;
+	tileThreads_ = 0;
+	ransacThreads_ = 0;
+	pyramidLevels_ = 0;
+	compactMaps_ = false;
+	ocrCacheSize_ = 0;
+	ocrCacheMaxDistance_ = 8;
+	ocrSecondsPerBox_ = 0.;
+	partial_ = false;
+	mode_ = IMAGE;
 }
 
 DetectText::~DetectText()
@@ -93,9 +117,10 @@ void DetectText::detect(std::string filename)
 	if (!originalImage_.data)
 	{
 		ROS_ERROR("Cannot read image input.");
+		clearResults(); // no results and statistics of the previous image
 		return;
 	}
-	//mode_ = IMAGE;
+	mode_ = IMAGE;
 	detect();
 }
 
@@ -104,10 +129,31 @@ void DetectText::detect(cv::Mat& image)
 	// Read image from topic
 	filename_ = std::string("streaming.jpg");
 	originalImage_ = image;
-	//mode_ = STREAM;
+	mode_ = STREAM;
 	detect();
 }
 
+void DetectText::detect(cv::Mat& image, ros::WallTime deadline)
+{
+	deadline_ = deadline;
+	detect(image);
+	deadline_ = ros::WallTime();
+}
+
+void DetectText::detect(cv::Mat& image, const std::vector<cv::Rect>& regionsOfInterest, ros::WallTime deadline)
+{
+	regionsOfInterest_ = regionsOfInterest;
+	detect(image, deadline);
+	regionsOfInterest_.clear();
+}
+
+void DetectText::detect(cv::Mat& image, const cv::Mat& mask, ros::WallTime deadline)
+{
+	regionMask_ = mask;
+	detect(image, deadline);
+	regionMask_ = cv::Mat();
+}
+
 void DetectText::readLetterCorrelation(const char* file)
 {
 	std::cout << std::endl;
@@ -121,6 +167,9 @@ void DetectText::readLetterCorrelation(const char* file)
 			assert(fin >> number);
 			correlation_.at<float> (i, j) = number;
 		}
+	float penalty = 0.7f; // cost of an insertion or deletion in the font edit distance
+	dictionaryIndex_.setCorrelation(correlation_, penalty);
+	editDistanceKernel_.setCorrelation(correlation_, penalty);
 }
 
 void DetectText::readWordList(const char* filename)
@@ -131,6 +180,7 @@ void DetectText::readWordList(const char* filename)
 	while (fin >> word)
 		wordList_.push_back(word);
 	assert(wordList_.size());
+	dictionaryIndex_.build(wordList_);
 	std::cout << "read in " << wordList_.size() << " words from " << std::string(filename) << std::endl;
 }
 
@@ -149,27 +199,74 @@ std::vector<cv::RotatedRect>& DetectText::getBoxes()
 	return finalBoxes_;
 }
 
+DetectionStatistics& DetectText::getStatistics()
+{
+	return statistics_;
+}
+
+bool DetectText::isPartial()
+{
+	return partial_;
+}
+
+bool DetectText::showsDebugWindows()
+{
+	for (std::map<std::string, bool>::iterator it = debug.begin(); it != debug.end(); ++it)
+		if (it->second)
+			return true;
+	return false;
+}
+
 void DetectText::detect()
 {
+	clearResults();
+	StageTimer timer;
+
 	if (processing_method_ == ORIGINAL_EPSHTEIN)
 		detect_original_epshtein();
 	else if (processing_method_ == BORMANN)
 		detect_bormann();
 	else
 		std::cout << "DetectText::detect: Error: Desired processing method is not implemented." << std::endl;
+
+	statistics_.seconds[DetectionStatistics::TOTAL] = timer.elapsed();
+	partial_ = statistics_.counts[DetectionStatistics::SKIPPED_BOXES] > 0;
+	if (partial_)
+		std::cout << "Deadline: " << statistics_.counts[DetectionStatistics::SKIPPED_BOXES] << " boxes skipped." << std::endl;
 }
 
-void DetectText::detect_original_epshtein()
+bool DetectText::deadlinePassed(double secondsNeeded) const
 {
-	// clear data fields
+	return !deadline_.isZero() && ros::WallTime::now() + ros::WallDuration(secondsNeeded) > deadline_;
+}
+
+void DetectText::clearResults()
+{
+	// results of the previous image, one instance may process many images (e.g. camera stream)
 	finalBoundingBoxes_.clear();
 	finalRotatedBoundingBoxes_.clear();
 	finalBoundingBoxesQualityScore_.clear();
+	boundingBoxes_.clear();
+	brightBoxes_.clear();
+	darkBoxes_.clear();
+	boxFontColor_.clear();
+	transformedImage_.clear();
+	transformedFlippedImage_.clear();
+	notTransformedImage_.clear();
+	textImages_.clear();
+	finalBoxes_.clear();
+	finalTexts_.clear();
+	finalScores_.clear();
+	statistics_.clear();
+}
 
+void DetectText::detect_original_epshtein()
+{
 	// start timer
 	double start_time;
 	double time_in_seconds;
 	start_time = std::clock();
+	StageTimer timer;
 
 	// Smooth image
 	if (smoothImage) // default: turned off
@@ -190,7 +287,7 @@ void DetectText::detect_original_epshtein()
 	}
 
 	// grayImage for SWT
-	grayImage_ = cv::Mat(originalImage_.size(), CV_8UC1, cv::Scalar(0));
+	grayImage_ = buffers_.get(BufferArena::GRAY_IMAGE, originalImage_.size(), CV_8UC1);
 	cv::cvtColor(originalImage_, grayImage_, CV_BGR2GRAY);
 
 	// Show image information
@@ -198,16 +295,12 @@ void DetectText::detect_original_epshtein()
 	std::cout << "Image: " << filename_ << std::endl;
 	std::cout << "Size:" << grayImage_.cols << " x " << grayImage_.rows << std::endl << std::endl;
 	preprocess();
+	statistics_.seconds[DetectionStatistics::PREPROCESS] = timer.restart();
 
-	// bright font
-	firstPass_ = true;
-	pipeline();
-	disposal();
-
-	// dark font
-	firstPass_ = false;
-	pipeline();
-	disposal();		// todo: check whether this harms any of the following processing
+	// bright and dark font
+	runPasses();
+	statistics_.counts[DetectionStatistics::BOXES] = finalBoundingBoxes_.size();
+	timer.restart();
 
 	std::cout << std::endl << "Found " << transformedImage_.size() << " boundingBoxes for OCR." << std::endl << std::endl;
 
@@ -246,8 +339,10 @@ void DetectText::detect_original_epshtein()
 
 			// binary image #2
 		}
+		statistics_.seconds[DetectionStatistics::OCR_PREPROCESS] += timer.restart();
 
 		ocrRead(textImages_);
+		statistics_.seconds[DetectionStatistics::OCR] = timer.restart();
 	}
 	else
 	{
@@ -263,7 +358,7 @@ void DetectText::detect_original_epshtein()
 	// Write results
 	if (eval_)
 		writeTxtsForEval();
-	else
+	else if (mode_ == IMAGE)
 		cv::imwrite(outputPrefix_ + "_detection.jpg", resultImage_);
 
 	// Show results
@@ -280,18 +375,14 @@ void DetectText::detect_original_epshtein()
 
 void DetectText::detect_bormann()
 {
-	// clear data fields
-	finalBoundingBoxes_.clear();
-	finalRotatedBoundingBoxes_.clear();
-	finalBoundingBoxesQualityScore_.clear();
-
 	// start timer
 	double start_time;
 	double time_in_seconds;
 	start_time = std::clock();
+	StageTimer timer;
 
 	// grayImage for SWT
-	grayImage_ = cv::Mat(originalImage_.size(), CV_8UC1, cv::Scalar(0));
+	grayImage_ = buffers_.get(BufferArena::GRAY_IMAGE, originalImage_.size(), CV_8UC1);
 	cv::cvtColor(originalImage_, grayImage_, CV_RGB2GRAY);
 
 	// Show image information
@@ -299,16 +390,12 @@ void DetectText::detect_bormann()
 	std::cout << "Image: " << filename_ << std::endl;
 	std::cout << "Size:" << grayImage_.cols << " x " << grayImage_.rows << std::endl << std::endl;
 	preprocess();
+	statistics_.seconds[DetectionStatistics::PREPROCESS] = timer.restart();
 
-	// bright font
-	firstPass_ = true;
-	pipeline();
-	disposal();
-
-	// dark font
-	firstPass_ = false;
-	pipeline();
-	disposal();		// todo: check whether this harms any of the following processing
+	// bright and dark font
+	runPasses();
+	statistics_.counts[DetectionStatistics::BOXES] = finalBoundingBoxes_.size();
+	timer.restart();
 
 	std::cout << std::endl << "Found " << transformedImage_.size() << " boundingBoxes for OCR." << std::endl << std::endl;
 
@@ -347,8 +434,10 @@ void DetectText::detect_bormann()
 
 			// binary image #2
 		}
+		statistics_.seconds[DetectionStatistics::OCR_PREPROCESS] += timer.restart();
 
 		ocrRead(textImages_);
+		statistics_.seconds[DetectionStatistics::OCR] = timer.restart();
 	}
 	else
 	{
@@ -364,7 +453,7 @@ void DetectText::detect_bormann()
 	// Write results
 	if (eval_)
 		writeTxtsForEval();
-	else
+	else if (mode_ == IMAGE)
 		cv::imwrite(outputPrefix_ + "_detection.jpg", resultImage_);
 
 	// Show results
@@ -381,11 +470,7 @@ void DetectText::detect_bormann()
 
 void DetectText::preprocess()
 {
-	if (processing_method_==ORIGINAL_EPSHTEIN)
-		maxStrokeWidth_ = maxStrokeWidthParameter * 640./(double)std::max(grayImage_.cols, grayImage_.rows);
-	else
-		maxStrokeWidth_ = round((std::max(grayImage_.cols, grayImage_.rows)) / (float) maxStrokeWidthParameter);
-	initialStrokeWidth_ = maxStrokeWidth_ * 2;
+	setSizeParameters(grayImage_.size());
 
 	// outputPrefix_: filename without extension
 	int slashIndex = -1;
@@ -400,57 +485,246 @@ void DetectText::preprocess()
 	outputPrefix_ = filename_.substr(slashIndex + 1, dotIndex - slashIndex - 1);
 
 	// add 600 pixel width to have space for displaying results
-	cv::Mat img1(originalImage_.rows, originalImage_.cols + 600, originalImage_.type(), cv::Scalar(0, 0, 0));
+	cv::Mat img1 = buffers_.get(BufferArena::RESULT_IMAGE, cv::Size(originalImage_.cols + 600, originalImage_.rows), originalImage_.type());
+	img1.setTo(cv::Scalar(0, 0, 0));
 	cv::Mat tmp = img1(cv::Rect(0, 0, originalImage_.cols, originalImage_.rows));
 	originalImage_.copyTo(tmp);
 	resultImage_ = img1; //.clone();
 }
 
-void DetectText::pipeline()
+void DetectText::setSizeParameters(cv::Size size)
 {
-	double start_time;
-	double time_in_seconds;
+	if (processing_method_==ORIGINAL_EPSHTEIN)
+		maxStrokeWidth_ = maxStrokeWidthParameter * 640./(double)std::max(size.width, size.height);
+	else
+		maxStrokeWidth_ = round((std::max(size.width, size.height)) / (float) maxStrokeWidthParameter);
+	initialStrokeWidth_ = maxStrokeWidth_ * 2;
+
+	// used by identifyLetters, todo: parameter
+	if (processing_method_ == ORIGINAL_EPSHTEIN)
+		minLetterHeight_ = 8;
+	else
+		minLetterHeight_ = std::max(10, 3 + (size.height)/480); //default: 10
+}
 
-	start_time = clock();
-	cv::Mat swtmap(grayImage_.size(), CV_32FC1, cv::Scalar(initialStrokeWidth_));
+void DetectText::runPasses()
+{
+	// every region of interest is processed like a separate image, the results are shifted to image coordinates
+	std::vector<cv::Rect> regions;
+	getRegions(regions);
+	statistics_.counts[DetectionStatistics::REGIONS] = regions.size();
+	cv::Mat image = originalImage_;
+	cv::Mat grayImage = grayImage_;
+	bool wholeImage = (regions.size() == 1 && regions[0].size() == image.size());
+	if (!wholeImage)
+	{
+		std::cout << "Processing " << regions.size() << " regions of interest." << std::endl;
+		ccmapBright_ = buffers_.get(BufferArena::CCMAP_FRAME_BRIGHT, image.size(), CV_32SC1);
+		ccmapDark_ = buffers_.get(BufferArena::CCMAP_FRAME_DARK, image.size(), CV_32SC1);
+		ccmapBright_.setTo(cv::Scalar(-2));
+		ccmapDark_.setTo(cv::Scalar(-2));
+	}
 
-	int searchDirection = 0;
-	if (firstPass_)
+	for (size_t r = 0; r < regions.size(); r++)
+	{
+		originalImage_ = image(regions[r]);
+		grayImage_ = grayImage(regions[r]);
+		runPasses(regions[r]);
+
+		if (wholeImage)
+		{
+			ccmapBright_ = ccmapBrightRegion_;
+			ccmapDark_ = ccmapDarkRegion_;
+		}
+		else
+		{
+			cv::Mat brightTarget = ccmapBright_(regions[r]), darkTarget = ccmapDark_(regions[r]);
+			ccmapBrightRegion_.copyTo(brightTarget);
+			ccmapDarkRegion_.copyTo(darkTarget);
+		}
+	}
+
+	originalImage_ = image;
+	grayImage_ = grayImage;
+}
+
+void DetectText::getRegions(std::vector<cv::Rect>& regions)
+{
+	cv::Rect image(0, 0, originalImage_.cols, originalImage_.rows);
+	regions.clear();
+	if (regionsOfInterest_.empty() && regionMask_.empty() && pyramidLevels_ <= 0)
 	{
-		std::cout << "--- Bright Font ---" << std::endl;
-		searchDirection = 1;
+		regions.push_back(image);
+		return;
+	}
+
+	// bounding boxes of the connected areas of the mask
+	std::vector<cv::Rect> requested = regionsOfInterest_;
+	if (!regionMask_.empty())
+	{
+		cv::Mat mask = (regionMask_ != 0); // findContours modifies its input
+		std::vector<std::vector<cv::Point> > contours;
+		cv::findContours(mask, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+		for (size_t i = 0; i < contours.size(); i++)
+			requested.push_back(cv::boundingRect(contours[i]));
+	}
+	else if (regionsOfInterest_.empty())
+		findCandidateRegions(requested);
+
+	// a margin of the maximum stroke width keeps the letters at the border of a region complete
+	for (size_t i = 0; i < requested.size(); i++)
+	{
+		cv::Rect region(requested[i].x - maxStrokeWidth_, requested[i].y - maxStrokeWidth_, requested[i].width + 2 * maxStrokeWidth_,
+				requested[i].height + 2 * maxStrokeWidth_);
+		region &= image;
+		if (region.area() > 0)
+			regions.push_back(region);
+	}
+
+	// overlapping regions are joined, otherwise text in the overlap would be found twice
+	bool joined = true;
+	while (joined)
+	{
+		joined = false;
+		for (size_t i = 0; i < regions.size() && !joined; i++)
+			for (size_t j = i + 1; j < regions.size() && !joined; j++)
+				if ((regions[i] & regions[j]).area() > 0)
+				{
+					regions[i] |= regions[j];
+					regions.erase(regions.begin() + j);
+					joined = true;
+				}
+	}
+}
+
+void DetectText::findCandidateRegions(std::vector<cv::Rect>& candidates)
+{
+	// pyramid mode: the chained letter boxes of the image downscaled by 2^pyramidLevels_ are the regions of interest
+	// of the full resolution image
+	cv::Mat image = originalImage_;
+	cv::Mat grayImage = grayImage_;
+	cv::Mat coarseImage = originalImage_, coarseGrayImage = grayImage_;
+	for (int level = 0; level < pyramidLevels_; level++)
+	{
+		cv::pyrDown(coarseImage, coarseImage);
+		cv::pyrDown(coarseGrayImage, coarseGrayImage);
+	}
+	int scale = 1 << pyramidLevels_;
+	originalImage_ = coarseImage;
+	grayImage_ = coarseGrayImage;
+	setSizeParameters(coarseImage.size());
+
+	PassContext brightPass(BRIGHT);
+	PassContext darkPass(DARK);
+	brightPass.candidatesOnly = darkPass.candidatesOnly = true;
+	processPasses(cv::Rect(0, 0, coarseImage.cols, coarseImage.rows), brightPass, darkPass);
+
+	// upscaled boxes, one coarse pixel more on every side for the rounding of pyrDown
+	for (int p = 0; p < 2; p++)
+	{
+		const std::vector<cv::Rect>& boxes = (p == 0) ? brightPass.finalBoundingBoxes : darkPass.finalBoundingBoxes;
+		for (size_t i = 0; i < boxes.size(); i++)
+			candidates.push_back(cv::Rect((boxes[i].x - 1) * scale, (boxes[i].y - 1) * scale, (boxes[i].width + 2) * scale, (boxes[i].height + 2) * scale));
+	}
+
+	originalImage_ = image;
+	grayImage_ = grayImage;
+	setSizeParameters(image.size());
+}
+
+void DetectText::runPasses(const cv::Rect& region)
+{
+	PassContext brightPass(BRIGHT);
+	PassContext darkPass(DARK);
+	processPasses(region, brightPass, darkPass);
+
+	// merge in the same order as the serial processing would have produced the results
+	mergePassResults(brightPass, region.tl());
+	fontColorIndex_ = transformedImage_.size();
+	mergePassResults(darkPass, region.tl());
+
+	ccmapBrightRegion_ = brightPass.ccmap;
+	ccmapDarkRegion_ = darkPass.ccmap;
+}
+
+void DetectText::processPasses(const cv::Rect& region, PassContext& brightPass, PassContext& darkPass)
+{
+	// edges, gradients and integral images are shared by both passes
+	StageTimer timer;
+	computeGradients(region);
+	cv::Size integralSize(originalImage_.cols + 1, originalImage_.rows + 1);
+	colorIntegral_ = buffers_.get(BufferArena::COLOR_INTEGRAL, integralSize, CV_64FC3);
+	grayIntegral_ = buffers_.get(BufferArena::GRAY_INTEGRAL, integralSize, CV_64FC1);
+	cv::integral(originalImage_, colorIntegral_, CV_64F);
+	cv::integral(grayImage_, grayIntegral_, CV_64F);
+	statistics_.seconds[DetectionStatistics::EDGE_MAP] += timer.restart();
+	statistics_.counts[DetectionStatistics::EDGE_POINTS] += cv::countNonZero(edgemap_);
+
+	int swtType = compactMaps_ ? CV_16UC1 : CV_32FC1;
+	brightPass.swtmap = buffers_.get(BufferArena::SWT_BRIGHT, originalImage_.size(), swtType);
+	darkPass.swtmap = buffers_.get(BufferArena::SWT_DARK, originalImage_.size(), swtType);
+	brightPass.ccmap = buffers_.get(BufferArena::CCMAP_BRIGHT, originalImage_.size(), CV_32SC1);
+	darkPass.ccmap = buffers_.get(BufferArena::CCMAP_DARK, originalImage_.size(), CV_32SC1);
+
+	// debug windows (cv::imshow/cv::waitKey) must not be opened from several threads
+	if (parallelPasses_ && !showsDebugWindows())
+	{
+		// dark font pass in a worker thread, bright font pass in this thread
+		boost::thread darkThread(boost::bind(&DetectText::pipeline, this, boost::ref(darkPass)));
+		pipeline(brightPass);
+		darkThread.join();
 	}
 	else
 	{
-		std::cout << "--- Dark Font ---" << std::endl;
-		searchDirection = -1;
+		pipeline(brightPass);
+		pipeline(darkPass);
 	}
+	statistics_.add(brightPass.statistics);
+	statistics_.add(darkPass.statistics);
+}
 
-	strokeWidthTransform(grayImage_, swtmap, searchDirection);
-	time_in_seconds = (clock() - start_time) / (double) CLOCKS_PER_SEC;
-	std::cout << "[" << time_in_seconds << " s] in strokeWidthTransform" << std::endl;
+void DetectText::pipeline(PassContext& pass)
+{
+	// the passes may run concurrently, so the output of each pass is collected and printed at once
+	std::stringstream log;
+	DetectionStatistics& statistics = pass.statistics;
+	double time_in_seconds;
 
-	start_time = clock();
-	cv::Mat ccmap(grayImage_.size(), CV_32FC1, cv::Scalar(-1));
-	labeledRegions_.clear();
-	nComponent_ = connectComponentAnalysis(swtmap, ccmap);
-	time_in_seconds = (clock() - start_time) / (double) CLOCKS_PER_SEC;
-	std::cout << "[" << time_in_seconds << " s] in connectComponentAnalysis: " << nComponent_ << " components found" << std::endl;
+	StageTimer timer;
+	if (pass.fontColor == BRIGHT)
+		log << "--- Bright Font ---" << std::endl;
+	else
+		log << "--- Dark Font ---" << std::endl;
 
-	start_time = clock();
-	identifyLetters(swtmap, ccmap);
-	time_in_seconds = (clock() - start_time) / (double) CLOCKS_PER_SEC;
-	std::cout << "[" << time_in_seconds << " s] in identifyLetters: " << nLetter_ << " letters found" << std::endl;
+	strokeWidthTransform(pass.swtmap, pass.searchDirection);
+	time_in_seconds = statistics.seconds[DetectionStatistics::STROKE_WIDTH_TRANSFORM] = timer.restart();
+	log << "[" << time_in_seconds << " s] in strokeWidthTransform" << std::endl;
 
-	start_time = clock();
-	groupLetters(swtmap, ccmap);
-	time_in_seconds = (clock() - start_time) / (double) CLOCKS_PER_SEC;
-	std::cout << "[" << time_in_seconds << " s] in groupLetters: " << letterGroups_.size() << " groups found" << std::endl;
+	pass.nComponent = connectComponentAnalysis(pass);
+	time_in_seconds = statistics.seconds[DetectionStatistics::CONNECT_COMPONENTS] = timer.restart();
+	statistics.counts[DetectionStatistics::COMPONENTS] = pass.nComponent;
+	log << "[" << time_in_seconds << " s] in connectComponentAnalysis: " << pass.nComponent << " components found" << std::endl;
 
-	start_time = clock();
-	std::vector<cv::Rect> boundingBoxes = chainPairs();
-	time_in_seconds = (clock() - start_time) / (double) CLOCKS_PER_SEC;
-	std::cout << "[" << time_in_seconds << " s] in chainPairs: " << boundingBoxes.size() << " chains found" << std::endl;
+	identifyLetters(pass);
+	time_in_seconds = statistics.seconds[DetectionStatistics::IDENTIFY_LETTERS] = timer.restart();
+	statistics.counts[DetectionStatistics::LETTERS] = pass.nLetter;
+	log << "[" << time_in_seconds << " s] in identifyLetters: " << pass.nLetter << " letters found" << std::endl;
+
+	groupLetters(pass);
+	time_in_seconds = statistics.seconds[DetectionStatistics::GROUP_LETTERS] = timer.restart();
+	statistics.counts[DetectionStatistics::PAIRS] = pass.letterGroups.size();
+	log << "[" << time_in_seconds << " s] in groupLetters: " << pass.letterGroups.size() << " groups found" << std::endl;
+
+	std::vector<cv::Rect> boundingBoxes = chainPairs(pass);
+	time_in_seconds = statistics.seconds[DetectionStatistics::CHAIN_PAIRS] = timer.restart();
+	log << "[" << time_in_seconds << " s] in chainPairs: " << boundingBoxes.size() << " chains found" << std::endl;
+
+	if (pass.candidatesOnly)
+	{
+		pass.finalBoundingBoxes = boundingBoxes;
+		std::cout << log.str();
+		return;
+	}
 
 	//  start_time = clock();
 	//  combineNeighborBoxes(boundingBoxes);
@@ -458,43 +732,67 @@ void DetectText::pipeline()
 	//  std::cout << "[" << time_in_seconds << " s] in combineNeighborBoxes: " << boundingBoxes.size() << " chains remain"
 	//      << std::endl;
 
-	if (firstPass_)
-		ccmapBright_ = ccmap.clone();
-	else
-		ccmapDark_ = ccmap.clone();
-
 	if (processing_method_==ORIGINAL_EPSHTEIN)
 	{
 		// some feasibility checks
 //		start_time = clock();
-//		filterBoundingBoxes(boundingBoxes, ccmap, boundingBoxFilterParameter); // filters boxes based on height and width -> makes no sense when text is rotated
+//		filterBoundingBoxes(pass, boundingBoxes, boundingBoxFilterParameter); // filters boxes based on height and width -> makes no sense when text is rotated
 //		time_in_seconds = (clock() - start_time) / (double)CLOCKS_PER_SEC;
 //		std::cout << "[" << time_in_seconds << " s] in filterBoundingBoxes: " << boundingBoxes.size() << " boundingBoxes found" << std::endl;
 
 		// separating several lines of text
 		std::vector<cv::RotatedRect> lineEquations;
-		start_time = clock();
-		breakLines(boundingBoxes, lineEquations);
-		time_in_seconds = (clock() - start_time) / (double)CLOCKS_PER_SEC;
-		std::cout << "[" << time_in_seconds << " s] in breakLines: " << boundingBoxes.size() << " boundingBoxes after breaking blocks into lines" << std::endl << std::endl;
-		// after this block the indices between boundingBoxes and connectedComponents_ do not correspond anymore!
+		breakLines(pass, boundingBoxes, lineEquations);
+		time_in_seconds = timer.restart();
+		statistics.seconds[DetectionStatistics::BREAK_LINES] += time_in_seconds;
+		log << "[" << time_in_seconds << " s] in breakLines: " << boundingBoxes.size() << " boundingBoxes after breaking blocks into lines" << std::endl << std::endl;
+		// after this block the indices between boundingBoxes and pass.connectedComponents do not correspond anymore!
 
 		// separate words on a single line
-		start_time = clock();
 		std::vector<double> qualityScore;
-		breakLinesIntoWords(boundingBoxes, lineEquations, qualityScore);
-		time_in_seconds = (clock() - start_time) / (double)CLOCKS_PER_SEC;
-		std::cout << "[" << time_in_seconds << " s] in breakLinesIntoWords: " << boundingBoxes.size() << " boundingBoxes after breaking blocks into lines" << std::endl << std::endl;
+		breakLinesIntoWords(pass, boundingBoxes, lineEquations, qualityScore);
+		time_in_seconds = timer.restart();
+		statistics.seconds[DetectionStatistics::BREAK_LINES] += time_in_seconds;
+		log << "[" << time_in_seconds << " s] in breakLinesIntoWords: " << boundingBoxes.size() << " boundingBoxes after breaking blocks into lines" << std::endl << std::endl;
 
 		// write found bounding boxes into the respective structures
 		for (unsigned int i=0; i<boundingBoxes.size(); i++)
 		{
-			finalBoundingBoxes_.push_back(boundingBoxes[i]);
-			finalRotatedBoundingBoxes_.push_back(cv::RotatedRect(cv::Point2f(boundingBoxes[i].x+0.5*boundingBoxes[i].width, boundingBoxes[i].y+0.5*boundingBoxes[i].height),
+			pass.finalBoundingBoxes.push_back(boundingBoxes[i]);
+			pass.finalRotatedBoundingBoxes.push_back(cv::RotatedRect(cv::Point2f(boundingBoxes[i].x+0.5*boundingBoxes[i].width, boundingBoxes[i].y+0.5*boundingBoxes[i].height),
 					cv::Size2f(boundingBoxes[i].width, boundingBoxes[i].height), 0.f));
-			finalBoundingBoxesQualityScore_.push_back(qualityScore[i]);
+			pass.finalBoundingBoxesQualityScore.push_back(qualityScore[i]);
 		}
+	}
+	else
+	{
+		ransacPipeline(pass, boundingBoxes);
+		time_in_seconds = timer.restart();
+		// ransacPipeline already added the time of transformBezier to OCR_PREPROCESS
+		statistics.seconds[DetectionStatistics::BREAK_LINES] = time_in_seconds - statistics.seconds[DetectionStatistics::OCR_PREPROCESS];
+		log << "[" << time_in_seconds << " s] in Ransac and Bezier: " << pass.transformedImage.size() << " boundingBoxes remain" << std::endl;
+	}
+
+	std::cout << log.str();
+}
+
+void DetectText::mergePassResults(PassContext& pass, cv::Point offset)
+{
+	// region coordinates -> image coordinates
+	for (size_t i = 0; i < pass.finalBoundingBoxes.size(); i++)
+	{
+		pass.finalBoundingBoxes[i] += offset;
+		pass.finalRotatedBoundingBoxes[i].center += cv::Point2f(offset.x, offset.y);
+	}
+
+	finalBoundingBoxes_.insert(finalBoundingBoxes_.end(), pass.finalBoundingBoxes.begin(), pass.finalBoundingBoxes.end());
+	finalRotatedBoundingBoxes_.insert(finalRotatedBoundingBoxes_.end(), pass.finalRotatedBoundingBoxes.begin(), pass.finalRotatedBoundingBoxes.end());
+	finalBoundingBoxesQualityScore_.insert(finalBoundingBoxesQualityScore_.end(), pass.finalBoundingBoxesQualityScore.begin(), pass.finalBoundingBoxesQualityScore.end());
+	transformedImage_.insert(transformedImage_.end(), pass.transformedImage.begin(), pass.transformedImage.end());
+	notTransformedImage_.insert(notTransformedImage_.end(), pass.notTransformedImage.begin(), pass.notTransformedImage.end());
 
+	if (processing_method_==ORIGINAL_EPSHTEIN)
+	{
 		// filter boxes that lie completely inside others
 		for (int i=(int)finalBoundingBoxes_.size()-1; i>=0; i--)
 		{
@@ -513,53 +811,40 @@ void DetectText::pipeline()
 			}
 		}
 	}
-	else
-	{
-		start_time = clock();
-		ransacPipeline(boundingBoxes);
-		time_in_seconds = (clock() - start_time) / (double) CLOCKS_PER_SEC;
-
-		if (firstPass_)
-		{
-			std::cout << "[" << time_in_seconds << " s] in Ransac and Bezier: " << transformedImage_.size() << " boundingBoxes remain" << std::endl;
-			fontColorIndex_ = transformedImage_.size();
-		}
-		else
-			std::cout << "[" << time_in_seconds << " s] in Ransac and Bezier: " << transformedImage_.size() - fontColorIndex_ << " boundingBoxes remain" << std::endl;
-	}
 }
 
-void DetectText::strokeWidthTransform(const cv::Mat& image, cv::Mat& swtmap, int searchDirection)
+void DetectText::computeGradients(const cv::Rect& region)
 {
-	// Calculate edges and gradients
-	if (firstPass_)
-	{
-		// compute edge map
-		edgemap_ = computeEdgeMap(useColorEdge);
-		//closeOutline(edgemap_);
-
-		// compute partial derivatives
-		Sobel(grayImage_, dx_, CV_32FC1, 1, 0, 3);
-		Sobel(grayImage_, dy_, CV_32FC1, 0, 1, 3);
-
-		theta_ = cv::Mat::zeros(grayImage_.size(), CV_32FC1);
+	// compute edge map
+	edgemap_ = computeEdgeMap(useColorEdge);
+	//closeOutline(edgemap_);
 
-		edgepoints_.clear();
+	// with a mask only the edges inside the mask start stroke width rays
+	if (!regionMask_.empty())
+		edgemap_.setTo(cv::Scalar(0), regionMask_(region) == 0);
 
-		for (int y = 0; y < edgemap_.rows; y++)
-			for (int x = 0; x < edgemap_.cols; x++)
-				if (edgemap_.at<unsigned char>(y, x) == 255) // In case (x,y) is an edge
-				{
-					theta_.at<float>(y, x) = atan2(dy_.at<float>(y, x), dx_.at<float>(y, x)); //rise = arctan dy/dx
-					edgepoints_.push_back(cv::Point(x, y)); //Save edge as point in edgepoints
-				}
+	swtEngine_ = StrokeWidthTransform(maxStrokeWidth_, initialStrokeWidth_, compareGradientParameter_, tileThreads_);
 
+	// compute partial derivatives
+	if (compactMaps_)
+	{
+		// Sobel and normalization in one pass into a packed gradient map
+		dx_ = buffers_.get(BufferArena::GRADIENT_X, grayImage_.size(), CV_16SC2);
+		dy_.release();
+		swtEngine_.setGradients(edgemap_, grayImage_, dx_);
+		return;
 	}
+	dx_ = buffers_.get(BufferArena::GRADIENT_X, grayImage_.size(), CV_32FC1);
+	dy_ = buffers_.get(BufferArena::GRADIENT_Y, grayImage_.size(), CV_32FC1);
+	Sobel(grayImage_, dx_, CV_32FC1, 1, 0, 3);
+	Sobel(grayImage_, dy_, CV_32FC1, 0, 1, 3);
+	swtEngine_.setGradients(edgemap_, dx_, dy_);
+}
 
-	// Second Pass (SWT is not performed again):
-	std::vector<cv::Point> strokePoints;
-	updateStrokeWidth(swtmap, edgepoints_, strokePoints, searchDirection, UPDATE);
-	updateStrokeWidth(swtmap, strokePoints, strokePoints, searchDirection, REFINE);
+void DetectText::strokeWidthTransform(cv::Mat& swtmap, int searchDirection)
+{
+	// Edges and gradients have been computed once for both passes in computeGradients()
+	swtEngine_.compute(searchDirection, swtmap, swtmap.type());
 
 	// todo: reactivate
 //	cv::Mat temp;
@@ -567,6 +852,41 @@ void DetectText::strokeWidthTransform(const cv::Mat& image, cv::Mat& swtmap, int
 //	cv::erode(temp, swtmap, cv::Mat(), cv::Point(-1, -1), 2);
 //	cv::dilate(swtmap, temp, cv::Mat());
 //	swtmap = temp;
+
+	if (debug["showSWT"])
+	{
+		cv::Mat output(originalImage_.size(), CV_8UC3);
+		cv::Mat strokeWidths;
+		StrokeWidthTransform::toPixels(swtmap, strokeWidths);
+		for (int y = 0; y < swtmap.rows; y++)
+			for (int x = 0; x < swtmap.cols; x++)
+			{
+				double val = (strokeWidths.at<float>(y, x)==0.f ? 255. : 5*strokeWidths.at<float>(y, x));
+				cv::rectangle(output, cv::Rect(x, y, 1, 1), cv::Scalar(val, val, val), 1, 1, 0);
+			}
+
+		if (searchDirection == 1)
+		{
+			cv::imshow("SWT-map for bright font", output);
+			cvMoveWindow("SWT-map for bright font", 0, 0);
+			cv::waitKey(0);
+			//cv::erode(output, output, cv::Mat());
+			//cv::dilate(output, output, cv::Mat());
+			//cv::imshow("eroded bright swt", output);
+			//cvMoveWindow("eroded bright swt", 0, 0);
+			//swtmap = output;
+		}
+		else
+		{
+			cv::imshow("SWT-map for dark font", output);
+			cvMoveWindow("SWT-map for dark font", 0, 0);
+			cv::waitKey(0);
+			// cv::erode(output, output, cv::Mat());
+			// cv::dilate(output, output, cv::Mat());
+			// cv::imshow("eroded dark swt", output);
+			// cvMoveWindow("eroded dark swt", 0, 0);
+		}
+	}
 }
 
 cv::Mat DetectText::computeEdgeMap(bool rgbCanny)
@@ -574,7 +894,7 @@ cv::Mat DetectText::computeEdgeMap(bool rgbCanny)
 	//  cannyThreshold1 = 120; // default: 120
 	//  cannyThreshold2 = 50; // default: 50 , cannyThreshold1 > cannyThreshold2
 
-	cv::Mat edgemap;
+	cv::Mat edgemap = buffers_.get(BufferArena::EDGE_MAP, grayImage_.size(), CV_8UC1);
 	// cv::blur(grayImage_, edgemap, cv::Size(3, 3));
 	cv::Canny(grayImage_, edgemap, cannyThreshold2, cannyThreshold1);
 
@@ -664,152 +984,6 @@ cv::Mat DetectText::computeEdgeMap(bool rgbCanny)
 	return edgemap;
 }
 
-void DetectText::updateStrokeWidth(cv::Mat& swtmap, std::vector<cv::Point>& startPoints, std::vector<cv::Point>& strokePoints, int searchDirection, Purpose purpose)
-{
-	std::vector<cv::Point> pointStack;
-	std::vector<float> SwtValues;
-
-	int offsetX5[] = {0, -1, 1, 0, 0};
-	int offsetY5[] = {0, 0, 0, -1, 1};
-	int offsetX9[] = {0, -1, 1, -1, 0, 1, -1, 0, 1};
-	int offsetY9[] = {0, 0, 0, -1, -1, -1, 1, 1, 1};
-
-	// Loop through all edgepoints, compute stroke width
-	for (std::vector<cv::Point>::iterator itr = startPoints.begin(); itr != startPoints.end(); ++itr)
-	{
-		pointStack.clear();
-		SwtValues.clear();
-		float step = 1;
-		float ix = (*itr).x;
-		float iy = (*itr).y;
-		float currX = ix;
-		float currY = iy;
-		bool isStroke = false;
-		float iTheta = theta_.at<float>(*itr);
-		double ciTheta = cos(iTheta);
-		double siTheta = sin(iTheta);
-
-		pointStack.push_back(cv::Point(currX, currY));
-		SwtValues.push_back(swtmap.at<float>(currY, currX));
-		while (step < maxStrokeWidth_)
-		{
-			//going one pixel in the direction of the gradient to check if next pixel is also an edge
-			float nextX = round(ix + ciTheta * searchDirection * step);
-			float nextY = round(iy + siTheta * searchDirection * step);
-
-			if (nextX < 0 || nextY < 0 || nextX >= edgemap_.cols || nextY >= edgemap_.rows)
-				break;
-
-			step++;
-
-			if (currX == nextX && currY == nextY)
-				continue;
-
-			currX = nextX;
-			currY = nextY;
-
-			pointStack.push_back(cv::Point(currX, currY));
-			SwtValues.push_back(swtmap.at<float>(currY, currX));
-
-			bool foundEdgePoint = false;
-			// search in 5-neighborhood for suitable counter edge points
-			if (fabs(currX-ix)>=2.f || fabs(currY-iy)>=2.f)
-			{
-				for (int k=0; k<5; k++)
-				{
-					if (edgemap_.at<unsigned char>(currY+offsetY5[k], currX+offsetX5[k]) == 255)
-					{
-						foundEdgePoint = true;
-						break;
-					}
-				}
-			}
-
-			if (foundEdgePoint == true)
-			{
-				for (int k=0; k<9; k++)
-				{
-				//	float jTheta = theta_.at<float>(currY+offsetY9[k], currX+offsetX9[k]);
-					//if opposite point of stroke with roughly opposite gradient is found...
-					//double dTheta = abs(iTheta - jTheta);std::min(dTheta, 3.14159265359-dTheta)
-					//std::cout << iTheta << " " << jTheta << " " << fmod(jTheta+M_PI,2*M_PI) << " " << fabs(iTheta-fmod(jTheta+M_PI,2*M_PI)) << std::endl;
-					//getchar();
-					//if (fabs(iTheta-fmod(jTheta+M_PI,2*M_PI)) < compareGradientParameter_) // paper: abs(abs(iTheta - jTheta) - 3.14) < 3.14 / 6
-//					double t = tan(iTheta-jTheta);
-//					if (-1 / sqrt(3) < t && t < 1 / sqrt(3))
-					double tn = dy_.at<float>(iy,ix)*dx_.at<float>(currY+offsetY9[k],currX+offsetX9[k]) - dx_.at<float>(iy,ix)*dy_.at<float>(currY+offsetY9[k],currX+offsetX9[k]);
-					double td = dx_.at<float>(iy,ix)*dx_.at<float>(currY+offsetY9[k],currX+offsetX9[k]) + dy_.at<float>(iy,ix)*dy_.at<float>(currY+offsetY9[k],currX+offsetX9[k]);
-					if (tn < -td*tan(compareGradientParameter_) && tn > td*tan(compareGradientParameter_))
-					{
-						isStroke = true;
-						if (purpose == UPDATE)
-							strokePoints.push_back(cv::Point(ix, iy));
-					}
-					break;
-				}
-			}
-			if (foundEdgePoint == true)
-				break;
-		}
-
-		// ... then calculate newSwtVal for all cv::Points between the two stroke points
-		if (isStroke)
-		{
-			float newSwtVal;
-			if (purpose == UPDATE)// update swt based on dist between edges
-				newSwtVal = (sqrt((currY - iy) * (currY - iy) + (currX - ix) * (currX - ix)) + 0.5);
-			else if (purpose == REFINE) // refine swt based on median
-			{
-				nth_element(SwtValues.begin(), SwtValues.begin() + SwtValues.size() / 2, SwtValues.end());
-				newSwtVal = SwtValues[SwtValues.size() / 2];
-			}
-
-			// set all cv::Points between to the newSwtVal except they are smaller because of another stroke
-			for (size_t i = 0; i < pointStack.size(); i++)
-				swtmap.at<float>(pointStack[i]) = std::min(swtmap.at<float>(pointStack[i]), newSwtVal);
-		}
-	} // end loop through edge points
-
-	// set initial upchanged value back to 0
-	for (int y = 0; y < swtmap.rows; y++)
-		for (int x = 0; x < swtmap.cols; x++)
-			if (swtmap.at<float> (y, x) == initialStrokeWidth_)
-				swtmap.at<float> (y, x) = 0;						// todo: check whether this may cause problems when grouping
-
-	if (debug["showSWT"] && purpose == REFINE)
-	{
-		cv::Mat output(originalImage_.size(), CV_8UC3);
-		for (int y = 0; y < swtmap.rows; y++)
-			for (int x = 0; x < swtmap.cols; x++)
-			{
-				double val = (swtmap.at<float>(y, x)==0.f ? 255. : 5*swtmap.at<float>(y, x));
-				cv::rectangle(output, cv::Rect(x, y, 1, 1), cv::Scalar(val, val, val), 1, 1, 0);
-			}
-
-		if (searchDirection == 1)
-		{
-			cv::imshow("SWT-map for bright font", output);
-			cvMoveWindow("SWT-map for bright font", 0, 0);
-			cv::waitKey(0);
-			//cv::erode(output, output, cv::Mat());
-			//cv::dilate(output, output, cv::Mat());
-			//cv::imshow("eroded bright swt", output);
-			//cvMoveWindow("eroded bright swt", 0, 0);
-			//swtmap = output;
-		}
-		else
-		{
-			cv::imshow("SWT-map for dark font", output);
-			cvMoveWindow("SWT-map for dark font", 0, 0);
-			cv::waitKey(0);
-			// cv::erode(output, output, cv::Mat());
-			// cv::dilate(output, output, cv::Mat());
-			// cv::imshow("eroded dark swt", output);
-			// cvMoveWindow("eroded dark swt", 0, 0);
-		}
-	}
-}
-
 void DetectText::closeOutline(cv::Mat& edgemap)
 {
 	cv::Mat temp = cv::Mat::zeros(edgemap.size(), edgemap.type());
@@ -842,213 +1016,48 @@ void DetectText::closeOutline(cv::Mat& edgemap)
 
 	edgemap = temp;
 }
-
-int DetectText::connectComponentAnalysis(const cv::Mat& swtmap, cv::Mat& ccmap)
-{
-	// Check all 8 neighbor pixels of each pixel for similar stroke width and for similar color, then form components with enumerative labels
-
-	int ccmapInitialVal = ccmap.at<float>(0, 0);
-	int offsetY8[] =
-	//{ -2, -2, -2, -2, -2, -1, -1, -1, -1, -1,  0,  0,  0,  0,  1,  1,  1,  1,  1,  2,  2,  2,  2,  2 };
-	{ -1, -1, -1, 0, 0, 1, 1, 1 };
-	int offsetX8[] =
-	//{ -2, -1,  0,  1,  2, -2, -1,  0,  1,  2, -2, -1,  1,  2, -2, -1,  0,  1,  2, -2, -1,  0,  1,  2 };
-	{ -1, 0, 1, -1, 1, -1, 0, 1 };
-	int nNeighbors = 8;//24;//8;
-	int label = 0;
-
-	int vectorSize = ccmap.rows * ccmap.cols;
-
-	std::vector<int> pStack(vectorSize * 2);
-	int stackPointer;
-
-	std::vector<int> pVector(vectorSize * 2);
-	int vectorPointer;
-
-	int currentPointX;
-	int currentPointY;
-
-	for (int y = 0; y < ccmap.rows; y++)
-	{
-		for (int x = 0; x < ccmap.cols; x++)
-		{
-			bool connected = false;
-			if (ccmap.at<float>(y, x) == ccmapInitialVal) // if pixel wasn't processed up to now
-			{
-				vectorPointer = 0;
-				stackPointer = 0;
-				pStack[stackPointer] = x;
-				pStack[stackPointer + 1] = y;
-
-				double componentMeanIntensity = 0.;
-				cv::Point3d componentMeanColor(0.,0.,0.);
-				int addedPixels = 0;
-
-				while (stackPointer >= 0)
-				{
-					currentPointX = pStack[stackPointer];
-					currentPointY = pStack[stackPointer + 1];
-					stackPointer -= 2;
-
-					pVector[vectorPointer] = currentPointX;
-					pVector[vectorPointer + 1] = currentPointY;
-					vectorPointer += 2;
-					//check which one of the neighbors have similar sw and then label the regions belonging together
-					for (int i = 0; i < nNeighbors; i++)
-					{
-						int ny = currentPointY + offsetY8[i];
-						int nx = currentPointX + offsetX8[i];
-
-						if (ny < 0 || nx < 0 || ny >= ccmap.rows || nx >= ccmap.cols)
-							continue;
-
-						// swtmap == 0 -> not part of any component
-						if (swtmap.at<float>(ny, nx) == 0)
-						{
-							ccmap.at<float>(ny, nx) = -2;
-							continue;
-						}
-
-						if (ccmap.at<float>(ny, nx) == ccmapInitialVal)
-						{
-							float sw1 = swtmap.at<float>(ny, nx);
-							float sw2 = swtmap.at<float>(y, x);
-
-							// compute mean color and intensity for pixel (nx,ny)
-							double intensity = (double)grayImage_.at<unsigned char>(ny, nx);
-							cv::Point3d color((double)originalImage_.at<bgr>(ny, nx).b, (double)originalImage_.at<bgr>(ny, nx).g, (double)originalImage_.at<bgr>(ny, nx).r);
-							for (int i = 0; i < nNeighbors; i++) //check all neighbors of actual neighbor for their color
-							{
-								int my = ny + offsetY8[i];
-								int mx = nx + offsetX8[i];
-								if (my < 0 || mx < 0 || my >= ccmap.rows || mx >= ccmap.cols)
-									continue;
-								intensity += (double)grayImage_.at<unsigned char>(my, mx);
-								color += cv::Point3d((double)originalImage_.at<bgr>(my, mx).b, (double)originalImage_.at<bgr>(my, mx).g, (double)originalImage_.at<bgr>(my, mx).r);
-							}
-							intensity /= (nNeighbors + 1.);
-							color *= 1./(nNeighbors + 1.);
-							if (componentMeanIntensity == 0.)
-							{
-								componentMeanIntensity = intensity;
-								componentMeanColor = color;
-							}
-
-							// do the pixels have similar strokewidth?
-							if (std::max(sw1, sw2) <= swCompareParameter * std::min(sw1, sw2) ||		// todo: ratio between a mean value over the component and sw1 better?
-									(std::max(sw1, sw2) <= 1.5*swCompareParameter * std::min(sw1, sw2) && (fabs(componentMeanIntensity-intensity) < colorCompareParameter) && (fabs(componentMeanColor.x-color.x) < colorCompareParameter) &&
-									(fabs(componentMeanColor.y-color.y) < colorCompareParameter) && (fabs(componentMeanColor.z-color.z) < colorCompareParameter)))
-							{
-//								if (processing_method_ == ORIGINAL_EPSHTEIN)
-//								{
-									ccmap.at<float>(ny, nx) = label;
-									stackPointer += 2;
-									pStack[stackPointer] = nx;
-									pStack[stackPointer + 1] = ny;
-									connected = true;
-
-									// update mean intensity and color
-									componentMeanIntensity = ((componentMeanIntensity*addedPixels) + intensity) / (addedPixels+1.);
-									componentMeanColor = ((componentMeanColor*addedPixels) + color) * (1./(addedPixels+1.));
-									addedPixels++;
-//								}
-//								else
-//								{
-//									float meanRed = originalImage_.at<bgr>(ny, nx).r;
-//									float meanGreen = originalImage_.at<bgr>(ny, nx).g;
-//									float meanBlue = originalImage_.at<bgr>(ny, nx).b;
-//									float meanclr = 0;
-//									for (int i = 0; i < nNeighbors; i++) //check all neighbors of actual neighbor for their color
-//									{
-//										int my = ny + offsetY8[i];
-//										int mx = nx + offsetX8[i];
-//										if (my < 0 || mx < 0 || my >= ccmap.rows || mx >= ccmap.cols)
-//											continue;
-//										bgr neighborClrs = originalImage_.at<bgr>(my, mx);
-//										meanRed += neighborClrs.r;
-//										meanGreen += neighborClrs.g;
-//										meanBlue += neighborClrs.b;
-//										meanclr += static_cast<float>(grayImage_.at<unsigned char>(my, mx));
-//									}
-//									meanRed /= (nNeighbors + 1);
-//									meanGreen /= (nNeighbors + 1);
-//									meanBlue /= (nNeighbors + 1);
-//									meanclr /= nNeighbors;
-//
-//									// do the pixels have similiar color?
-//									if (abs((int)originalImage_.at<bgr>(y, x).g - (int)meanGreen) < colorCompareParameter && abs((int)originalImage_.at<bgr> (y, x).r - (int)meanRed)
-//											< colorCompareParameter && abs((int)originalImage_.at<bgr>(y, x).b - (int)meanBlue) < colorCompareParameter)
-//									{
-//										ccmap.at<float>(ny, nx) = label;
-//										stackPointer += 2;
-//										pStack[stackPointer] = nx;
-//										pStack[stackPointer + 1] = ny;
-//										connected = true;
-//									}
-//								}
-							}
-						}
-					}// loop through neighbors
-				}
-
-				if (connected)
-				{
-					int minY = ccmap.rows, minX = ccmap.cols, maxY = 0, maxX = 0;
-					int width, height;
-					for (int i = 0; i < vectorPointer; i += 2)
-					{
-						// ROI for each component
-						minY = std::min(minY, pVector[i + 1]);
-						minX = std::min(minX, pVector[i]);
-						maxY = std::max(maxY, pVector[i + 1]);
-						maxX = std::max(maxX, pVector[i]);
-					}
-					width = maxX - minX + 1;
-					height = maxY - minY + 1;
-					cv::Rect letterRoi(minX, minY, width, height);
-					labeledRegions_.push_back(letterRoi);
-					label++;
-				}
-				else
-					// pixel had no neighbor with similar color and sw
-					ccmap.at<float>(y, x) = -2;
-			}
-		}// loop through ccmap
-	}
-	return label;
+
+int DetectText::connectComponentAnalysis(PassContext& pass)
+{
+	// Check all 8 neighbor pixels of each pixel for similar stroke width and for similar color, then form components with enumerative labels
+	ConnectedComponentLabeling labeling(swCompareParameter, colorCompareParameter);
+	cv::Mat& parents = buffers_.get(pass.fontColor == BRIGHT ? BufferArena::CC_PARENT_BRIGHT : BufferArena::CC_PARENT_DARK, pass.swtmap.size(), CV_32SC1);
+	int nComponent = labeling.label(pass.swtmap, originalImage_, grayImage_, tileThreads_, pass.ccmap, pass.componentStatistics,
+			pass.componentStrokeWidths, pass.componentStrokeWidthOffsets, parents);
+
+	// ROI for each component
+	pass.labeledRegions.clear();
+	for (int i = 0; i < nComponent; i++)
+		pass.labeledRegions.push_back(pass.componentStatistics[i].boundingBox());
+
+	return nComponent;
 }
 
-void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
+void DetectText::identifyLetters(PassContext& pass)
 {
-	// todo: parameter
-	if (processing_method_ == ORIGINAL_EPSHTEIN)
-		minLetterHeight_ = 8;
-	else
-		minLetterHeight_ = std::max(10, 3 + (originalImage_.rows)/480); //default: 10
+	const cv::Mat& ccmap = pass.ccmap;
 
-	assert(static_cast<size_t>(nComponent_) == labeledRegions_.size());
-	isLetterRegion_.clear();
-	isLetterRegion_.resize(nComponent_, false);
-	medianStrokeWidth_.clear();
-	medianStrokeWidth_.resize(nComponent_, -1.f);
+	assert(static_cast<size_t>(pass.nComponent) == pass.labeledRegions.size());
+	pass.isLetterRegion.clear();
+	pass.isLetterRegion.resize(pass.nComponent, false);
+	pass.medianStrokeWidth.clear();
+	pass.medianStrokeWidth.resize(pass.nComponent, -1.f);
 
-	meanRGB_ = std::vector< std::vector<float> >(nComponent_, std::vector<float>(4)); // Foreground (letter component pixels) mean color: r g b gray
+	pass.meanRGB.assign(pass.nComponent); // Foreground (letter component pixels) mean color: r g b gray
 
-	meanBgRGB_ = std::vector< std::vector<float> >(nComponent_, std::vector<float>(4)); // Background (remaining pixels) mean color: r g b gray
+	pass.meanBgRGB.assign(pass.nComponent); // Background (remaining pixels) mean color: r g b gray
 
-	nLetter_ = 0;
+	pass.nLetter = 0;
 
 	// For every found component
-	for (size_t i = 0; i < nComponent_; i++)
+	for (size_t i = 0; i < pass.nComponent; i++)
 	{
-		//std::vector<bool> innerComponents(nComponent_, false);
-		isLetterRegion_[i] = false;
-		float maxStrokeWidth = 0;
-		double sumStrokeWidth = 0;
-		float currentStrokeWidth;
+		//std::vector<bool> innerComponents(pass.nComponent, false);
+		pass.isLetterRegion[i] = false;
+		const ComponentStatistics& statistics = pass.componentStatistics[i];
 		bool isLetter = true;
 
-		cv::Rect itr = labeledRegions_[i];
+		cv::Rect itr = pass.labeledRegions[i];
 
 		// rule #1: height of component [not used atm]
 		// rotated text leads to problems. 90° rotated 'l' may only be 1 pixel high..
@@ -1056,40 +1065,17 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 		if ((processing_method_==ORIGINAL_EPSHTEIN) && (itr.height > maxLetterHeight_ || itr.height < minLetterHeight_ || itr.area() < 50))
 			continue;
 
-		float maxY = itr.y + itr.height;
-		float minY = itr.y;
-		float maxX = itr.x + itr.width;
-		float minX = itr.x;
-
-		// compute mean and variance of stroke width
-		std::vector<float> iComponentStrokeWidth;
-		for (int y = minY; y < maxY; y++)
-		{
-			for (int x = minX; x < maxX; x++)
-			{
-				int component = static_cast<int>(ccmap.at<float>(y, x)); //ccmap-Label = -2 in case no Region; 0,1,2,3... for every region
-				if (component == static_cast<int>(i))
-				{
-					currentStrokeWidth = swtmap.at<float>(y, x);
-					iComponentStrokeWidth.push_back(currentStrokeWidth);
-					maxStrokeWidth = std::max(maxStrokeWidth, currentStrokeWidth);
-					sumStrokeWidth += currentStrokeWidth;
-				}
-//				else if (component >= 0)
-//					innerComponents[component] = true;
-			}
-		}
-		double pixelCount = static_cast<double>(iComponentStrokeWidth.size());
+		// mean and variance of stroke width from the sums of the labelling pass, no rescan of the component pixels
+		float maxStrokeWidth = statistics.strokeWidthMax;
+		double sumStrokeWidth = statistics.strokeWidthSum;
+		double pixelCount = static_cast<double>(statistics.pixelCount);
 
 		// rule #2: remove components that are too small/thin		// todo: reactivate
 		if (pixelCount < 0.1*itr.area())
 			continue;
 
 		double meanStrokeWidth = sumStrokeWidth / pixelCount;
-		double varianceStrokeWidth = 0;
-		for (size_t ii = 0; ii < iComponentStrokeWidth.size(); ii++)
-			varianceStrokeWidth += (iComponentStrokeWidth[ii] - meanStrokeWidth) * (iComponentStrokeWidth[ii] - meanStrokeWidth);
-		varianceStrokeWidth = varianceStrokeWidth / pixelCount;
+		double varianceStrokeWidth = std::max(0., statistics.strokeWidthSquareSum / pixelCount - meanStrokeWidth * meanStrokeWidth);
 
 		// rule #2: variance of stroke width of pixels in region that are part of component
 		isLetter = isLetter && (std::sqrt(varianceStrokeWidth) <= varianceParameter*meanStrokeWidth);
@@ -1105,9 +1091,12 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 		// std::sort(iComponentStrokeWidth.begin(), iComponentStrokeWidth.end());
 		// unsigned int medianStrokeWidth = iComponentStrokeWidth[iComponentStrokeWidth.size() / 2];
 		//isLetter = isLetter && (sqrt(((itr.width) * (itr.width) + (itr.height) * (itr.height))) < maxStrokeWidth * diagonalParameter);
-		std::nth_element(iComponentStrokeWidth.begin(), iComponentStrokeWidth.begin()+iComponentStrokeWidth.size()/2, iComponentStrokeWidth.end());
-		medianStrokeWidth_[i] = *(iComponentStrokeWidth.begin()+iComponentStrokeWidth.size()/2);
-//		isLetter = isLetter && (sqrt((double)(itr.width)*(itr.width) + (itr.height)*(itr.height)) < medianStrokeWidth_[i] * diagonalParameter);		// todo: reactivate
+		// exact median of the stroke widths of the component pixels, collected by connectComponentAnalysis
+		std::vector<float>::iterator strokeWidthBegin = pass.componentStrokeWidths.begin() + pass.componentStrokeWidthOffsets[i];
+		std::vector<float>::iterator strokeWidthEnd = pass.componentStrokeWidths.begin() + pass.componentStrokeWidthOffsets[i + 1];
+		std::nth_element(strokeWidthBegin, strokeWidthBegin+statistics.pixelCount/2, strokeWidthEnd);
+		pass.medianStrokeWidth[i] = *(strokeWidthBegin+statistics.pixelCount/2);
+//		isLetter = isLetter && (sqrt((double)(itr.width)*(itr.width) + (itr.height)*(itr.height)) < pass.medianStrokeWidth[i] * diagonalParameter);		// todo: reactivate
 
 		// rule #4: pixelCount has to be bigger than maxStrokeWidth * x:
 		if (processing_method_==BORMANN)
@@ -1121,42 +1110,46 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 		//isLetter = isLetter && (countInnerLetterCandidates(innerComponents) <= innerLetterCandidatesParameter);
 
 		// rule #7: Ratio of background color / foreground color has to be big.
-		meanRGB_[i] = getMeanIntensity(ccmap, itr, static_cast<int>(i), false);
-		meanBgRGB_[i] = getMeanIntensity(ccmap, itr, static_cast<int>(i), true);
+		getMeanIntensity(statistics, itr, false, pass.meanRGB, i);
+		getMeanIntensity(statistics, itr, true, pass.meanBgRGB, i);
 		if (processing_method_==BORMANN && isLetter)
 		{
+			const MeanColors& fg = pass.meanRGB;
+			const MeanColors& bg = pass.meanBgRGB;
 			if (itr.area() > 200) // too small areas have bigger color difference
-				if ((std::abs(meanRGB_[i][0] - meanBgRGB_[i][0]) < clrComponentParameter) ||
-						(std::abs(meanRGB_[i][1]-meanBgRGB_[i][1]) < clrComponentParameter) || (std::abs(meanRGB_[i][2]-meanBgRGB_[i][2]) < clrComponentParameter))
-					if ((std::abs(meanRGB_[i][0]-meanBgRGB_[i][0])) + (std::abs(meanRGB_[i][1]-meanBgRGB_[i][1])) + (std::abs(meanRGB_[i][2]-meanBgRGB_[i][2])) < clrComponentParameter * 4)
+				if ((std::abs(fg.r[i] - bg.r[i]) < clrComponentParameter) ||
+						(std::abs(fg.g[i]-bg.g[i]) < clrComponentParameter) || (std::abs(fg.b[i]-bg.b[i]) < clrComponentParameter))
+					if ((std::abs(fg.r[i]-bg.r[i])) + (std::abs(fg.g[i]-bg.g[i])) + (std::abs(fg.b[i]-bg.b[i])) < clrComponentParameter * 4)
 						isLetter = false;
 		}
 
 		// rule #8 fg gray has to correspond to actual font color
 		//    if (isLetter)
-		//      if (firstPass_)
-		//        if (meanRGB_[i][3] < 75 || meanBgRGB_[i][3] > 175)
+		//      if (pass.fontColor == BRIGHT)
+		//        if (pass.meanRGB[i][3] < 75 || pass.meanBgRGB[i][3] > 175)
 		//          isLetter = false;
-		//        else if (meanRGB_[i][3] > 175 || meanBgRGB_[i][3] < 75)
+		//        else if (pass.meanRGB[i][3] > 175 || pass.meanBgRGB[i][3] < 75)
 		//          isLetter = false;
 
-		isLetterRegion_[i] = isLetter;
+		pass.isLetterRegion[i] = isLetter;
 		if (isLetter)
-			nLetter_++;
+			pass.nLetter++;
 	}
 
 	// rule #6: number of inner components must be small
-	for (unsigned int i=0; i<nComponent_; i++)
+	std::vector<std::vector<int> > innerCandidates;
+	overlappingLetters(pass, innerCandidates);
+	for (unsigned int i=0; i<pass.nComponent; i++)
 	{
-		if (isLetterRegion_[i] == false)
+		if (pass.isLetterRegion[i] == false)
 			continue;
 
 		// option a: comparison at pixel level
-//		std::vector<bool> innerComponents(nComponent_, false);
-//		int minX = labeledRegions_[i].x;
-//		int maxX = labeledRegions_[i].x+labeledRegions_[i].width;
-//		int minY = labeledRegions_[i].y;
-//		int maxY = labeledRegions_[i].y+labeledRegions_[i].height;
+//		std::vector<bool> innerComponents(pass.nComponent, false);
+//		int minX = pass.labeledRegions[i].x;
+//		int maxX = pass.labeledRegions[i].x+pass.labeledRegions[i].width;
+//		int minY = pass.labeledRegions[i].y;
+//		int maxY = pass.labeledRegions[i].y+pass.labeledRegions[i].height;
 //		for (int y = minY; y < maxY; y++)
 //		{
 //			for (int x = minX; x < maxX; x++)
@@ -1166,19 +1159,15 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 //					innerComponents[component] = true;
 //			}
 //		}
-		// option b: comparison with bounding box intersection
-		std::vector<bool> innerComponents(nComponent_, false);
-		for (unsigned int j=0; j<nComponent_; j++)
+		// option b: comparison with bounding box intersection, letters removed by this rule before do not count anymore
+		int innerLetterCandidates = 0;
+		for (size_t c = 0; c < innerCandidates[i].size(); c++)
+			if (pass.isLetterRegion[innerCandidates[i][c]])
+				innerLetterCandidates++;
+		if (innerLetterCandidates > innerLetterCandidatesParameter)
 		{
-			if (i==j || isLetterRegion_[j]==false)
-				continue;
-			if ((labeledRegions_[i] & labeledRegions_[j]).area() != 0)
-				innerComponents[j] = true;
-		}
-		if (countInnerLetterCandidates(innerComponents) > innerLetterCandidatesParameter)
-		{
-			isLetterRegion_[i] = false;
-			nLetter_--;
+			pass.isLetterRegion[i] = false;
+			pass.nLetter--;
 		}
 	}
 
@@ -1186,17 +1175,17 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 	if (debug["showLetterCandidates"])
 	{
 		cv::Mat output = originalImage_.clone();
-		for (size_t i = 0; i < nComponent_; i++)
+		for (size_t i = 0; i < pass.nComponent; i++)
 		{
-			if (firstPass_)
-				cv::rectangle(output, cv::Point(labeledRegions_[i].x, labeledRegions_[i].y),
-						cv::Point(labeledRegions_[i].x + labeledRegions_[i].width, labeledRegions_[i].y + labeledRegions_[i].height),
+			if (pass.fontColor == BRIGHT)
+				cv::rectangle(output, cv::Point(pass.labeledRegions[i].x, pass.labeledRegions[i].y),
+						cv::Point(pass.labeledRegions[i].x + pass.labeledRegions[i].width, pass.labeledRegions[i].y + pass.labeledRegions[i].height),
 						cv::Scalar((255), (255), (255)), 1);
 			else
-				cv::rectangle(output, cv::Point(labeledRegions_[i].x, labeledRegions_[i].y),
-						cv::Point(labeledRegions_[i].x + labeledRegions_[i].width, labeledRegions_[i].y + labeledRegions_[i].height), cv::Scalar((0), (0), (0)), 1);
+				cv::rectangle(output, cv::Point(pass.labeledRegions[i].x, pass.labeledRegions[i].y),
+						cv::Point(pass.labeledRegions[i].x + pass.labeledRegions[i].width, pass.labeledRegions[i].y + pass.labeledRegions[i].height), cv::Scalar((0), (0), (0)), 1);
 		}
-		if (firstPass_)
+		if (pass.fontColor == BRIGHT)
 		{
 			cv::imshow("bright letter candidates", output);
 			cvMoveWindow("bright letter candidates", 0, 0);
@@ -1211,20 +1200,19 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 	if (debug["showLetters"])
 	{
 		cv::Mat output = originalImage_.clone();
-		for (size_t i = 0; i < nComponent_; i++)
+		for (size_t i = 0; i < pass.nComponent; i++)
 		{
-			if (firstPass_)
+			if (pass.fontColor == BRIGHT)
 			{
-				if (isLetterRegion_[i] == true)
+				if (pass.isLetterRegion[i] == true)
 				{
-					cv::rectangle(output, cv::Point(labeledRegions_[i].x, labeledRegions_[i].y),
-							cv::Point(labeledRegions_[i].x + labeledRegions_[i].width, labeledRegions_[i].y + labeledRegions_[i].height),
+					cv::rectangle(output, cv::Point(pass.labeledRegions[i].x, pass.labeledRegions[i].y),
+							cv::Point(pass.labeledRegions[i].x + pass.labeledRegions[i].width, pass.labeledRegions[i].y + pass.labeledRegions[i].height),
 							cv::Scalar((255), (255), (255)), 1);
-					for (int y = labeledRegions_[i].y; y < labeledRegions_[i].y + labeledRegions_[i].height; y++)
-						for (int x = labeledRegions_[i].x; x < labeledRegions_[i].x + labeledRegions_[i].width; x++)
+					for (int y = pass.labeledRegions[i].y; y < pass.labeledRegions[i].y + pass.labeledRegions[i].height; y++)
+						for (int x = pass.labeledRegions[i].x; x < pass.labeledRegions[i].x + pass.labeledRegions[i].width; x++)
 						{
-							float felement = static_cast<float> (i);
-							if (felement == ccmap.at<float> (y, x))
+							if (static_cast<int>(i) == ccmap.at<int> (y, x))
 								cv::rectangle(output, cv::Point(x, y), cv::Point(x, y), cv::Scalar(255, 255, 255), 1);
 						}
 
@@ -1232,22 +1220,21 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 			}
 			else
 			{
-				if (isLetterRegion_[i] == true)
+				if (pass.isLetterRegion[i] == true)
 				{
-					cv::rectangle(output, cv::Point(labeledRegions_[i].x, labeledRegions_[i].y),
-							cv::Point(labeledRegions_[i].x + labeledRegions_[i].width, labeledRegions_[i].y + labeledRegions_[i].height),
+					cv::rectangle(output, cv::Point(pass.labeledRegions[i].x, pass.labeledRegions[i].y),
+							cv::Point(pass.labeledRegions[i].x + pass.labeledRegions[i].width, pass.labeledRegions[i].y + pass.labeledRegions[i].height),
 							cv::Scalar((0), (0), (0)), 1);
-					for (int y = labeledRegions_[i].y; y < labeledRegions_[i].y + labeledRegions_[i].height; y++)
-						for (int x = labeledRegions_[i].x; x < labeledRegions_[i].x + labeledRegions_[i].width; x++)
+					for (int y = pass.labeledRegions[i].y; y < pass.labeledRegions[i].y + pass.labeledRegions[i].height; y++)
+						for (int x = pass.labeledRegions[i].x; x < pass.labeledRegions[i].x + pass.labeledRegions[i].width; x++)
 						{
-							float felement = static_cast<float> (i);
-							if (felement == ccmap.at<float> (y, x))
+							if (static_cast<int>(i) == ccmap.at<int> (y, x))
 								cv::rectangle(output, cv::Point(x, y), cv::Point(x, y), cv::Scalar(0, 0, 0), 1);
 						}
 				}
 			}
 		}
-		if (firstPass_)
+		if (pass.fontColor == BRIGHT)
 		{
 			cv::imshow("bright letters", output);
 			cvMoveWindow("bright letters", 0, 0);
@@ -1261,86 +1248,82 @@ void DetectText::identifyLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 	}
 }
 
-inline int DetectText::countInnerLetterCandidates(std::vector<bool> & array)
-{
-	int count = 0;
-	for (size_t i = 0; i < array.size(); i++)
-		if (array[i] == true)
-			count++;
-	return count;
-}
-
-std::vector<float> DetectText::getMeanIntensity(const cv::Mat& ccmap, const cv::Rect& rect, int element, bool background)
+void DetectText::overlappingLetters(const PassContext& pass, std::vector<std::vector<int> >& overlaps)
 {
-	// get r g b and gray value of pixels in rect distinguished with ccmap label (which one is bg/foreground)
-
-	std::vector<float> elementMeanRGB(4);
+	overlaps.assign(pass.nComponent, std::vector<int>());
 
-	bgr clr;
-	double rSum = 0, bSum = 0, gSum = 0, graySum = 0, count = 0;
-	float felement = static_cast<float>(element);
+	// letters sorted by the left border of their boxes, a box can only overlap the following boxes that start before its right border
+	std::vector<std::pair<int, int> > letters;
+	for (size_t i = 0; i < pass.nComponent; i++)
+		if (pass.isLetterRegion[i])
+			letters.push_back(std::make_pair(pass.labeledRegions[i].x, static_cast<int>(i)));
+	std::sort(letters.begin(), letters.end());
 
-	for (int y = rect.y; y < rect.y + rect.height; y++)
-		for (int x = rect.x; x < rect.x + rect.width; x++)
+	for (size_t a = 0; a < letters.size(); a++)
+	{
+		const cv::Rect& aRect = pass.labeledRegions[letters[a].second];
+		for (size_t b = a + 1; b < letters.size() && letters[b].first < aRect.x + aRect.width; b++)
 		{
-			if (background) // get color of all pixels that dont belong to actual stroke in this label (the background pixels)
-			{
-				if (ccmap.at<float>(y, x) != felement)
-				{
-					graySum += static_cast<float> (grayImage_.at<unsigned char>(y, x));
-					count++;
-					clr = originalImage_.at<bgr>(y, x);
-					rSum += (float) clr.r;
-					bSum += (float) clr.b;
-					gSum += (float) clr.g;
-				}
-			}
-			else // foreground pixel color, means letter color
-			{
-				if (ccmap.at<float>(y, x) == felement)
-				{
-					graySum += static_cast<float>(grayImage_.at<unsigned char>(y, x));
-					count++;
-					clr = originalImage_.at<bgr>(y, x);
-					rSum += (float) clr.r;
-					bSum += (float) clr.b;
-					gSum += (float) clr.g;
-				}
-			}
+			if ((aRect & pass.labeledRegions[letters[b].second]).area() == 0)
+				continue;
+			overlaps[letters[a].second].push_back(letters[b].second);
+			overlaps[letters[b].second].push_back(letters[a].second);
 		}
+	}
+}
 
-	elementMeanRGB[0] = rSum / count;
-	elementMeanRGB[1] = gSum / count;
-	elementMeanRGB[2] = bSum / count;
-	elementMeanRGB[3] = graySum / count;
+void DetectText::getMeanIntensity(const ComponentStatistics& component, const cv::Rect& rect, bool background, MeanColors& means, std::size_t index)
+{
+	// get r g b and gray value of the component pixels (foreground, means letter color) or of the remaining pixels in rect (background)
+
+	double bSum = component.colorSum[0], gSum = component.colorSum[1], rSum = component.colorSum[2], graySum = component.graySum;
+	double count = component.pixelCount;
+
+	if (background) // all pixels in rect minus the pixels of this component
+	{
+		int x0 = rect.x, y0 = rect.y, x1 = rect.x + rect.width, y1 = rect.y + rect.height;
+		cv::Vec3d colorSum = colorIntegral_.at<cv::Vec3d>(y1, x1) - colorIntegral_.at<cv::Vec3d>(y0, x1) - colorIntegral_.at<cv::Vec3d>(y1, x0)
+				+ colorIntegral_.at<cv::Vec3d>(y0, x0);
+		double grayRectSum = grayIntegral_.at<double>(y1, x1) - grayIntegral_.at<double>(y0, x1) - grayIntegral_.at<double>(y1, x0) + grayIntegral_.at<double>(y0, x0);
+		bSum = colorSum[0] - bSum;
+		gSum = colorSum[1] - gSum;
+		rSum = colorSum[2] - rSum;
+		graySum = grayRectSum - graySum;
+		count = rect.area() - count;
+	}
 
-	return elementMeanRGB;
+	means.r[index] = rSum / count;
+	means.g[index] = gSum / count;
+	means.b[index] = bSum / count;
+	means.gray[index] = graySum / count;
 }
 
-void DetectText::groupLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
+void DetectText::groupLetters(PassContext& pass)
 {
 	// group 2 letterboxes together if they fit
 
-	//std::vector<float> medianSw(nComponent_);
+	//std::vector<float> medianSw(pass.nComponent);
 
 	double largeLetterCountFactor = 1.0;
-	if (nLetter_ > 200)
+	if (pass.nLetter > 200)
 		largeLetterCountFactor = 0.4;
 
+	// only letters with nearby centers can pass rule 1a
+	std::vector<std::vector<int> > candidates;
+	letterPairCandidates(pass, largeLetterCountFactor, candidates);
+
 	// for all possible letter candidate rects
-	for (size_t i = 0; i < nComponent_; i++)
+	for (size_t i = 0; i < pass.nComponent; i++)
 	{
-		if (isLetterRegion_[i]==false)
+		if (pass.isLetterRegion[i]==false)
 			continue;
 
-		cv::Rect iRect = labeledRegions_[i];
+		cv::Rect iRect = pass.labeledRegions[i];
 
-		for (size_t j = i + 1; j < nComponent_; j++)
+		for (size_t c = 0; c < candidates[i].size(); c++)
 		{
-			if (isLetterRegion_[j]==false)
-				continue;
-
-			cv::Rect jRect = labeledRegions_[j];
+			size_t j = candidates[i][c];
+			cv::Rect jRect = pass.labeledRegions[j];
 
 			// rule 1: distance between components
 			float distance = sqrt((iRect.x+iRect.width/2 - jRect.x-jRect.width/2) * (iRect.x+iRect.width/2 - jRect.x-jRect.width/2)
@@ -1366,13 +1349,13 @@ void DetectText::groupLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 				if ((double)std::max(iRect.height, jRect.height) > 2.0 * (double)std::min(iRect.height, jRect.height))
 					continue;
 
-			//medianSw[i] = getMedianStrokeWidth(ccmap, swtmap, iRect, static_cast<int>(i));
-			//medianSw[j] = getMedianStrokeWidth(ccmap, swtmap, jRect, static_cast<int>(j));
+			//medianSw[i] = getMedianStrokeWidth(pass, static_cast<int>(i));
+			//medianSw[j] = getMedianStrokeWidth(pass, static_cast<int>(j));
 
 			int negativeScore = 0; //high score is bad
 
 			// rule 2: median of stroke width ratio
-			if (std::max(medianStrokeWidth_[i], medianStrokeWidth_[j]) > medianSwParameter * std::min(medianStrokeWidth_[i], medianStrokeWidth_[j]))
+			if (std::max(pass.medianStrokeWidth[i], pass.medianStrokeWidth[j]) > medianSwParameter * std::min(pass.medianStrokeWidth[i], pass.medianStrokeWidth[j]))
 				negativeScore++;
 
 			if (processing_method_==BORMANN)
@@ -1382,26 +1365,26 @@ void DetectText::groupLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 					negativeScore++;
 
 				// rule 4: average gray color of letters
-				if (std::abs(meanRGB_[i][3] - meanRGB_[j][3]) > grayClrParameter)
+				if (std::abs(pass.meanRGB.gray[i] - pass.meanRGB.gray[j]) > grayClrParameter)
 					negativeScore++;
 
 			}
 
 			// rule 5: rgb of letters
 			// foreground color difference between letters
-			if (std::abs(meanRGB_[i][0] - meanRGB_[j][0]) > clrSingleParameter || std::abs(meanRGB_[i][1] - meanRGB_[j][1]) > clrSingleParameter
-					|| std::abs(meanRGB_[i][2] - meanRGB_[j][2]) > clrSingleParameter)
+			if (std::abs(pass.meanRGB.r[i] - pass.meanRGB.r[j]) > clrSingleParameter || std::abs(pass.meanRGB.g[i] - pass.meanRGB.g[j]) > clrSingleParameter
+					|| std::abs(pass.meanRGB.b[i] - pass.meanRGB.b[j]) > clrSingleParameter)
 				negativeScore += 2;
 
 			// background color difference between letters
-			// if (std::abs(meanBgRGB_[i][0] - meanBgRGB_[j][0]) > clrSingleParameter || std::abs(meanBgRGB_[i][1]
-			//     - meanBgRGB_[j][1]) > clrSingleParameter || std::abs(meanBgRGB_[i][2] - meanBgRGB_[j][2])
+			// if (std::abs(pass.meanBgRGB[i][0] - pass.meanBgRGB[j][0]) > clrSingleParameter || std::abs(pass.meanBgRGB[i][1]
+			//     - pass.meanBgRGB[j][1]) > clrSingleParameter || std::abs(pass.meanBgRGB[i][2] - pass.meanBgRGB[j][2])
 			//     > clrSingleParameter)
 			//   score++;
-			// fgDifferenceSum = std::abs(meanRGB_[i][0] - meanRGB_[j][0]) + std::abs(meanRGB_[i][1] - meanRGB_[j][1])
-			//      + std::abs(meanRGB_[i][2] - meanRGB_[j][2]);
-			//  bgDifferenceSum = std::abs(meanBgRGB_[i][0] - meanBgRGB_[j][0]) + std::abs(meanBgRGB_[i][1] - meanBgRGB_[j][1])
-			//      + std::abs(meanBgRGB_[i][2] - meanBgRGB_[j][2]);
+			// fgDifferenceSum = std::abs(pass.meanRGB[i][0] - pass.meanRGB[j][0]) + std::abs(pass.meanRGB[i][1] - pass.meanRGB[j][1])
+			//      + std::abs(pass.meanRGB[i][2] - pass.meanRGB[j][2]);
+			//  bgDifferenceSum = std::abs(pass.meanBgRGB[i][0] - pass.meanBgRGB[j][0]) + std::abs(pass.meanBgRGB[i][1] - pass.meanBgRGB[j][1])
+			//      + std::abs(pass.meanBgRGB[i][2] - pass.meanBgRGB[j][2]);
 			// if ((fgDifferenceSum > clrSumParameter && bgDifferenceSum > clrSumParameter) || fgDifferenceSum > 2
 			//     * clrSumParameter || fgDifferenceSum > 2 * clrSumParameter)
 			//   score++;
@@ -1451,56 +1434,126 @@ void DetectText::groupLetters(const cv::Mat& swtmap, const cv::Mat& ccmap)
 
 
 			if (isGroup==true)
-				letterGroups_.push_back(Pair(i, j));
+				pass.letterGroups.push_back(Pair(i, j));
 
 		}// end for loop j
 	}// end for loop i
 }
 
-float DetectText::getMedianStrokeWidth(const cv::Mat& ccmap, const cv::Mat& swtmap, const cv::Rect& rect, int element)
+void DetectText::letterPairCandidates(const PassContext& pass, double largeLetterCountFactor, std::vector<std::vector<int> >& candidates)
 {
-	assert(element >= 0);
-	assert(isLetterRegion_[element]);
+	candidates.assign(pass.nComponent, std::vector<int>());
+
+	// centers (same rounding as in groupLetters), search radius of rule 1a and height of all letters
+	std::vector<int> letters, centerX, centerY, heights;
+	std::vector<float> radius;
+	for (size_t i = 0; i < pass.nComponent; i++)
+	{
+		if (pass.isLetterRegion[i]==false)
+			continue;
+		const cv::Rect& r = pass.labeledRegions[i];
+		letters.push_back(i);
+		centerX.push_back(r.x + r.width / 2);
+		centerY.push_back(r.y + r.height / 2);
+		heights.push_back(r.height);
+		// rule 1a compares with the maximum width (ORIGINAL_EPSHTEIN) or the minimum diagonal of both letters,
+		// so a close pair is always within the radius of at least one of them
+		float size = (processing_method_==ORIGINAL_EPSHTEIN) ? r.width : sqrt(r.height * r.height + r.width * r.width);
+		radius.push_back(size * distanceRatioParameter * largeLetterCountFactor + 1);
+	}
+	if (letters.empty())
+		return;
 
-	std::vector<float> SwtValues;
+	std::vector<int> sortedHeights(heights);
+	std::nth_element(sortedHeights.begin(), sortedHeights.begin() + sortedHeights.size() / 2, sortedHeights.end());
+	int cellSize = std::max(1, sortedHeights[sortedHeights.size() / 2]);
 
-	float felement = static_cast<float> (element);
-	for (int y = rect.y; y < rect.y + rect.height; y++)
-		for (int x = rect.x; x < rect.x + rect.width; x++)
-		{
-			if (ccmap.at<float> (y, x) == felement)
-			{
-				SwtValues.push_back(swtmap.at<float> (y, x));
+	// letters sorted into the grid cells by their center: cell c holds gridLetters[cellStart[c] .. cellStart[c+1]-1]
+	int gridCols = std::max(pass.ccmap.cols, 1) / cellSize + 1;
+	int gridRows = std::max(pass.ccmap.rows, 1) / cellSize + 1;
+	std::vector<int> cellStart(gridCols * gridRows + 1, 0);
+	std::vector<int> cellOf(letters.size());
+	for (size_t l = 0; l < letters.size(); l++)
+	{
+		int cx = std::min(std::max(centerX[l] / cellSize, 0), gridCols - 1);
+		int cy = std::min(std::max(centerY[l] / cellSize, 0), gridRows - 1);
+		cellOf[l] = cy * gridCols + cx;
+		cellStart[cellOf[l] + 1]++;
+	}
+	for (size_t c = 1; c < cellStart.size(); c++)
+		cellStart[c] += cellStart[c - 1];
+	std::vector<int> gridLetters(letters.size());
+	std::vector<int> position(cellStart.begin(), cellStart.end() - 1);
+	for (size_t l = 0; l < letters.size(); l++)
+		gridLetters[position[cellOf[l]]++] = l;
+
+	// every letter collects the letters within its radius, each pair is stored at its smaller index
+	for (size_t l = 0; l < letters.size(); l++)
+	{
+		int x0 = std::max(0, (int)floor((centerX[l] - radius[l]) / cellSize));
+		int x1 = std::min(gridCols - 1, (int)floor((centerX[l] + radius[l]) / cellSize));
+		int y0 = std::max(0, (int)floor((centerY[l] - radius[l]) / cellSize));
+		int y1 = std::min(gridRows - 1, (int)floor((centerY[l] + radius[l]) / cellSize));
+		float radiusSquared = radius[l] * radius[l];
+		for (int cy = y0; cy <= y1; cy++)
+			for (int cx = x0; cx <= x1; cx++)
+			{
+				int cell = cy * gridCols + cx;
+				for (int g = cellStart[cell]; g < cellStart[cell + 1]; g++)
+				{
+					int other = gridLetters[g];
+					if (other == (int)l)
+						continue;
+					float dx = centerX[other] - centerX[l];
+					float dy = centerY[other] - centerY[l];
+					if (dx * dx + dy * dy > radiusSquared)
+						continue;
+					int i = std::min(letters[l], letters[other]);
+					int j = std::max(letters[l], letters[other]);
+					candidates[i].push_back(j);
+				}
 			}
-		}
+	}
+
+	// same order as comparing every letter with all following letters
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		std::sort(candidates[i].begin(), candidates[i].end());
+		candidates[i].erase(std::unique(candidates[i].begin(), candidates[i].end()), candidates[i].end());
+	}
+}
 
-	std::nth_element(SwtValues.begin(), SwtValues.begin() + SwtValues.size() / 2, SwtValues.end());
+float DetectText::getMedianStrokeWidth(const PassContext& pass, int element)
+{
+	assert(element >= 0);
+	assert(pass.isLetterRegion[element]);
 
-	return SwtValues[SwtValues.size() / 2];
+	// computed by identifyLetters from the stroke widths collected in the labelling pass
+	return pass.medianStrokeWidth[element];
 }
 
-std::vector<cv::Rect> DetectText::chainPairs()
+std::vector<cv::Rect> DetectText::chainPairs(PassContext& pass)
 {
 	if (debug["showPairs"])
 	{
 		cv::Mat output = originalImage_.clone();
 
-		for (unsigned int i = 0; i < letterGroups_.size(); i++)
+		for (unsigned int i = 0; i < pass.letterGroups.size(); i++)
 		{
 			cv::rectangle(
 					output,
-					cv::Point(labeledRegions_.at(letterGroups_[i].left).x, labeledRegions_.at(letterGroups_[i].left).y),
-					cv::Point(labeledRegions_.at(letterGroups_[i].left).x + labeledRegions_.at(letterGroups_[i].left).width,
-							labeledRegions_.at(letterGroups_[i].left).y + labeledRegions_.at(letterGroups_[i].left).height),
+					cv::Point(pass.labeledRegions.at(pass.letterGroups[i].left).x, pass.labeledRegions.at(pass.letterGroups[i].left).y),
+					cv::Point(pass.labeledRegions.at(pass.letterGroups[i].left).x + pass.labeledRegions.at(pass.letterGroups[i].left).width,
+							pass.labeledRegions.at(pass.letterGroups[i].left).y + pass.labeledRegions.at(pass.letterGroups[i].left).height),
 					cv::Scalar((25 * i + 100) % 255, (35 * (i + 1) + 100) % 255, (45 * (i + 2) + 100) % 255), 1);
 			cv::rectangle(
 					output,
-					cv::Point(labeledRegions_.at(letterGroups_[i].right).x, labeledRegions_.at(letterGroups_[i].right).y),
-					cv::Point(labeledRegions_.at(letterGroups_[i].right).x + labeledRegions_.at(letterGroups_[i].right).width,
-							labeledRegions_.at(letterGroups_[i].right).y + labeledRegions_.at(letterGroups_[i].right).height),
+					cv::Point(pass.labeledRegions.at(pass.letterGroups[i].right).x, pass.labeledRegions.at(pass.letterGroups[i].right).y),
+					cv::Point(pass.labeledRegions.at(pass.letterGroups[i].right).x + pass.labeledRegions.at(pass.letterGroups[i].right).width,
+							pass.labeledRegions.at(pass.letterGroups[i].right).y + pass.labeledRegions.at(pass.letterGroups[i].right).height),
 					cv::Scalar((25 * i + 100) % 255, (35 * (i + 1) + 100) % 255, (45 * (i + 2) + 100) % 255), 1);
 
-			if (firstPass_)
+			if (pass.fontColor == BRIGHT)
 			{
 				cv::imshow("bright pairs", output);
 				cvMoveWindow("bright pairs", 0, 0);
@@ -1515,10 +1568,10 @@ std::vector<cv::Rect> DetectText::chainPairs()
 	}
 
 	std::vector<std::vector<int> > chains_;
-	mergePairs(letterGroups_, chains_);
+	mergePairs(pass.letterGroups, chains_);
 
 	std::vector<cv::Rect> initialBoxes;
-	chainToBox(chains_, initialBoxes); //initialHorizontalBoxes contains rects for every chain component with more than two components(letters)
+	chainToBox(pass, chains_, initialBoxes); //initialHorizontalBoxes contains rects for every chain component with more than two components(letters)
 
 	if (debug["showChains"])
 	{
@@ -1527,10 +1580,10 @@ std::vector<cv::Rect> DetectText::chainPairs()
 		for (unsigned int ii = 0; ii < initialBoxes.size(); ii++)
 		{
 			std::cout << "   " << initialBoxes[ii].x << "\t" << initialBoxes[ii].y << "\t" << initialBoxes[ii].width << "\t" << initialBoxes[ii].height << "\t" << std::endl;
-			for (unsigned int i = 0; i < connectedComponents_[ii].size(); i++)
+			for (unsigned int i = 0; i < pass.connectedComponents[ii].size(); i++)
 			{
-				cv::rectangle(output, connectedComponents_[ii][i].r, cv::Scalar(255, 255, 255), 1, 1, 0);
-				cv::rectangle(output, connectedComponents_[ii][i].middlePoint, connectedComponents_[ii][i].middlePoint, cv::Scalar(255, 255, 255), 2, 1, 0);
+				cv::rectangle(output, pass.connectedComponents[ii][i].r, cv::Scalar(255, 255, 255), 1, 1, 0);
+				cv::rectangle(output, pass.connectedComponents[ii][i].middlePoint, pass.connectedComponents[ii][i].middlePoint, cv::Scalar(255, 255, 255), 2, 1, 0);
 			}
 			cv::rectangle(output, cv::Point(initialBoxes[ii].x, initialBoxes[ii].y), cv::Point(initialBoxes[ii].x+initialBoxes[ii].width, initialBoxes[ii].y+initialBoxes[ii].height), cv::Scalar(0,255,0), 2, 1, 0);
 			cv::imshow("chains", output);
@@ -1542,7 +1595,7 @@ std::vector<cv::Rect> DetectText::chainPairs()
 	return initialBoxes;
 }
 
-void DetectText::chainToBox(std::vector<std::vector<int> >& chain, std::vector<cv::Rect>& boundingBox)
+void DetectText::chainToBox(PassContext& pass, std::vector<std::vector<int> >& chain, std::vector<cv::Rect>& boundingBox)
 {
 	for (size_t i = 0; i < chain.size(); i++)
 	{
@@ -1559,7 +1612,7 @@ void DetectText::chainToBox(std::vector<std::vector<int> >& chain, std::vector<c
 
 		for (size_t j = 0; j < chain[i].size(); j++)
 		{
-			cv::Rect itr = labeledRegions_[chain[i][j]];
+			cv::Rect itr = pass.labeledRegions[chain[i][j]];
 			letterAreaSum += itr.width * itr.height;
 			minX = std::min(minX, itr.x);
 			minY = std::min(minY, itr.y);
@@ -1570,16 +1623,8 @@ void DetectText::chainToBox(std::vector<std::vector<int> >& chain, std::vector<c
 			letterBox.r = itr;
 			letterBox.middlePoint = cv::Point(itr.x + 0.5 * (double)itr.width, itr.y + 0.5 * (double)itr.height);
 
-			if (firstPass_)
-			{
-				brightLetters_.push_back(itr);
-				letterBox.clr = BRIGHT;
-			}
-			else
-			{
-				darkLetters_.push_back(itr);
-				letterBox.clr = DARK;
-			}
+			pass.letters.push_back(itr);
+			letterBox.clr = pass.fontColor;
 
 			lettersInBox.push_back(letterBox);
 		}
@@ -1591,7 +1636,7 @@ void DetectText::chainToBox(std::vector<std::vector<int> >& chain, std::vector<c
 		maxY = std::min(grayImage_.rows, maxY + padding);
 
 		boundingBox.push_back(cv::Rect(minX, minY, maxX - minX, maxY - minY));
-		connectedComponents_.push_back(lettersInBox);
+		pass.connectedComponents.push_back(lettersInBox);
 	}
 }
 
@@ -1702,8 +1747,10 @@ void DetectText::merge(const std::vector<int>& token, std::vector<int>& chain)
 	}
 }
 
-void DetectText::filterBoundingBoxes(std::vector<cv::Rect>& boundingBoxes, cv::Mat& ccmap, int rejectRatio)
+void DetectText::filterBoundingBoxes(const PassContext& pass, std::vector<cv::Rect>& boundingBoxes, int rejectRatio)
 {
+	const cv::Mat& ccmap = pass.ccmap;
+
 	std::vector<cv::Rect> qualifiedBoxes;
 	std::vector<int> components;
 
@@ -1725,12 +1772,12 @@ void DetectText::filterBoundingBoxes(std::vector<cv::Rect>& boundingBoxes, cv::M
 		{
 			for (int x = rect.x; x < rect.x + rect.width; x++)
 			{
-				int componetIndex = static_cast<int>(ccmap.at<float>(y, x));
+				int componetIndex = ccmap.at<int>(y, x);
 
 				if (componetIndex < 0)
 					continue;
 
-				if (isLetterRegion_[componetIndex])
+				if (pass.isLetterRegion[componetIndex])
 					letterArea++;
 				else
 					nonLetterArea++;
@@ -1738,7 +1785,7 @@ void DetectText::filterBoundingBoxes(std::vector<cv::Rect>& boundingBoxes, cv::M
 				if (find(components.begin(), components.end(), componetIndex) == components.end())
 				{
 					components.push_back(componetIndex);
-					if (isLetterRegion_[componetIndex])
+					if (pass.isLetterRegion[componetIndex])
 						isLetterCount++;
 				}
 			}
@@ -1755,7 +1802,7 @@ void DetectText::filterBoundingBoxes(std::vector<cv::Rect>& boundingBoxes, cv::M
 	if (debug["showChains"])
 	{
 		cv::Mat output = originalImage_.clone();
-		if (firstPass_)
+		if (pass.fontColor == BRIGHT)
 		{
 			for (unsigned int i = 0; i < boundingBoxes.size(); i++)
 				rectangle(output, cv::Point(boundingBoxes[i].x, boundingBoxes[i].y),
@@ -1940,24 +1987,13 @@ void DetectText::combineNeighborBoxes(std::vector<cv::Rect>& originalBoxes)
 }
 
 
-void DetectText::breakLines(std::vector<cv::Rect>& boxes, std::vector<cv::RotatedRect>& lineEquations)
+void DetectText::breakLines(PassContext& pass, std::vector<cv::Rect>& boxes, std::vector<cv::RotatedRect>& lineEquations)
 {
 	// this function splits up bounding boxes of potentially multiline text into boxes around single line text
 
 	if (debug["showBreakLines"])
 		std::cout << "Breaking boxes into single-line boxes." << std::endl;
 
-	std::vector<cv::Rect> letters;
-
-	if (firstPass_)
-		letters = brightLetters_;
-//		for (unsigned int i = 0; i < brightLetters_.size(); i++)
-//			letters.push_back(brightLetters_[i]);
-	else
-		letters = darkLetters_;
-//		for (unsigned int i = 0; i < darkLetters_.size(); i++)
-//			letters.push_back(darkLetters_[i]);
-
 	//For every boundingBox:
 	std::vector<cv::Rect> splitUpBoxes;
 	for (unsigned int boxIndex = 0; boxIndex < boxes.size(); boxIndex++)
@@ -1969,8 +2005,8 @@ void DetectText::breakLines(std::vector<cv::Rect>& boxes, std::vector<cv::Rotate
 //		for (unsigned int i = 0; i < letters.size(); i++)
 //			if ((boxes[boxIndex] & letters[i]).area() / (letters[i].area()) == 1.0)
 //				currentLetterBoxes.push_back(letters[i]);
-		for (unsigned int i=0; i<connectedComponents_[boxIndex].size(); i++)
-			currentLetterBoxes.push_back(connectedComponents_[boxIndex][i].r);
+		for (unsigned int i=0; i<pass.connectedComponents[boxIndex].size(); i++)
+			currentLetterBoxes.push_back(pass.connectedComponents[boxIndex][i].r);
 
 		double averageLetterSize = 0;
 		for (unsigned int i = 0; i < currentLetterBoxes.size(); i++)
@@ -2017,7 +2053,7 @@ void DetectText::breakLines(std::vector<cv::Rect>& boxes, std::vector<cv::Rotate
 				// fill randomPointSet with random points for model
 				while (randomPointSet.size() < problemDimension)
 				{
-					int nn = (int)((std::rand() / (float) RAND_MAX) * currentPoints.size());
+					int nn = pass.rng.uniform(0, (int)currentPoints.size());
 					if (std::find(randomPointSet.begin(), randomPointSet.end(), nn) == randomPointSet.end())
 					{
 						randomPointSet.push_back(nn);
@@ -2361,11 +2397,11 @@ void DetectText::breakLines(std::vector<cv::Rect>& boxes, std::vector<cv::Rotate
 
 			std::vector<std::pair<cv::Point, cv::Point> > finalLines;
 
+			std::pair<int, int> lastP;
 			for (size_t i = 0; i < uniquePointsOverUnder.size(); i++)
 			{
 				std::pair<int, int> p = uniquePointsOverUnder[i]; // 4,8
 				std::cout << "p: " << p.first << "|" << p.second << std::endl;
-				static std::pair<int, int> lastP;
 				if (i == 0)
 					lastP = uniquePointsOverUnder[i];
 				else if (abs(p.first - lastP.first) < 2 || abs(p.second - lastP.second) < 2)
@@ -2695,16 +2731,6 @@ bool DetectText::spatialOrderX(cv::Rect a, cv::Rect b)
 	return a.x < b.x;
 }
 
-void DetectText::disposal()
-{
-	labeledRegions_.clear();
-	isLetterRegion_.clear();
-	meanRGB_.clear();
-	meanBgRGB_.clear();
-	letterGroups_.clear();
-	connectedComponents_.clear();
-}
-
 void DetectText::deleteDoubleBrokenWords(std::vector<cv::Rect>& boundingBoxes)
 {
 	unsigned int count = 0;
@@ -2827,9 +2853,9 @@ void DetectText::rotate()
 				{
 					if (boxFontColor_[i] == BRIGHT)
 					{
-						if (ccmapBright_.at<float> (y, x) != -2)
+						if (ccmapBright_.at<int> (y, x) != -2)
 						{
-							int angle = (int) ((180 / 3.141592) * theta_.at<float> (y, x)) + 180;
+							int angle = (int) ((180 / 3.141592) * atan2(dy_.at<float> (y, x), dx_.at<float> (y, x))) + 180;
 							hist[angle]++;
 							count++;
 							cv::rectangle(output, cv::Point(x, y), cv::Point(x, y), cv::Scalar(50, 110, 250), 2);
@@ -2837,9 +2863,9 @@ void DetectText::rotate()
 					}
 					else
 					{
-						if (ccmapDark_.at<float> (y, x) != -2)
+						if (ccmapDark_.at<int> (y, x) != -2)
 						{
-							int angle = (int) ((180 / 3.141592) * theta_.at<float> (y, x)) + 180;
+							int angle = (int) ((180 / 3.141592) * atan2(dy_.at<float> (y, x), dx_.at<float> (y, x))) + 180;
 							hist[angle]++;
 							count++;
 							cv::rectangle(output, cv::Point(x, y), cv::Point(x, y), cv::Scalar(50, 110, 250), 2);
@@ -3236,7 +3262,7 @@ cv::Mat DetectText::colorBackgroundBinary(cv::Mat & m, FontColor f, cv::Mat cc)
 	{
 		for (int x = 0; x < cc.cols; x++)
 		{
-			int component = static_cast<int> (cc.at<float> (y, x));
+			int component = cc.at<int> (y, x);
 
 			if (f == BRIGHT)
 			{
@@ -3463,13 +3489,13 @@ DetectText::bgr DetectText::findBorderColor(cv::Rect r, FontColor f)
 				int component;
 				if (f == BRIGHT)
 				{
-					component = static_cast<int> (ccmapBright_.at<float> (y + r.y, x + r.x));
+					component = ccmapBright_.at<int> (y + r.y, x + r.x);
 					if (component == -2)
 						bgColor.push_back(smallImg.at<bgr> (y, x));
 				}
 				else
 				{
-					component = static_cast<int> (ccmapDark_.at<float> (y + r.y, x + r.x));
+					component = ccmapDark_.at<int> (y + r.y, x + r.x);
 					if (component == -2)
 						bgColor.push_back(smallImg.at<bgr> (y, x));
 				}
@@ -3485,13 +3511,13 @@ DetectText::bgr DetectText::findBorderColor(cv::Rect r, FontColor f)
 				int component;
 				if (f == BRIGHT)
 				{
-					component = static_cast<int> (ccmapBright_.at<float> (y + r.y, x + r.x));
+					component = ccmapBright_.at<int> (y + r.y, x + r.x);
 					if (component == -2)
 						bgColor.push_back(smallImg.at<bgr> (y, x));
 				}
 				else
 				{
-					component = static_cast<int> (ccmapDark_.at<float> (y + r.y, x + r.x));
+					component = ccmapDark_.at<int> (y + r.y, x + r.x);
 					if (component == -2)
 						bgColor.push_back(smallImg.at<bgr> (y, x));
 				}
@@ -3525,16 +3551,65 @@ void DetectText::ocrRead(std::vector<cv::Mat> textImages)
 	else
 		imageVersions = 1;
 
-	std::vector<float> score;
-	std::vector<std::string> result;
+	// the tesseract engines are loaded once and reused for all following images
+	unsigned int numberEngines = (ocrThreads_ > 0) ? ocrThreads_ : std::max(1u, boost::thread::hardware_concurrency());
+	// (the pool reports a failed initialization once and is not initialized again)
+	if (ocrEngines_.size() != numberEngines && !ocrEngines_.failed())
+		ocrEngines_.init(numberEngines, "deu", "letters");
+
+	std::vector<float> score(textImages.size(), 100.f);
+	std::vector<std::string> result(textImages.size());
+	std::vector<std::string> logs(textImages.size());
+
+	// the boxes are read in the order of their quality score, so the best boxes are read first if the deadline stops the OCR
+	// (the score vector is empty if the boxes have not been rated)
+	unsigned int numberBoxes = textImages.size() / imageVersions;
+	OcrSchedule schedule;
+	if (finalBoundingBoxesQualityScore_.size() == numberBoxes)
+	{
+		std::vector<std::pair<double, unsigned int> > rating(numberBoxes);
+		for (unsigned int box = 0; box < numberBoxes; box++)
+			rating[box] = std::make_pair(-finalBoundingBoxesQualityScore_[box], box);
+		std::sort(rating.begin(), rating.end());
+		for (unsigned int box = 0; box < numberBoxes; box++)
+			schedule.order.push_back(rating[box].second);
+	}
+	else
+		for (unsigned int box = 0; box < numberBoxes; box++)
+			schedule.order.push_back(box);
+
+	// read all boxes in parallel, each worker uses its own engine
+	unsigned int numberWorkers = std::min<unsigned int>(ocrEngines_.size(), numberBoxes);
+	if (numberWorkers > 1)
+	{
+		boost::thread_group workers;
+		for (unsigned int w = 0; w < numberWorkers; w++)
+			workers.create_thread(boost::bind(&DetectText::ocrReadWorker, this, boost::cref(textImages), imageVersions, w, boost::ref(schedule), boost::ref(score),
+					boost::ref(result), boost::ref(logs)));
+		workers.join_all();
+	}
+	else if (numberWorkers == 1)
+		ocrReadWorker(textImages, imageVersions, 0, schedule, score, result, logs);
+	else
+		statistics_.counts[DetectionStatistics::UNREAD_BOXES] += numberBoxes; // the engine pool failed, this is no deadline pressure
+
+	// boxes that were not read keep score 100 and are not reported
+	statistics_.counts[DetectionStatistics::OCR_CALLS] += schedule.completed * imageVersions - schedule.cacheHits;
+	statistics_.counts[DetectionStatistics::OCR_CACHE_HITS] += schedule.cacheHits;
+	if (ocrCache_)
+		std::cout << "OCR cache: " << schedule.cacheHits << " of " << schedule.completed * imageVersions << " patches cached, " << ocrCache_->hits()
+				<< " hits and " << ocrCache_->misses() << " misses in total" << std::endl;
+	if (!deadline_.isZero() && numberWorkers > 0)
+		statistics_.counts[DetectionStatistics::SKIPPED_BOXES] += schedule.order.size() - schedule.next;
+	if (schedule.completed > 0)
+		ocrSecondsPerBox_ = schedule.seconds / schedule.completed;
+
 	for (size_t i = 0; i < textImages.size(); i++)
 	{
 		//    cv::imshow("roar", textImages[i]);
 		//    cv::waitKey(0);
 
-		std::string res;
-		score.push_back(ocrRead(textImages[i], res));
-		result.push_back(res);
+		std::cout << logs[i];
 
 		if ((i + 1) % imageVersions != 0) // collect all different version results before comparing
 			continue;
@@ -3567,27 +3642,71 @@ void DetectText::ocrRead(std::vector<cv::Mat> textImages)
 	}
 }
 
-float DetectText::ocrRead(const cv::Mat& image, std::string& output)
+void DetectText::ocrReadWorker(const std::vector<cv::Mat>& textImages, unsigned int imageVersions, unsigned int engineIndex, OcrSchedule& schedule,
+		std::vector<float>& scores, std::vector<std::string>& results, std::vector<std::string>& logs)
 {
-	float score = 0;
-	cv::imwrite("patch.tiff", image);
+	// every worker writes to the elements of the boxes it took from the schedule only
+	while (true)
+	{
+		unsigned int box;
+		{
+			boost::mutex::scoped_lock lock(schedule.mutex);
+			if (schedule.next == schedule.order.size())
+				return;
 
-	int result;
+			// stop before a box that would not be finished in time, the following boxes are not read either
+			double secondsPerBox = (schedule.completed > 0) ? schedule.seconds / schedule.completed : ocrSecondsPerBox_;
+			if (deadlinePassed(secondsPerBox))
+				return;
+			box = schedule.order[schedule.next++];
+		}
+
+		StageTimer timer;
+		unsigned int cacheHits = 0;
+		for (unsigned int i = box * imageVersions; i < (box + 1) * imageVersions; i++)
+		{
+			std::stringstream log;
+			OcrResultCache::Key key;
+			if (ocrCache_)
+			{
+				key = OcrResultCache::hash(textImages[i]);
+				if (ocrCache_->find(key, results[i], scores[i]))
+				{
+					log << "cached: \"" << results[i] << "\" , score: " << scores[i] << std::endl;
+					logs[i] = log.str();
+					cacheHits++;
+					continue;
+				}
+			}
+			scores[i] = ocrRead(textImages[i], results[i], engineIndex, log);
+			if (ocrCache_)
+				ocrCache_->insert(key, results[i], scores[i]);
+			logs[i] = log.str();
+		}
+		double seconds = timer.elapsed();
+
+		boost::mutex::scoped_lock lock(schedule.mutex);
+		schedule.completed++;
+		schedule.cacheHits += cacheHits;
+		schedule.seconds += seconds;
+	}
+}
 
-	std::string cmd = ros::package::getPath("cob_tesseract") + "/bin/tesseract patch.tiff patch -psm 7 -l deu letters"; // before: psm -8
-	result = system(cmd.c_str());
+float DetectText::ocrRead(const cv::Mat& image, std::string& output, unsigned int engineIndex, std::ostream& log)
+{
+	float score = 0;
 
-	assert(!result);
-	std::ifstream fin("patch.txt");
+	// tesseract reads the patch directly from memory (psm 7, language deu, config letters)
+	std::stringstream fin(ocrEngines_.recognize(engineIndex, image));
 	std::string str;
 
 	int loopCount = 0;
 	while (fin >> str)
 	{
-		std::cout << str << " ";
+		log << str << " ";
 		std::string tempOutput;
 		score += spellCheck(str, tempOutput, 2);
-		std::cout << " -->  \"" << tempOutput.substr(0, tempOutput.length() - 1) << "\" , score: " << score << std::endl;
+		log << " -->  \"" << tempOutput.substr(0, tempOutput.length() - 1) << "\" , score: " << score << std::endl;
 		output += tempOutput;
 		loopCount++;
 	}
@@ -3597,7 +3716,6 @@ float DetectText::ocrRead(const cv::Mat& image, std::string& output)
 	if (output.size() == 0)
 		score = 100;
 
-	result = system("$(rm patch.txt patch.tiff)");
 	return score;
 }
 
@@ -3769,59 +3887,20 @@ std::string& DetectText::trim(std::string& str)
 void DetectText::getTopkWords(const std::string& str, const int k, std::vector<Word>& words) //k=3
 {
 	bool correlationUsage = true;
-	float score, lowestScore = 100;
+	float lowestScore = 100;
 	words.clear();
 	words.resize(k);
-	for (size_t i = 0; i < wordList_.size(); i++)
-	{
-		if (correlationUsage)
-			score = editDistanceFont(str, wordList_[i]); //compare every word in dictionary, score=0 -> perfect
-		else
-			score = editDistance(str, wordList_[i]); //compare every word in dictionary, score=0 -> perfect
 
-
-		if (score < lowestScore)
-		{
-			Word w = Word(wordList_[i], score);
-			lowestScore = insertToList(words, w);
-		}
-	}
+	// same result as comparing every word in dictionary with editDistanceFont/editDistance, score=0 -> perfect
+	std::vector<DictionaryIndex::Match> matches;
+	dictionaryIndex_.search(str, k, correlationUsage, lowestScore, matches);
+	for (size_t i = 0; i < matches.size(); i++)
+		words[i] = Word(wordList_[matches[i].wordIndex], matches[i].score);
 }
 
 int DetectText::editDistance(const std::string& s, const std::string& t)
 {
-	int n = s.length();
-	int m = t.length();
-
-	if (n == 0)
-		return m;
-	if (m == 0)
-		return n;
-
-	int **d = new int*[n + 1];
-	for (int i = 0; i < n + 1; i++)
-	{
-		d[i] = new int[m + 1];
-		memset(d[i], 0, (m + 1) * sizeof(int));
-	}
-
-	for (int i = 0; i < n + 1; i++)
-		d[i][0] = i;
-	for (int j = 0; j < m + 1; j++)
-		d[0][j] = j;
-
-	for (int i = 1; i < n + 1; i++)
-	{
-		char sc = s[i - 1];
-		for (int j = 1; j < m + 1; j++)
-		{
-			int v = d[i - 1][j - 1];
-			if (t[j - 1] != sc)
-				v++;
-			d[i][j] = std::min(std::min(d[i - 1][j] + 1, d[i][j - 1] + 1), v);
-		}
-	}
-	return d[n][m];
+	return editDistanceKernel_.levenshtein(s, t);
 }
 
 float DetectText::editDistanceFont(const std::string& word, const std::string& dictionaryWord)
@@ -3866,59 +3945,7 @@ float DetectText::editDistanceFont(const std::string& word, const std::string& d
 	// with two identical words, the diagonal line of d is 0 (d[0][0]=0,d[1][1]=0,d[2][2]...). At the end the last element of d is taken as score result.
 
 
-	float penalty = 0.7;
-	int wordLength = word.length();
-	int dictionaryWordLength = dictionaryWord.length();
-
-	if (wordLength == 0)
-		return dictionaryWordLength;
-	if (dictionaryWordLength == 0)
-		return wordLength;
-
-	std::vector<std::vector<float> > d(wordLength + 1, std::vector<float>(dictionaryWordLength + 1));
-
-	for (int i = 0; i < wordLength + 1; i++)
-		for (int j = 0; j < dictionaryWordLength + 1; j++)
-			d[i][j] = 0;
-
-	for (int i = 0; i < wordLength + 1; i++)
-		d[i][0] = i;
-
-	for (int j = 0; j < dictionaryWordLength + 1; j++)
-		d[0][j] = j;
-
-	for (int i = 1; i < wordLength + 1; i++)
-	{
-		//char sc = word[i - 1];
-		std::string sc = word.substr(i - 1, 1);
-		for (int j = 1; j < dictionaryWordLength + 1; j++)
-		{
-			float v = d[i - 1][j - 1];
-			//if ((dictionaryWord[j - 1] != sc))
-			if ((dictionaryWord.substr(j - 1, 1).compare(sc) != 0))
-			{
-				float correlate;
-				if (sc.compare("-") != 0)
-				{
-					int a = getCorrelationIndex(dictionaryWord.substr(j - 1, 1));//dictionaryWord[j - 1]);
-					int b = getCorrelationIndex(sc);
-					if (a == -1 || b == -1)
-						correlate = 0;
-					else
-						correlate = correlation_.at<float> (a, b);
-				}
-				else
-				{
-					correlate = 1;
-				}
-				v = v + 1 - correlate;
-			}
-			d[i][j] = std::min(std::min(d[i - 1][j] + penalty, d[i][j - 1] + penalty), v);
-		}
-	}
-	float result = d[wordLength][dictionaryWordLength];
-
-	return result;
+	return editDistanceKernel_.fontDistance(word, dictionaryWord);
 }
 
 int DetectText::getCorrelationIndex(std::string letter)
@@ -4068,227 +4095,288 @@ void DetectText::writeTxtsForEval()
 	file3.close();
 }
 
-void DetectText::ransacPipeline(std::vector<cv::Rect> & boundingBoxes)
+void DetectText::ransacPipeline(PassContext& pass, std::vector<cv::Rect> & boundingBoxes)
 {
-	std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > ransacSet;
-
-	std::vector<cv::Rect> ransacBoxes;
+	// the text lines of every box are found independently of the other boxes, so the boxes are split among several threads
+	// and the threads of ransac() are divided among the boxes (debug windows force serial processing)
+	unsigned int numberBoxes = boundingBoxes.size();
+	int numberThreads = (debug["showBezier"] || debug["showRansac"]) ? 1 : resolveNumberThreads(ransacThreads_);
+	unsigned int numberTasks = std::max(1, std::min((int)numberBoxes, numberThreads));
+	int ransacThreads = std::max(1, numberThreads / (int)numberTasks);
+
+	// boxes with many letters first, they are the last ones to be skipped if the deadline is reached during the rectification
+	std::vector<std::pair<int, unsigned int> > rating(numberBoxes);
+	for (unsigned int boxIndex = 0; boxIndex < numberBoxes; boxIndex++)
+		rating[boxIndex] = std::make_pair(-(int)pass.connectedComponents[boxIndex].size(), boxIndex);
+	std::sort(rating.begin(), rating.end());
+	std::vector<unsigned int> order(numberBoxes);
+	for (unsigned int boxIndex = 0; boxIndex < numberBoxes; boxIndex++)
+		order[boxIndex] = rating[boxIndex].second;
+
+	std::vector<std::vector<BezierLine> > lines(numberBoxes);
+	std::vector<double> taskSeconds(numberTasks, 0.), bezierSeconds(numberTasks, 0.);
+	StageTimer timer;
+	parallelTasks(numberTasks, boost::bind(&DetectText::ransacBoxes, this, boost::cref(pass), boost::cref(order), numberTasks, ransacThreads,
+			boost::ref(lines), boost::ref(taskSeconds), boost::ref(bezierSeconds), _1));
+	double seconds = timer.elapsed();
+
+	// the tasks overlap, so transformBezier gets its share of the wall time instead of its summed time
+	double summedTaskSeconds = 0., summedBezierSeconds = 0.;
+	for (unsigned int task = 0; task < numberTasks; task++)
+	{
+		summedTaskSeconds += taskSeconds[task];
+		summedBezierSeconds += bezierSeconds[task];
+	}
+	if (summedTaskSeconds > 0.)
+		pass.statistics.seconds[DetectionStatistics::OCR_PREPROCESS] += seconds * summedBezierSeconds / summedTaskSeconds;
 
-	for (unsigned int boxIndex = 0; boxIndex < boundingBoxes.size(); boxIndex++)
+	// results in the order of the boxes
+	for (unsigned int boxIndex = 0; boxIndex < numberBoxes; boxIndex++)
 	{
-		//    cv::Mat output = originalImage_.clone();
+		for (unsigned int i = 0; i < lines[boxIndex].size(); i++)
+		{
+			// lines without rectified image were skipped because of the deadline
+			if (transformImages && !deadline_.isZero() && lines[boxIndex][i].transformedImage.empty())
+			{
+				pass.statistics.counts[DetectionStatistics::SKIPPED_BOXES]++;
+				continue;
+			}
+
+			pass.transformedImage.push_back(lines[boxIndex][i].transformedImage);
+			pass.notTransformedImage.push_back(lines[boxIndex][i].notTransformedImage);
 
-		cv::Rect r = boundingBoxes[boxIndex];
+			pass.finalBoundingBoxes.push_back(lines[boxIndex][i].box);
+			pass.finalRotatedBoundingBoxes.push_back(lines[boxIndex][i].rotatedBox);
+			pass.finalBoundingBoxesQualityScore.push_back(lines[boxIndex][i].qualityScore);
+		}
+	}
+}
 
-		ransacSet = ransac(connectedComponents_[boxIndex]);
+void DetectText::ransacBoxes(const PassContext& pass, const std::vector<unsigned int>& order, unsigned int numberTasks, int ransacThreads,
+		std::vector<std::vector<BezierLine> >& lines, std::vector<double>& taskSeconds, std::vector<double>& bezierSeconds, unsigned int task)
+{
+	StageTimer timer;
+	for (unsigned int i = task; i < order.size(); i += numberTasks)
+		fitBezierLines(pass, order[i], ransacThreads, lines[order[i]], bezierSeconds[task]);
+	taskSeconds[task] = timer.elapsed();
+}
 
-		// transform text based on bezier line
-		// calculate height and width of transformed image
-		for (unsigned int i = 0; i < ransacSet.size(); i++)
-		{
-			cv::Mat model = createBezierCurve(ransacSet[i].second, debug["showBezier"]); // todo: parameter showBezier
+void DetectText::fitBezierLines(const PassContext& pass, unsigned int boxIndex, int ransacThreads, std::vector<BezierLine>& lines, double& bezierSeconds)
+{
+	std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > ransacSet = ransac(pass.connectedComponents[boxIndex], ransacThreads, boxIndex);
+
+	// transform text based on bezier line
+	// calculate height and width of transformed image
+	for (unsigned int i = 0; i < ransacSet.size(); i++)
+	{
+		cv::Mat model = createBezierCurve(ransacSet[i].second, debug["showBezier"]); // todo: parameter showBezier
+		BezierCurve curve(model);
 
-			float biggestDistance = 0; // -> height of transformed image
-			float minDistance = 1e5;
-			float minDistanceLast = 1e5;
-			float minT = 0, maxT = 1; // -> to calculate width of transformed image
+		float biggestDistance = 0; // -> height of transformed image
+		float minDistance = 1e5;
+		float minDistanceLast = 1e5;
+		float minT = 0, maxT = 1; // -> to calculate width of transformed image
 
-			for (unsigned int j = 0; j < ransacSet[i].first.size(); j++)
+		for (unsigned int j = 0; j < ransacSet[i].first.size(); j++)
+		{
+			for (unsigned int k = 0; k < pass.connectedComponents[boxIndex].size(); k++)
 			{
-				for (unsigned int k = 0; k < connectedComponents_[boxIndex].size(); k++)
+				if ((ransacSet[i].first[j]).inside(pass.connectedComponents[boxIndex][k].r))
 				{
-					if ((ransacSet[i].first[j]).inside(connectedComponents_[boxIndex][k].r))
+					// todo: wouldn't it be sufficient to check the 4 corner points of the bounding box?
+					// probably not because curve is bent
+
+					// get max distance from curve
+					// calculate distance of all border pixels of components to the curve
+					for (int y = pass.connectedComponents[boxIndex][k].r.y, x = pass.connectedComponents[boxIndex][k].r.x; y
+							< pass.connectedComponents[boxIndex][k].r.y + pass.connectedComponents[boxIndex][k].r.height; y++) // todo: y += height
 					{
-						// todo: wouldn't it be sufficient to check the 4 corner points of the bounding box?
-						// probably not because curve is bent
+						std::pair<float, float> distanceT = curve.distance(cv::Point(x, y));
+						if (biggestDistance < distanceT.first)
+							biggestDistance = distanceT.first;
 
-						// get max distance from curve
-						// calculate distance of all border pixels of components to the curve
-						for (int y = connectedComponents_[boxIndex][k].r.y, x = connectedComponents_[boxIndex][k].r.x; y
-								< connectedComponents_[boxIndex][k].r.y + connectedComponents_[boxIndex][k].r.height; y++) // todo: y += height
-						{
-							std::pair<float, float> distanceT = getBezierDistance(model, cv::Point(x, y));
-							if (biggestDistance < distanceT.first)
-								biggestDistance = distanceT.first;
-
-							// if actual component is first component of model, get nearest Point on border to calculate minimum t
-							if (ransacSet[i].second[0] == ransacSet[i].first[j])
-								if (distanceT.first < minDistance && distanceT.second < 0)
-								{
-									minDistance = distanceT.first;
-									minT = distanceT.second;
-								}
-
-							// if actual component is last component of model, get nearest Point on border to calculate maximum t
-							if (ransacSet[i].second[2] == ransacSet[i].first[j])
-								if (distanceT.first < minDistanceLast && distanceT.second > 1)
-								{
-									minDistanceLast = distanceT.first;
-									maxT = distanceT.second;
-								}
-						}
+						// if actual component is first component of model, get nearest Point on border to calculate minimum t
+						if (ransacSet[i].second[0] == ransacSet[i].first[j])
+							if (distanceT.first < minDistance && distanceT.second < 0)
+							{
+								minDistance = distanceT.first;
+								minT = distanceT.second;
+							}
 
-						for (int y = connectedComponents_[boxIndex][k].r.y, x = connectedComponents_[boxIndex][k].r.x
-								+ connectedComponents_[boxIndex][k].r.width; y < connectedComponents_[boxIndex][k].r.y
-								+ connectedComponents_[boxIndex][k].r.height; y++)
-						{
-							std::pair<float, float> distanceT = getBezierDistance(model, cv::Point(x, y));
-							if (biggestDistance < distanceT.first)
-								biggestDistance = distanceT.first;
-							if (ransacSet[i].second[0] == ransacSet[i].first[j])
-								if (distanceT.first < minDistance && distanceT.second < 0)
-								{
-									minDistance = distanceT.first;
-									minT = distanceT.second;
-								}
-
-							if (ransacSet[i].second[2] == ransacSet[i].first[j])
-								if (distanceT.first < minDistanceLast && distanceT.second > 1)
-								{
-									minDistanceLast = distanceT.first;
-									maxT = distanceT.second;
-								}
-						}
-						for (int x = connectedComponents_[boxIndex][k].r.x, y = connectedComponents_[boxIndex][k].r.y; x
-								< connectedComponents_[boxIndex][k].r.x + connectedComponents_[boxIndex][k].r.width; x++)
-						{
-							std::pair<float, float> distanceT = getBezierDistance(model, cv::Point(x, y));
-							if (biggestDistance < distanceT.first)
-								biggestDistance = distanceT.first;
-							if (ransacSet[i].second[0] == ransacSet[i].first[j])
-								if (distanceT.first < minDistance && distanceT.second < 0)
-								{
-									minDistance = distanceT.first;
-									minT = distanceT.second;
-								}
-
-							if (ransacSet[i].second[2] == ransacSet[i].first[j])
-								if (distanceT.first < minDistanceLast && distanceT.second > 1)
-								{
-									minDistanceLast = distanceT.first;
-									maxT = distanceT.second;
-								}
-						}
-						for (int x = connectedComponents_[boxIndex][k].r.x, y = connectedComponents_[boxIndex][k].r.y
-								+ connectedComponents_[boxIndex][k].r.height; x < connectedComponents_[boxIndex][k].r.x
-								+ connectedComponents_[boxIndex][k].r.width; x++)
-						{
-							std::pair<float, float> distanceT = getBezierDistance(model, cv::Point(x, y));
-							if (biggestDistance < distanceT.first)
-								biggestDistance = distanceT.first;
-							if (ransacSet[i].second[0] == ransacSet[i].first[j])
-								if (distanceT.first < minDistance && distanceT.second < 0)
-								{
-									minDistance = distanceT.first;
-									minT = distanceT.second;
-								}
-
-							if (ransacSet[i].second[2] == ransacSet[i].first[j])
-								if (distanceT.first < minDistanceLast && distanceT.second > 1)
-								{
-									minDistanceLast = distanceT.first;
-									maxT = distanceT.second;
-								}
-						}
+						// if actual component is last component of model, get nearest Point on border to calculate maximum t
+						if (ransacSet[i].second[2] == ransacSet[i].first[j])
+							if (distanceT.first < minDistanceLast && distanceT.second > 1)
+							{
+								minDistanceLast = distanceT.first;
+								maxT = distanceT.second;
+							}
 					}
-				}
-			}
-
-			float h = biggestDistance + 2; // 2*2 pixel padding
-			float l = getBezierLength(model, minT < 0 ? minT * 1.1 : minT * 0.9, maxT * 1.1);
 
-			cv::Mat rotatedBezier(h * 2, l, CV_8UC3, cv::Scalar(255, 255, 255));
+					for (int y = pass.connectedComponents[boxIndex][k].r.y, x = pass.connectedComponents[boxIndex][k].r.x
+							+ pass.connectedComponents[boxIndex][k].r.width; y < pass.connectedComponents[boxIndex][k].r.y
+							+ pass.connectedComponents[boxIndex][k].r.height; y++)
+					{
+						std::pair<float, float> distanceT = curve.distance(cv::Point(x, y));
+						if (biggestDistance < distanceT.first)
+							biggestDistance = distanceT.first;
+						if (ransacSet[i].second[0] == ransacSet[i].first[j])
+							if (distanceT.first < minDistance && distanceT.second < 0)
+							{
+								minDistance = distanceT.first;
+								minT = distanceT.second;
+							}
 
-			// make new bounding box
-			int minX = 1e5, maxX = 0, minY = 1e5, maxY = 0;
+						if (ransacSet[i].second[2] == ransacSet[i].first[j])
+							if (distanceT.first < minDistanceLast && distanceT.second > 1)
+							{
+								minDistanceLast = distanceT.first;
+								maxT = distanceT.second;
+							}
+					}
+					for (int x = pass.connectedComponents[boxIndex][k].r.x, y = pass.connectedComponents[boxIndex][k].r.y; x
+							< pass.connectedComponents[boxIndex][k].r.x + pass.connectedComponents[boxIndex][k].r.width; x++)
+					{
+						std::pair<float, float> distanceT = curve.distance(cv::Point(x, y));
+						if (biggestDistance < distanceT.first)
+							biggestDistance = distanceT.first;
+						if (ransacSet[i].second[0] == ransacSet[i].first[j])
+							if (distanceT.first < minDistance && distanceT.second < 0)
+							{
+								minDistance = distanceT.first;
+								minT = distanceT.second;
+							}
 
-			for (unsigned int letterIndex = 0; letterIndex < ransacSet[i].first.size(); letterIndex++)
-			{
-				for (unsigned int k = 0; k < connectedComponents_[boxIndex].size(); k++)
-				{
-					if ((ransacSet[i].first[letterIndex]).inside(connectedComponents_[boxIndex][k].r))
+						if (ransacSet[i].second[2] == ransacSet[i].first[j])
+							if (distanceT.first < minDistanceLast && distanceT.second > 1)
+							{
+								minDistanceLast = distanceT.first;
+								maxT = distanceT.second;
+							}
+					}
+					for (int x = pass.connectedComponents[boxIndex][k].r.x, y = pass.connectedComponents[boxIndex][k].r.y
+							+ pass.connectedComponents[boxIndex][k].r.height; x < pass.connectedComponents[boxIndex][k].r.x
+							+ pass.connectedComponents[boxIndex][k].r.width; x++)
 					{
-						if (connectedComponents_[boxIndex][k].r.x < minX)
-							minX = connectedComponents_[boxIndex][k].r.x;
-						if (connectedComponents_[boxIndex][k].r.y < minY)
-							minY = connectedComponents_[boxIndex][k].r.y;
-						if (connectedComponents_[boxIndex][k].r.x + connectedComponents_[boxIndex][k].r.width > maxX)
-							maxX = connectedComponents_[boxIndex][k].r.x + connectedComponents_[boxIndex][k].r.width;
-						if (connectedComponents_[boxIndex][k].r.y + connectedComponents_[boxIndex][k].r.height > maxY)
-							maxY = connectedComponents_[boxIndex][k].r.y + connectedComponents_[boxIndex][k].r.height;
+						std::pair<float, float> distanceT = curve.distance(cv::Point(x, y));
+						if (biggestDistance < distanceT.first)
+							biggestDistance = distanceT.first;
+						if (ransacSet[i].second[0] == ransacSet[i].first[j])
+							if (distanceT.first < minDistance && distanceT.second < 0)
+							{
+								minDistance = distanceT.first;
+								minT = distanceT.second;
+							}
+
+						if (ransacSet[i].second[2] == ransacSet[i].first[j])
+							if (distanceT.first < minDistanceLast && distanceT.second > 1)
+							{
+								minDistanceLast = distanceT.first;
+								maxT = distanceT.second;
+							}
 					}
 				}
 			}
+		}
 
-			cv::Rect newR(minX, minY, maxX - minX, maxY - minY);
+		float h = biggestDistance + 2; // 2*2 pixel padding
+		float l = getBezierLength(model, minT < 0 ? minT * 1.1 : minT * 0.9, maxT * 1.1);
 
-			// form rotatedRect
-			if (debug["showRansac"] == true)
-			{
-				std::cout << "point #1: " << model.at<float> (0, 2) << "|" << model.at<float> (1, 2) << std::endl;
-				std::cout << "point #2: " << model.at<float> (0, 0) + model.at<float> (0, 1) + model.at<float> (0, 2) << "|" << model.at<float> (1, 0)
-						+ model.at<float> (1, 1) + model.at<float> (1, 2) << std::endl;
-				std::cout << "point #3: " << 0.25 * model.at<float> (0, 0) + 0.5 * model.at<float> (0, 1) + model.at<float> (0, 2) << "|" << 0.25 * model.at<
-						float> (1, 0) + 0.5 * model.at<float> (1, 1) + model.at<float> (1, 2) << std::endl;
-			}
-			std::vector<cv::Point> pointvector;
-			pointvector.push_back(cv::Point(model.at<float> (0, 2), model.at<float> (1, 2)));
-			pointvector.push_back(
-					cv::Point(model.at<float> (0, 0) + model.at<float> (0, 1) + model.at<float> (0, 2),
-							model.at<float> (1, 0) + model.at<float> (1, 1) + model.at<float> (1, 2)));
-			pointvector.push_back(
-					cv::Point(0.25 * model.at<float> (0, 0) + 0.5 * model.at<float> (0, 1) + model.at<float> (0, 2),
-							0.25 * model.at<float> (1, 0) + 0.5 * model.at<float> (1, 1) + model.at<float> (1, 2)));
-			cv::RotatedRect rr = cv::minAreaRect(pointvector);
-
-			cv::Mat img;
-			cv::Point2f vertices[4];
-			if (debug["showRansac"] == true)
-			{
-				img = originalImage_.clone();
-				rr.points(vertices);
-				for (int i = 0; i < 4; i++)
-					cv::line(img, vertices[i], vertices[(i + 1) % 4], cv::Scalar(255, 255, 255));
-				cv::imshow("img", img);
-			}
+		cv::Mat rotatedBezier(h * 2, l, CV_8UC3, cv::Scalar(255, 255, 255));
 
-			h = biggestDistance;
-			// change height and width of rotatedRect.
-			// as the angle can be ambiguous, the size is changed based on what's bigger.
-			if (rr.size.height > rr.size.width)
-			{
-				rr.size.height = 2 * h > l ? 2 * h : l;
-				rr.size.width = 2 * h > l ? l : 2 * h;
-			}
-			else
-			{
-				rr.size.height = 2 * h > l ? l : 2 * h;
-				rr.size.width = 2 * h > l ? 2 * h : l;
-			}
+		// make new bounding box
+		int minX = 1e5, maxX = 0, minY = 1e5, maxY = 0;
 
-			if (debug["showRansac"] == true)
+		for (unsigned int letterIndex = 0; letterIndex < ransacSet[i].first.size(); letterIndex++)
+		{
+			for (unsigned int k = 0; k < pass.connectedComponents[boxIndex].size(); k++)
 			{
-				rr.points(vertices);
-				for (int i = 0; i < 4; i++)
-					cv::line(img, vertices[i], vertices[(i + 1) % 4], cv::Scalar(255, 255, 255));
-				cv::imshow("img2", img);
-				std::cout << "rr.angle:" << rr.angle << std::endl;
-				cv::waitKey(0);
+				if ((ransacSet[i].first[letterIndex]).inside(pass.connectedComponents[boxIndex][k].r))
+				{
+					if (pass.connectedComponents[boxIndex][k].r.x < minX)
+						minX = pass.connectedComponents[boxIndex][k].r.x;
+					if (pass.connectedComponents[boxIndex][k].r.y < minY)
+						minY = pass.connectedComponents[boxIndex][k].r.y;
+					if (pass.connectedComponents[boxIndex][k].r.x + pass.connectedComponents[boxIndex][k].r.width > maxX)
+						maxX = pass.connectedComponents[boxIndex][k].r.x + pass.connectedComponents[boxIndex][k].r.width;
+					if (pass.connectedComponents[boxIndex][k].r.y + pass.connectedComponents[boxIndex][k].r.height > maxY)
+						maxY = pass.connectedComponents[boxIndex][k].r.y + pass.connectedComponents[boxIndex][k].r.height;
+				}
 			}
+		}
+
+		cv::Rect newR(minX, minY, maxX - minX, maxY - minY);
+
+		// form rotatedRect
+		if (debug["showRansac"] == true)
+		{
+			std::cout << "point #1: " << model.at<float> (0, 2) << "|" << model.at<float> (1, 2) << std::endl;
+			std::cout << "point #2: " << model.at<float> (0, 0) + model.at<float> (0, 1) + model.at<float> (0, 2) << "|" << model.at<float> (1, 0)
+					+ model.at<float> (1, 1) + model.at<float> (1, 2) << std::endl;
+			std::cout << "point #3: " << 0.25 * model.at<float> (0, 0) + 0.5 * model.at<float> (0, 1) + model.at<float> (0, 2) << "|" << 0.25 * model.at<
+					float> (1, 0) + 0.5 * model.at<float> (1, 1) + model.at<float> (1, 2) << std::endl;
+		}
+		std::vector<cv::Point> pointvector;
+		pointvector.push_back(cv::Point(model.at<float> (0, 2), model.at<float> (1, 2)));
+		pointvector.push_back(
+				cv::Point(model.at<float> (0, 0) + model.at<float> (0, 1) + model.at<float> (0, 2),
+						model.at<float> (1, 0) + model.at<float> (1, 1) + model.at<float> (1, 2)));
+		pointvector.push_back(
+				cv::Point(0.25 * model.at<float> (0, 0) + 0.5 * model.at<float> (0, 1) + model.at<float> (0, 2),
+						0.25 * model.at<float> (1, 0) + 0.5 * model.at<float> (1, 1) + model.at<float> (1, 2)));
+		cv::RotatedRect rr = cv::minAreaRect(pointvector);
 
-			transformBezier(newR, model, rotatedBezier, minT < 0 ? minT * 1.1 : minT * 0.9, maxT * 1.1);
+		cv::Mat img;
+		cv::Point2f vertices[4];
+		if (debug["showRansac"] == true)
+		{
+			img = originalImage_.clone();
+			rr.points(vertices);
+			for (int i = 0; i < 4; i++)
+				cv::line(img, vertices[i], vertices[(i + 1) % 4], cv::Scalar(255, 255, 255));
+			cv::imshow("img", img);
+		}
 
-			transformedImage_.push_back(rotatedBezier);
-			notTransformedImage_.push_back(originalImage_(newR));
+		h = biggestDistance;
+		// change height and width of rotatedRect.
+		// as the angle can be ambiguous, the size is changed based on what's bigger.
+		if (rr.size.height > rr.size.width)
+		{
+			rr.size.height = 2 * h > l ? 2 * h : l;
+			rr.size.width = 2 * h > l ? l : 2 * h;
+		}
+		else
+		{
+			rr.size.height = 2 * h > l ? l : 2 * h;
+			rr.size.width = 2 * h > l ? 2 * h : l;
+		}
 
-			finalBoundingBoxes_.push_back(newR);
-			finalRotatedBoundingBoxes_.push_back(rr);
+		if (debug["showRansac"] == true)
+		{
+			rr.points(vertices);
+			for (int i = 0; i < 4; i++)
+				cv::line(img, vertices[i], vertices[(i + 1) % 4], cv::Scalar(255, 255, 255));
+			cv::imshow("img2", img);
+			std::cout << "rr.angle:" << rr.angle << std::endl;
+			cv::waitKey(0);
+		}
 
+		BezierLine line;
+		if (!deadlinePassed()) // otherwise the line is dropped by ransacPipeline, it could not be read in time anyway
+		{
+			StageTimer bezierTimer;
+			transformBezier(newR, model, rotatedBezier, minT < 0 ? minT * 1.1 : minT * 0.9, maxT * 1.1, pass.fontColor);
+			bezierSeconds += bezierTimer.elapsed();
+			line.transformedImage = rotatedBezier;
 		}
+		line.notTransformedImage = originalImage_(newR);
+		line.box = newR;
+		line.rotatedBox = rr;
+		line.qualityScore = ransacSet[i].first.size();
+		lines.push_back(line);
 	}
 }
 
-std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > DetectText::ransac(std::vector<connectedComponent> dataset)
+std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > DetectText::ransac(std::vector<connectedComponent> dataset, int numberThreads, unsigned int seed)
 {
 	// calculates best quadratic Bézier Curves out of all points in dataset
 	// returns 1 or more models, each returned vector-element includes all points that support the model and as second pair-element the 3 model-describing points
@@ -4302,6 +4390,17 @@ std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > DetectT
 
 	cv::Mat output;
 
+	// The models are sampled in this thread and evaluated in batches. A batch is split among several threads if it needs enough
+	// distance computations to be worth starting them, debug windows show one model after the other.
+	bool showBezier = debug["showBezier"];
+	numberThreads = showBezier ? 1 : resolveNumberThreads(numberThreads);
+	const unsigned int batchSize = showBezier ? 1 : 8 * numberThreads;
+	const unsigned int minParallelDistances = 2048;
+	std::vector<BezierHypothesis> batch;
+
+	// fixed seed per box: reproducible results, independent of the thread count and of the boxes fitted at the same time
+	cv::RNG rng(0x5eed0000u ^ seed);
+
 	// if box contains lines of text, a sub-dataset is build at the end of every iteration with the remaining points that were not used.
 	// when sub-dataset doesn't contain more than 2 components anymore, the algorithm ends
 	while (dataset.size() >= 3)
@@ -4329,7 +4428,7 @@ std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > DetectT
 		if (dataset.size() == 3) // if there are only 3 components, don't calculate 200 identical models...
 			n = 1;
 
-		if (debug["showBezier"])
+		if (showBezier)
 		{
 			std::cout << "-----------------------" << std::endl << std::endl;
 			for (unsigned int i = 0; i < dataset.size(); i++)
@@ -4341,199 +4440,150 @@ std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > DetectT
 			std::cout << std::endl << n << " iterations.." << std::endl;
 		}
 
-		std::vector<cv::Point> modelset(bezierDegree);
+		// calculate maxDistance, maxDistance = max. distance between point and curve so that point still supports model
+		// todo: maxDistance and Reject Criterion #1 use the first 3 components of the dataset, not the sampled ones
+		std::vector<float> rectsArea;
+		for (unsigned int distanceParameterIndex = 0; distanceParameterIndex < bezierDegree; distanceParameterIndex++)
+			rectsArea.push_back(std::sqrt(dataset[distanceParameterIndex].r.area()));
+
+		float maxDistance = 0;
+		for (unsigned int k = 0; k < rectsArea.size(); k++)
+			maxDistance += rectsArea[k];
+		maxDistance = distanceParameter * (maxDistance / bezierDegree);
+
+		// Reject Criterion #1: Reject model if letter sizes are too different
+		bool lettersTooDifferent = std::max(rectsArea[0], rectsArea[1]) / (std::min(rectsArea[0], rectsArea[1])) > 3 // todo: (i) make this a parameter, (ii) avoid division
+				|| std::max(rectsArea[0], rectsArea[2]) / (std::min(rectsArea[0], rectsArea[2])) > 3
+				|| std::max(rectsArea[1], rectsArea[2]) / (std::min(rectsArea[1], rectsArea[2])) > 3;
+
 		std::vector<cv::Point> finalModel; // 3 points describing best supported model
 		std::vector<cv::Point> finalGoodPoints; // all points of best supported model after all iterations
 		std::vector<float> finalTs; // t's, describing position on bezier model of all final points
 
-		std::srand(time(NULL));
 		int modelNr = -1;
 
 		float highestScore = 0;
+		float bestInlierRatio = 0; // share of the points that support the best model
 
-		for (unsigned int i = 0; i < n; i++) // Main Loop, n = number of models that will be created
+		unsigned int numberIterations = lettersTooDifferent ? 0 : (unsigned int)std::ceil(n);
+		for (unsigned int first = 0; first < numberIterations; first += batch.size()) // Main Loop, n = number of models that will be created
 		{
-			std::vector<float> rectsArea;
-			cv::Mat output2;
-
-			std::vector<int> actualRandomSet; // which 3 points are chosen (index)
-			std::vector<cv::Point> actualRandomPointSet; // which 3 points are chosen (point)
-			std::vector<cv::Point> goodPoints; //which points support the model
-			std::vector<float> ts; // all ts, t as in C(t)
-
-			// fill actualRandomSet with random points for model
-			//for (unsigned int j = 0; j < bezierDegree; j++) // todo: this for loop has no effect
-			while (actualRandomSet.size() < 3)
+			// fill the next batch of models with 3 different random points each
+			batch.resize(std::min(batchSize, numberIterations - first));
+			for (unsigned int h = 0; h < batch.size(); h++)
 			{
-				int nn = (int) ((std::rand() / (float) RAND_MAX) * dataset.size());
-				if (std::find(actualRandomSet.begin(), actualRandomSet.end(), nn) == actualRandomSet.end())
+				int actualRandomSet[3]; // which 3 points are chosen (index)
+				batch[h].points.clear();
+				while (batch[h].points.size() < 3)
 				{
-					actualRandomSet.push_back(nn);
-					actualRandomPointSet.push_back(dataset[nn].middlePoint);
+					int nn = rng.uniform(0, (int)dataset.size());
+					if (std::find(actualRandomSet, actualRandomSet + batch[h].points.size(), nn) == actualRandomSet + batch[h].points.size())
+					{
+						actualRandomSet[batch[h].points.size()] = nn;
+						batch[h].points.push_back(dataset[nn].middlePoint);
+					}
 				}
 			}
 
-			// calculate maxDistance for every pointset anew, maxDistance = max. distance between point and curve so that point still supports model
-			for (unsigned int distanceParameterIndex = 0; distanceParameterIndex < actualRandomSet.size(); distanceParameterIndex++)
-				rectsArea.push_back(std::sqrt(dataset[distanceParameterIndex].r.area()));
-
-			float maxDistance = 0;
-			for (unsigned int k = 0; k < rectsArea.size(); k++)
-				maxDistance += rectsArea[k];
-			maxDistance = distanceParameter * (maxDistance / actualRandomSet.size());
-
-			// Reject Criterion #1: Reject model if letter sizes are too different
-			if (std::max(rectsArea[0], rectsArea[1]) / (std::min(rectsArea[0], rectsArea[1])) > 3) // todo: (i) make this a parameter, (ii) avoid division
-				continue;
-			if (std::max(rectsArea[0], rectsArea[2]) / (std::min(rectsArea[0], rectsArea[2])) > 3)
-				continue;
-			if (std::max(rectsArea[1], rectsArea[2]) / (std::min(rectsArea[1], rectsArea[2])) > 3)
-				continue;
-
-			// calculate bezier curve
-			cv::Mat curve = createBezierCurve(actualRandomPointSet, debug["showBezier"]);
-			if (curve.rows < 1)
-			{
-				std::cout << "bezier curve wasn't drawn correctly." << std::endl;
-				return ransacSubset;
-			}
-
-			// Bending of curve -> angle difference
-			//      float angleA = std::atan2(actualRandomPointSet[1].y - actualRandomPointSet[0].y, actualRandomPointSet[1].x
-			//          - actualRandomPointSet[0].x) * (180.0 / 3.14159265);
-			//
-			//      float angleB = std::atan2(actualRandomPointSet[2].y - actualRandomPointSet[1].y, actualRandomPointSet[2].x
-			//          - actualRandomPointSet[1].x) * (180.0 / 3.14159265);
-			//
-			//      float angleDifference = std::abs(angleA - angleB);
-			//      if (angleDifference > 180)
-			//        angleDifference = 360 - angleDifference;
-			double dx1 = actualRandomPointSet[1].x - actualRandomPointSet[0].x;
-			double dy1 = actualRandomPointSet[1].y - actualRandomPointSet[0].y;
-			double dx2 = actualRandomPointSet[2].x - actualRandomPointSet[1].x;
-			double dy2 = actualRandomPointSet[2].y - actualRandomPointSet[1].y;
-			float angleDifference = (180.0 / 3.14159265) * std::abs(acos((dx1 * dx2 + dy1 * dy2) / (sqrt((dx1 * dx1 + dy1 * dy1) * (dx2 * dx2 + dy2 * dy2)))));
-
-			// draw chosen points
-			if (debug["showBezier"])
-			{
-				output2 = output.clone();
-				std::cout << std::endl << "Model #" << i << std::endl;
-				std::cout << "Curve: " << std::endl;
-				std::cout << "[ " << curve.at<float> (0, 0) << " " << curve.at<float> (0, 1) << " " << curve.at<float> (0, 2) << " ]" << std::endl;
-				std::cout << "[ " << curve.at<float> (1, 0) << " " << curve.at<float> (1, 1) << " " << curve.at<float> (1, 2) << " ]" << std::endl;
-				std::cout << "Points: " << std::endl;
-				std::cout << actualRandomPointSet[0].x << "|" << actualRandomPointSet[0].y << ", " << actualRandomPointSet[1].x << "|"
-						<< actualRandomPointSet[1].y << ", " << actualRandomPointSet[2].x << "|" << actualRandomPointSet[2].y << std::endl;
-				//        std::cout << "angleA: " << angleA << ", angleB: " << angleB << std::endl;
-				std::cout << "|angleA-angleB| = " << angleDifference << std::endl;
-				for (unsigned int j = 0; j < actualRandomSet.size(); j++)
-					cv::rectangle(output2, cv::Rect(dataset[actualRandomSet[j]].middlePoint.x, dataset[actualRandomSet[j]].middlePoint.y, 1, 1),
-							cv::Scalar(255, 0, 0), 2, 1, 0);
-				cv::imshow("ransac", output2);
-				std::cout << "------------" << std::endl;
-			}
-
-			// Reject Criterion #2: Reject model if (rotated) heights are too different
-			std::vector<unsigned int> heights;
-			for (unsigned int actualSetIndex = 0; actualSetIndex < actualRandomSet.size(); actualSetIndex++)
-			{
-				std::pair<float, float> distanceTs = getBezierDistance(curve, dataset[actualSetIndex].middlePoint);
-				// C'(t) = 2At+B
-				int t = distanceTs.second;
-				cv::Point2f normal(
-						2 * cv::Point(curve.at<float> (0, 0), curve.at<float> (1, 0)).y * t + cv::Point(curve.at<float> (0, 1), curve.at<float> (1, 1)).y,
-						-1
-								* (2 * cv::Point(curve.at<float> (0, 0), curve.at<float> (1, 0)).x * t + cv::Point(curve.at<float> (0, 1),
-										curve.at<float> (1, 1)).x));
-
-				normal = normal * (float) (1 / (std::sqrt(normal.x * normal.x + normal.y * normal.y)));
-				heights.push_back(calculateRealLetterHeight(dataset[actualSetIndex].middlePoint, dataset[actualSetIndex].r, normal));
-			}
-			float meanHeight = 0;
-			float heightVariance = 0;
-
-			for (unsigned int h = 0; h < 3; h++)
-				meanHeight += heights[h];
-			meanHeight /= 3;
+			unsigned int numberTasks = (batch.size() * dataset.size() >= minParallelDistances) ? std::min((unsigned int)numberThreads, (unsigned int)batch.size()) : 1;
+			parallelTasks(numberTasks, boost::bind(&DetectText::evaluateBezierHypotheses, this, boost::cref(dataset), maxDistance, boost::ref(batch), numberTasks, _1));
 
-			for (unsigned int h = 0; h < 3; h++)
-				heightVariance += (meanHeight - heights[h]) * (meanHeight - heights[h]);
-			heightVariance /= 3;
+			// remember model if its the best so far, the models are compared in the order they were sampled
+			for (unsigned int h = 0; h < batch.size(); h++)
+			{
+				const BezierHypothesis& hypothesis = batch[h];
+				const float (&curve)[2][3] = hypothesis.curve.coefficients;
 
-			if (heightVariance > 50)
-				continue;
+				// draw chosen points
+				cv::Mat output2;
+				if (showBezier)
+				{
+					output2 = output.clone();
+					std::cout << std::endl << "Model #" << first + h << std::endl;
+					std::cout << "Curve: " << std::endl;
+					std::cout << "[ " << curve[0][0] << " " << curve[0][1] << " " << curve[0][2] << " ]" << std::endl;
+					std::cout << "[ " << curve[1][0] << " " << curve[1][1] << " " << curve[1][2] << " ]" << std::endl;
+					std::cout << "Points: " << std::endl;
+					std::cout << hypothesis.points[0].x << "|" << hypothesis.points[0].y << ", " << hypothesis.points[1].x << "|" << hypothesis.points[1].y
+							<< ", " << hypothesis.points[2].x << "|" << hypothesis.points[2].y << std::endl;
+					std::cout << "|angleA-angleB| = " << hypothesis.angleDifference << std::endl;
+					for (unsigned int j = 0; j < hypothesis.points.size(); j++)
+						cv::rectangle(output2, cv::Rect(hypothesis.points[j].x, hypothesis.points[j].y, 1, 1), cv::Scalar(255, 0, 0), 2, 1, 0);
+					cv::imshow("ransac", output2);
+					std::cout << "------------" << std::endl;
+				}
 
-			// calculate distance between curve and each data point
-			double distance = 0;
+				if (hypothesis.rejected)
+					continue;
 
-			for (unsigned int datasetIndex = 0; datasetIndex < dataset.size(); datasetIndex++)
-			{
-				std::pair<float, float> distanceTs = getBezierDistance(curve, dataset[datasetIndex].middlePoint);
-				// todo: why count distance of all points, not just inliers?
-				//        distance += distanceTs.first; // count the distance of every point to evaluate model based on summed distances
-				if (distanceTs.first < maxDistance) // is the point near enough?
+				if (showBezier)
 				{
-					distance += distanceTs.first; // count the distance of every point to evaluate model based on summed distances
-					goodPoints.push_back(dataset[datasetIndex].middlePoint);
-					ts.push_back(distanceTs.second);
-					if (debug["showBezier"])
+					for (unsigned int datasetIndex = 0; datasetIndex < dataset.size() && showBezier; datasetIndex++)
 					{
-						cv::rectangle(output2, cv::Rect(dataset[datasetIndex].middlePoint.x, dataset[datasetIndex].middlePoint.y, 1, 1), cv::Scalar(0, 255, 0),
-								2, 1, 0);
-						if (distanceTs.first < 1e-4)
-							std::cout << "distance: " << 0 << " [x]" << std::endl;
+						if (hypothesis.distances[datasetIndex] < maxDistance) // is the point near enough?
+						{
+							cv::rectangle(output2, cv::Rect(dataset[datasetIndex].middlePoint.x, dataset[datasetIndex].middlePoint.y, 1, 1), cv::Scalar(0, 255, 0),
+									2, 1, 0);
+							if (hypothesis.distances[datasetIndex] < 1e-4)
+								std::cout << "distance: " << 0 << " [x]" << std::endl;
+							else
+								std::cout << "distance: " << hypothesis.distances[datasetIndex] << " [x]" << std::endl;
+							cv::imshow("ransac", output2);
+							if (cv::waitKey(0) == 27) // ESC pressed
+							{
+								debug["showBezier"] = false;
+								showBezier = false;
+							}
+						}
 						else
-							std::cout << "distance: " << distanceTs.first << " [x]" << std::endl;
-						cv::imshow("ransac", output2);
-						if (cv::waitKey(0) == 27) // ESC pressed
-							debug["showBezier"] = false;
+						{
+							cv::rectangle(output2, cv::Rect(dataset[datasetIndex].middlePoint.x, dataset[datasetIndex].middlePoint.y, 1, 1), cv::Scalar(0, 0, 255),
+									2, 1, 0);
+							std::cout << "distance: " << hypothesis.distances[datasetIndex] << " [ ]" << std::endl;
+							cv::imshow("ransac", output2);
+						}
 					}
 				}
-				else
+
+				if (hypothesis.score > highestScore && hypothesis.angleDifference < bendParameter && hypothesis.numberInliers >= 3)
 				{
-					if (debug["showBezier"])
+					finalGoodPoints.clear();
+					finalTs.clear();
+					for (unsigned int datasetIndex = 0; datasetIndex < dataset.size(); datasetIndex++)
 					{
-						cv::rectangle(output2, cv::Rect(dataset[datasetIndex].middlePoint.x, dataset[datasetIndex].middlePoint.y, 1, 1), cv::Scalar(0, 0, 255),
-								2, 1, 0);
-						std::cout << "distance: " << distanceTs.first << " [ ]" << std::endl;
-						cv::imshow("ransac", output2);
-						//cv::waitKey(0);
+						if (hypothesis.distances[datasetIndex] < maxDistance)
+						{
+							finalGoodPoints.push_back(dataset[datasetIndex].middlePoint);
+							finalTs.push_back(hypothesis.ts[datasetIndex]);
+						}
 					}
+					finalModel = hypothesis.points;
+					highestScore = hypothesis.score;
+					modelNr = first + h;
+					bestInlierRatio = hypothesis.numberInliers / (float) dataset.size();
+				}
+				if (showBezier)
+				{
+					std::cout << "Σdistance: " << hypothesis.inlierDistance << std::endl;
+					std::cout << hypothesis.numberInliers << "/" << dataset.size() << " points support model" << std::endl;
 				}
 			}
 
-			// remember model if its the best so far
-			float score = 0;
-
-			// 1) How many points support the model
-			score += 100.f * (goodPoints.size() / dataset.size());
-
-			// 2) How far is the distance of all these points to the model curve
-			// 2) How far is the mean distance of all good points to the model curve
-			score += 100.f / (distance / (double) goodPoints.size() + 1);
-
-			// 3) How strong is the bending of the curve
-			//      score += 300 / (angleDifference + 1);		// todo: avoid division
-			score += 100.f * ((180.f - angleDifference) / 180.f);
-
-			if (score > highestScore && angleDifference < bendParameter && goodPoints.size() >= 3)
-			{
-				finalGoodPoints = goodPoints;
-				finalModel = actualRandomPointSet;
-				finalTs = ts;
-				highestScore = score;
-				modelNr = i;
-			}
-			if (debug["showBezier"])
+			// Adaptive termination: n is based on the outlier ratio e guessed from the pca. As soon as the best model is supported
+			// by more points than that guess, the number of iterations that draw at least one sample without outliers with
+			// probability p is computed from the actual share of supporting points, which is much lower.
+			if (bestInlierRatio >= 1)
+				break;
+			if (bestInlierRatio > 1 - e)
 			{
-				std::cout << "Σdistance: " << distance << std::endl;
-				std::cout << goodPoints.size() << "/" << dataset.size() << " points support model" << std::endl;
+				float requiredIterations = std::ceil(std::log10(1 - p) / (float) (std::log10(1 - (std::pow(bestInlierRatio, bezierDegree)))));
+				if (first + batch.size() >= requiredIterations)
+					break;
 			}
 		}
 
 		// show final chosen model
-		if (debug["showBezier"])
+		if (showBezier)
 		{
 			for (unsigned int i = 0; i < finalGoodPoints.size(); i++)
 				cv::rectangle(output, cv::Rect(finalGoodPoints[i].x, finalGoodPoints[i].y, 1, 1), cv::Scalar(0, 0, 0), 2, 1, 0);
@@ -4641,101 +4691,114 @@ std::vector<std::pair<std::vector<cv::Point>, std::vector<cv::Point> > > DetectT
 	return ransacSubset;
 }
 
-cv::Mat DetectText::createBezierCurve(std::vector<cv::Point> & points, bool showBezier)
+void DetectText::evaluateBezierHypotheses(const std::vector<connectedComponent>& dataset, float maxDistance, std::vector<BezierHypothesis>& hypotheses,
+		unsigned int numberTasks, unsigned int task)
 {
-	if (points.size() != 3)
+	for (unsigned int h = task; h < hypotheses.size(); h += numberTasks)
 	{
-		std::cout << "3 Points required for quadratic curve." << std::endl;
-		return cv::Mat();
-	}
+		BezierHypothesis& hypothesis = hypotheses[h];
+		const std::vector<cv::Point>& points = hypothesis.points;
+
+		// calculate bezier curve
+		hypothesis.curve.fit(hypothesis.points);
+		const float (&curve)[2][3] = hypothesis.curve.coefficients;
+
+		// Bending of curve -> angle difference
+		double dx1 = points[1].x - points[0].x;
+		double dy1 = points[1].y - points[0].y;
+		double dx2 = points[2].x - points[1].x;
+		double dy2 = points[2].y - points[1].y;
+		hypothesis.angleDifference = (180.0 / 3.14159265) * std::abs(acos((dx1 * dx2 + dy1 * dy2) / (sqrt((dx1 * dx1 + dy1 * dy1) * (dx2 * dx2 + dy2 * dy2)))));
+
+		// Reject Criterion #2: Reject model if (rotated) heights are too different
+		// todo: uses the first 3 components of the dataset, not the sampled ones
+		unsigned int heights[3];
+		for (unsigned int actualSetIndex = 0; actualSetIndex < 3; actualSetIndex++)
+		{
+			std::pair<float, float> distanceTs = hypothesis.curve.distance(dataset[actualSetIndex].middlePoint);
+			// C'(t) = 2At+B
+			int t = distanceTs.second;
+			cv::Point2f normal(2 * cv::Point(curve[0][0], curve[1][0]).y * t + cv::Point(curve[0][1], curve[1][1]).y,
+					-1 * (2 * cv::Point(curve[0][0], curve[1][0]).x * t + cv::Point(curve[0][1], curve[1][1]).x));
+
+			normal = normal * (float) (1 / (std::sqrt(normal.x * normal.x + normal.y * normal.y)));
+			heights[actualSetIndex] = calculateRealLetterHeight(dataset[actualSetIndex].middlePoint, dataset[actualSetIndex].r, normal);
+		}
+		float meanHeight = 0;
+		float heightVariance = 0;
+
+		for (unsigned int h = 0; h < 3; h++)
+			meanHeight += heights[h];
+		meanHeight /= 3;
+
+		for (unsigned int h = 0; h < 3; h++)
+			heightVariance += (meanHeight - heights[h]) * (meanHeight - heights[h]);
+		heightVariance /= 3;
+
+		hypothesis.rejected = (heightVariance > 50);
+		if (hypothesis.rejected)
+			continue;
 
-	cv::Mat output = originalImage_.clone();
+		// calculate distance between curve and each data point
+		hypothesis.distances.resize(dataset.size());
+		hypothesis.ts.resize(dataset.size());
+		hypothesis.numberInliers = 0;
+		double distance = 0;
 
-	cv::Mat R = (cv::Mat_<float>(2, 3) << points[0].x, points[1].x, points[2].x, points[0].y, points[1].y, points[2].y); // todo: create R not before correct order is known
+		for (unsigned int datasetIndex = 0; datasetIndex < dataset.size(); datasetIndex++)
+		{
+			std::pair<float, float> distanceTs = hypothesis.curve.distance(dataset[datasetIndex].middlePoint);
+			hypothesis.distances[datasetIndex] = distanceTs.first;
+			hypothesis.ts[datasetIndex] = distanceTs.second;
+			// todo: why count distance of all points, not just inliers?
+			if (distanceTs.first < maxDistance) // is the point near enough?
+			{
+				distance += distanceTs.first; // count the distance of every point to evaluate model based on summed distances
+				hypothesis.numberInliers++;
+			}
+		}
+		hypothesis.inlierDistance = distance;
 
-	// 1.) compute distances of all 3 points and position them into right order,
-	// i.e. the points with largest distance go to position 1 and 3
-	float distance12 = std::sqrt((points[0].y - points[1].y) * (points[0].y - points[1].y) + (points[0].x - points[1].x) * (points[0].x - points[1].x));
-	float distance13 = std::sqrt((points[0].y - points[2].y) * (points[0].y - points[2].y) + (points[0].x - points[2].x) * (points[0].x - points[2].x));
-	float distance23 = std::sqrt((points[1].y - points[2].y) * (points[1].y - points[2].y) + (points[1].x - points[2].x) * (points[1].x - points[2].x));
+		// remember model if its the best so far
+		float score = 0;
 
-	float t0 = distance12 / (float) (distance12 + distance23); // relation of distances, i.e. percentage of t at the point in the middle
+		// 1) How many points support the model
+		score += 100.f * (hypothesis.numberInliers / dataset.size());
 
-	if (distance12 > distance13 && distance12 > distance23)
-	{
-		float tempX, tempY;
-		tempX = R.at<float> (0, 1);
-		tempY = R.at<float> (1, 1);
-		R.at<float> (0, 1) = R.at<float> (0, 2);
-		R.at<float> (1, 1) = R.at<float> (1, 2);
-		R.at<float> (0, 2) = tempX;
-		R.at<float> (1, 2) = tempY;
-		t0 = distance13 / (float) (distance13 + distance23);
-		cv::Point temp = points[1];
-		points[1] = points[2];
-		points[2] = temp;
-	}
-	else if (distance23 > distance12 && distance23 > distance13)
-	{
-		float tempX, tempY;
-		tempX = R.at<float> (0, 1);
-		tempY = R.at<float> (1, 1);
-		R.at<float> (0, 1) = R.at<float> (0, 0);
-		R.at<float> (1, 1) = R.at<float> (1, 0);
-		R.at<float> (0, 0) = tempX;
-		R.at<float> (1, 0) = tempY;
-		t0 = distance12 / (float) (distance13 + distance12);
-		cv::Point temp = points[1];
-		points[1] = points[0];
-		points[0] = temp;
+		// 2) How far is the mean distance of all good points to the model curve
+		score += 100.f / (distance / (double) hypothesis.numberInliers + 1);
+
+		// 3) How strong is the bending of the curve
+		score += 100.f * ((180.f - hypothesis.angleDifference) / 180.f);
+
+		hypothesis.score = score;
 	}
+}
 
-	// why? to avoid head-over as first guess!
-	if (points[0].x > points[2].x)
+cv::Mat DetectText::createBezierCurve(std::vector<cv::Point> & points, bool showBezier)
+{
+	BezierCurve curve;
+	if (!curve.fit(points))
 	{
-		float tempX, tempY;
-		tempX = R.at<float> (0, 0);
-		tempY = R.at<float> (1, 0);
-		R.at<float> (0, 0) = R.at<float> (0, 2);
-		R.at<float> (1, 0) = R.at<float> (1, 2);
-		R.at<float> (0, 2) = tempX;
-		R.at<float> (1, 2) = tempY;
-		cv::Point temp = points[0];
-		points[0] = points[2];
-		points[2] = temp;
-		t0 = 1 - t0;
+		std::cout << "3 Points required for quadratic curve." << std::endl;
+		return cv::Mat();
 	}
 
-	// 2.) compute the Bezier point
-	R.at<float> (0, 1) = (R.at<float> (0, 1) + R.at<float> (0, 0) * (-1 + 2 * t0 - t0 * t0) - R.at<float> (0, 2) * t0 * t0) / (2 * t0 - 2 * t0 * t0);
-	R.at<float> (1, 1) = (R.at<float> (1, 1) + R.at<float> (1, 0) * (-1 + 2 * t0 - t0 * t0) - R.at<float> (1, 2) * t0 * t0) / (2 * t0 - 2 * t0 * t0);
-
-	// 3.) draw bezier curve
-
-	//  cv::Mat C = (cv::Mat_<float>(2, 3) << (R.at<float> (0, 0) - 2 * R.at<float> (0, 1) + R.at<float> (0, 2)), (-2 * R.at<
-	//      float> (0, 0) + 2 * R.at<float> (0, 1)), R.at<float> (0, 0), (R.at<float> (1, 0) - 2 * R.at<float> (1, 1) + R.at<
-	//      float> (1, 2)), (-2 * R.at<float> (1, 0) + 2 * R.at<float> (1, 1)), R.at<float> (1, 0));
-	cv::Mat C(2, 3, CV_32FC1);
-	C.at<float> (0, 0) = R.at<float> (0, 0) - 2 * R.at<float> (0, 1) + R.at<float> (0, 2);
-	C.at<float> (0, 1) = -2 * R.at<float> (0, 0) + 2 * R.at<float> (0, 1);
-	C.at<float> (0, 2) = R.at<float> (0, 0);
-	C.at<float> (1, 0) = R.at<float> (1, 0) - 2 * R.at<float> (1, 1) + R.at<float> (1, 2);
-	C.at<float> (1, 1) = -2 * R.at<float> (1, 0) + 2 * R.at<float> (1, 1);
-	C.at<float> (1, 2) = R.at<float> (1, 0);
-
 	if (showBezier)
 	{
+		cv::Mat output = originalImage_.clone();
+		const float (&C)[2][3] = curve.coefficients;
+
 		// draw bezier point (lies not on curve)
-		cv::rectangle(output, cv::Point((int) std::floor(R.at<float> (0, 1) + 0.5), (int) std::floor(R.at<float> (1, 1) + 0.5)),
-				cv::Point((int) std::floor(R.at<float> (0, 1) + 0.5), (int) std::floor(R.at<float> (1, 1) + 0.5)), cv::Scalar(0, 255, 0), 1, 1, 0);
+		cv::Point2f bezierPoint(C[0][2] + 0.5f * C[0][1], C[1][2] + 0.5f * C[1][1]);
+		cv::rectangle(output, cv::Point((int) std::floor(bezierPoint.x + 0.5), (int) std::floor(bezierPoint.y + 0.5)),
+				cv::Point((int) std::floor(bezierPoint.x + 0.5), (int) std::floor(bezierPoint.y + 0.5)), cv::Scalar(0, 255, 0), 1, 1, 0);
 
 		// draw line as connected points
 		for (float t = 0; t < 1; t += 0.01)
 		{
-			float Cx = (R.at<float> (0, 0) - 2 * R.at<float> (0, 1) + R.at<float> (0, 2)) * t * t + (-2 * R.at<float> (0, 0) + 2 * R.at<float> (0, 1)) * t
-					+ R.at<float> (0, 0);
-			float Cy = (R.at<float> (1, 0) - 2 * R.at<float> (1, 1) + R.at<float> (1, 2)) * t * t + (-2 * R.at<float> (1, 0) + 2 * R.at<float> (1, 1)) * t
-					+ R.at<float> (1, 0);
+			float Cx = C[0][0] * t * t + C[0][1] * t + C[0][2];
+			float Cy = C[1][0] * t * t + C[1][1] * t + C[1][2];
 			cv::rectangle(output, cv::Point((int) std::floor(Cx + 0.5), (int) std::floor(Cy + 0.5)),
 					cv::Point((int) std::floor(Cx + 0.5), (int) std::floor(Cy + 0.5)), cv::Scalar(150, 200, 50), 1, 1, 0);
 		}
@@ -4748,7 +4811,7 @@ cv::Mat DetectText::createBezierCurve(std::vector<cv::Point> & points, bool show
 		cv::imshow("bezier", output);
 		cv::waitKey(0);
 	}
-	return C;
+	return curve.toMat();
 }
 
 void postRansacCriterions()
@@ -4854,428 +4917,26 @@ void DetectText::Cramer()
 std::pair<float, float> DetectText::getBezierDistance(cv::Mat curve, cv::Point Q)
 {
 	// compute distance from Q to curve and t when C(t) is nearest Point to Q on curve
-	float a = 2 * (curve.at<float> (0, 0) * curve.at<float> (0, 0) + curve.at<float> (1, 0) * curve.at<float> (1, 0)); //coefficients
-	float b = 3 * (curve.at<float> (0, 0) * curve.at<float> (0, 1) + curve.at<float> (1, 0) * curve.at<float> (1, 1));
-	float c = 2 * (curve.at<float> (0, 0) * (curve.at<float> (0, 2) - Q.x) + curve.at<float> (1, 0) * (curve.at<float> (1, 2) - Q.y)) + curve.at<float> (0, 1)
-			* curve.at<float> (0, 1) + curve.at<float> (1, 1) * curve.at<float> (1, 1);
-	float d = curve.at<float> (0, 1) * (curve.at<float> (0, 2) - Q.x) + curve.at<float> (1, 1) * (curve.at<float> (1, 2) - Q.y);
-
-	// distinguish between several cases
-	float ts = 0;
-
-	if (std::abs(a) == 0)
-	{
-		if (std::abs(b) == 0)
-			if (c == 0)
-			{
-				std::cout << "Error: a=0, b=0, c=0" << std::endl;
-				//return -1;
-			}
-			else
-			// c*ts+d = 0
-			{
-				ts = -d / c;
-			}
-		else
-		{
-			float p2 = c / (2 * b);
-			float q = d / b;
-			if (p2 * p2 - q < 0)
-			{
-				std::cout << "Error: a=0, b~=0, p2^2-q < 0" << std::endl;
-				// return -1;
-			}
-			float t1 = -p2 - std::sqrt(p2 * p2 - q);
-			float t2 = -p2 + std::sqrt(p2 * p2 - q);
-
-			float dist1 = ((curve.at<float> (0, 0) * t1 * t1 + curve.at<float> (0, 1) * t1 + curve.at<float> (0, 2) - Q.x) * (curve.at<float> (0, 0) * t1 * t1
-					+ curve.at<float> (0, 1) * t1 + curve.at<float> (0, 2) - Q.x) + (curve.at<float> (1, 0) * t1 * t1 + curve.at<float> (1, 1) * t1 + curve.at<
-					float> (1, 2) - Q.y) * (curve.at<float> (1, 0) * t1 * t1 + curve.at<float> (1, 1) * t1 + curve.at<float> (1, 2) - Q.y));
-			float dist2 = ((curve.at<float> (0, 0) * t2 * t2 + curve.at<float> (0, 1) * t2 + curve.at<float> (0, 2) - Q.x) * (curve.at<float> (0, 0) * t2 * t2
-					+ curve.at<float> (0, 1) * t2 + curve.at<float> (0, 2) - Q.x) + (curve.at<float> (1, 0) * t2 * t2 + curve.at<float> (1, 1) * t2 + curve.at<
-					float> (1, 2) - Q.y) * (curve.at<float> (1, 0) * t2 * t2 + curve.at<float> (1, 1) * t2 + curve.at<float> (1, 2) - Q.y));
-			if (dist1 < dist2)
-				ts = t1;
-			else
-				ts = t2;
-		}
-	}
-	else // a*ts³+b*ts²+c*ts+d=0
-	{
-		//  If discrimant > 0, then the equation has three distinct real roots.
-		//  If discrimant = 0, then the equation has a multiple root and all its roots are real.
-		//  If discrimant < 0, then the equation has one real root and two nonreal complex conjugate roots.
-
-		float discriminant = 18 * a * b * c * d - 4 * b * b * b * d + b * b * c * c - 4 * a * c * c * c - 27 * a * a * d * d;
-		if (discriminant < 0)
-		{
-			// analytic real root of cubic function
-			float ts_p1, ts_p2;
-			if (2 * b * b * b - 9 * a * b * c + 27 * a * a * d + a * sqrt(-27 * discriminant) < 0)
-			{
-				ts_p1 = std::pow(-0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d + a * sqrt(-27 * discriminant)), (1.0 / 3.0));
-				ts_p1 *= -1;
-			}
-			else
-			{
-				ts_p1 = std::pow(0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d + a * sqrt(-27 * discriminant)), (1.0 / 3.0));
-			}
-			if (2 * b * b * b - 9 * a * b * c + 27 * a * a * d - a * sqrt(-27 * discriminant) < 0)
-			{
-				ts_p2 = std::pow(-0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d - a * sqrt(-27 * discriminant)), (1.0 / 3.0));
-				ts_p2 *= -1;
-			}
-			else
-			{
-				ts_p2 = std::pow(0.5 * (2 * b * b * b - 9 * a * b * c + 27 * a * a * d - a * sqrt(-27 * discriminant)), (1.0 / 3.0));
-			}
-			ts = (-b / (3 * a)) - (1 / (3 * a)) * ts_p1 - (1 / (3 * a)) * ts_p2;
-		}
-		else
-		{
-			// 2 or 3 solutions, use Newton root approximation and choose the closest point on C(t)
-			// a) roots of 1st derivative of cubic function -> get estimates for initial values for Newton method
-			float p2 = b / (3 * a);
-			float q = c / (3 * a);
-			std::vector<float> tis; // initial values for Newton method
-
-			if (p2 * p2 - q < 0) // no real roots in derivative? -> one real root for cubic function
-			{
-				tis.push_back(0.5); // should probably never happen because discriminant would be < 0
-			}
-			else if (p2 * p2 - q == 0) // one double real root in derivative -> one real root for cubic function
-			{
-				tis.push_back(-p2 - 0.25);
-				tis.push_back(-p2 + 0.25);
-			}
-			else
-			{
-				// two distinct real roots in derivative -> three distinct real roots for cubic function
-				float t1 = -p2 - std::sqrt(p2 * p2 - q);
-				float t2 = -p2 + std::sqrt(p2 * p2 - q); // t1 < t2
-				tis.push_back(t1 - 0.25);
-				tis.push_back((t1 + t2) / 2);
-				tis.push_back(t2 + 0.25);
-			}
-
-			// b) Newton method for each initial value and comparison for
-			float tss = 0;
-			long mindist = 1e10;
-			for (unsigned int ii = 0; ii < tis.size(); ii++)
-			{
-				tss = tis[ii];
-				float i = 0;
-				float f = a * tss * tss * tss + b * tss * tss + c * tss + d;
-				while (i < 100 && std::abs(f) > 1e-5)
-				{
-					tss = tss - f / (3 * a * tss * tss + 2 * b * tss + c);
-					f = a * tss * tss * tss + b * tss * tss + c * tss + d;
-					i = i + 1;
-				}
-
-				// get closest distance if multiple real roots present
-				float dist_tss = ((curve.at<float> (0, 0) * tss * tss + curve.at<float> (0, 1) * tss + curve.at<float> (0, 2) - Q.x) * (curve.at<float> (0, 0)
-						* tss * tss + curve.at<float> (0, 1) * tss + curve.at<float> (0, 2) - Q.x) + (curve.at<float> (1, 0) * tss * tss + curve.at<float> (1,
-						1) * tss + curve.at<float> (1, 2) - Q.y) * (curve.at<float> (1, 0) * tss * tss + curve.at<float> (1, 1) * tss + curve.at<float> (1, 2)
-						- Q.y)); // length of line between C(tss) and Q
-
-				if (mindist > dist_tss && std::abs(tss) < 10)
-				{
-					ts = tss;
-					mindist = dist_tss;
-				}
-			}
-		}
-	}
-
-	// closest point to Q on C(t)
-	float Csx = curve.at<float> (0, 0) * ts * ts + curve.at<float> (0, 1) * ts + curve.at<float> (0, 2);
-	float Csy = curve.at<float> (1, 0) * ts * ts + curve.at<float> (1, 1) * ts + curve.at<float> (1, 2);
-
-	float shortestDistance = std::sqrt((Csx - Q.x) * (Csx - Q.x) + (Csy - Q.y) * (Csy - Q.y));
-
-	return std::pair<float, float>(shortestDistance, ts);
+	return BezierCurve(curve).distance(Q);
 }
 
 float DetectText::getBezierLength(cv::Mat curve, float mint, float maxt)
 {
-	// compute length of model curve
-	float length = 1; // starts at 1 'cause in for-loop below the distance when C changes is counted -> C(mint) is missed
-
-	// C(t) = At²+Bt+D
-	cv::Point previousC((int) std::floor(curve.at<float> (0, 2) + 0.5), (int) std::floor(curve.at<float> (1, 2) + 0.5));
-
-	for (double t = mint; t < maxt; t += 0.0001)
-	{
-		cv::Point C((int) std::floor((curve.at<float> (0, 0) * t * t + curve.at<float> (0, 1) * t + curve.at<float> (0, 2)) + 0.5),
-				(int) std::floor((curve.at<float> (1, 0) * t * t + curve.at<float> (1, 1) * t + curve.at<float> (1, 2)) + 0.5));
-		if (previousC.x != C.x && previousC.y != C.y)
-			length += 1.41421356;
-		else if (previousC.x != C.x)
-			length++;
-		else if (previousC.y != C.y)
-			length++;
-		previousC = C;
-	}
-	return length;
+	// compute length of model curve, starts at 1 'cause the arc length misses the pixel of C(mint)
+	return 1 + BezierCurve(curve).length(mint, maxt);
 }
 
-void DetectText::transformBezier(cv::Rect newR, cv::Mat curve, cv::Mat & transformedImage, float mint, float maxt)
+void DetectText::transformBezier(cv::Rect newR, cv::Mat curve, cv::Mat & transformedImage, float mint, float maxt, FontColor fontColor)
 {
-	int method = 1;
-
-	cv::Mat output = transformedImage.clone();
-
 	// get background color of input image
-	bgr bg_clr = firstPass_ ? findBorderColor(newR, BRIGHT) : findBorderColor(newR, DARK);
-
-	// Nearest neighbor
-	if (method == 1)
-	{
-		// Point on curve at last iteration
-		cv::Point previousC(-1, -1);
-
-		// x on output image
-		float x = 0;
-		int previousX = -1;
-
-		std::vector<int> skippedCols; // because length > Σ points of bézierline, there are columns without a corresponding bézier point, these entire columns are interpolated in the end
-
-		// t along the bézier curve
-		for (float t = mint; t <= maxt; t += 0.0001)
-		{
-			cv::Point C((int) std::floor((curve.at<float> (0, 0) * t * t + curve.at<float> (0, 1) * t + curve.at<float> (0, 2)) + 0.5),
-					(int) std::floor((curve.at<float> (1, 0) * t * t + curve.at<float> (1, 1) * t + curve.at<float> (1, 2)) + 0.5));
-
-			// if C(t) is a new point on the curve
-			if (C.x != previousC.x || C.y != previousC.y)
-			{
-				// Unit vector
-				cv::Point2f Nt(2 * curve.at<float> (1, 0) * t + curve.at<float> (1, 1), (-1) * (2 * curve.at<float> (0, 0) * t + curve.at<float> (0, 1)));
-				float absNt = std::sqrt(Nt.x * Nt.x + Nt.y * Nt.y);
-				Nt = Nt * (1 / absNt);
-
-				int i = 0;
-
-				// fill upper side of transformedImage
-				for (int y = std::floor(transformedImage.rows / 2.0); y >= 0; y--)
-				{
-					// Point in direction of unit vector
-					cv::Point2f cNormal(C.x + i * Nt.x, C.y + i * Nt.y);
-					cv::Point cNormalInteger = cNormal;
-
-					// new point in normal direction found..
-					bgr clr;
-
-					// if point is not outside image
-					if (!(cNormalInteger.x < 0 || cNormalInteger.x >= originalImage_.cols || cNormalInteger.y < 0 || cNormalInteger.y >= originalImage_.rows))
-						clr = originalImage_.at<bgr> (cNormalInteger.y, cNormalInteger.x);
-					else
-						clr = bg_clr;
-
-					output.at<bgr> (y, x) = clr;
-
-					i++;
-				}
-
-				// same routine in the other direction
-				Nt = Nt * (-1);
-				i = 0;
-
-				// fill down side of transformedImage
-				for (int y = std::floor(transformedImage.rows / 2.0); y < transformedImage.rows; y++)
-				{
-					cv::Point2f cNormal(C.x + i * Nt.x, C.y + i * Nt.y);
-					cv::Point cNormalInteger = cNormal;
-
-					// new point in normal direction found
-					bgr clr;
-					if (!(cNormalInteger.x < 0 || cNormalInteger.x >= originalImage_.cols || cNormalInteger.y < 0 || cNormalInteger.y >= originalImage_.rows))
-						clr = originalImage_.at<bgr> (cNormalInteger.y, cNormalInteger.x);
-					else
-						clr = bg_clr;
-
-					output.at<bgr> (y, x) = clr;
-
-					if (std::floor(x) - std::floor(previousX) > 1)
-						skippedCols.push_back(std::floor(x - 1));
-
-					i++;
-				}
-				// next pixel of the resulting image in x-direction
-				previousX = x;
-				if (previousC.x != C.x && previousC.y != C.y)
-					x += 1.41421356;
-				else
-					x++;
-			}
-			previousC = C;
-		}
-
-		for (unsigned int x = 0; x < skippedCols.size(); x++)
-			for (int y = 0; y < output.rows; y++)
-			{
-				bgr clr(0, 0, 0);
-				clr.r = clr.r + 0.5 * output.at<bgr> (y, skippedCols[x] - 1).r + 0.5 * output.at<bgr> (y, skippedCols[x] + 1).r;
-				clr.g = clr.g + 0.5 * output.at<bgr> (y, skippedCols[x] - 1).g + 0.5 * output.at<bgr> (y, skippedCols[x] + 1).g;
-				clr.b = clr.b + 0.5 * output.at<bgr> (y, skippedCols[x] - 1).b + 0.5 * output.at<bgr> (y, skippedCols[x] + 1).b;
-				output.at<bgr> (y, skippedCols[x]) = clr;
-			}
-	}
-
-	// Bilinear filtering
-	if (method == 2)
-	{
-		cv::Point previousC(-1, -1);
-		float x = 0;
-		int previousX = -1;
-
-		std::vector<int> skippedCols; // because length > Σ points of bézierline, there are columns without a corresponding bézier point, these entire columns are interpolated in the end
-
-		for (float t = mint; t <= maxt; t += 0.0001)
-		{
-			cv::Point C((int) std::floor((curve.at<float> (0, 0) * t * t + curve.at<float> (0, 1) * t + curve.at<float> (0, 2)) + 0.5),
-					(int) std::floor((curve.at<float> (1, 0) * t * t + curve.at<float> (1, 1) * t + curve.at<float> (1, 2)) + 0.5));
-			cv::Point2f previousCNormal(C.x, C.y);
-
-			// new point on bézier curve
-			if (previousC != C)
-			{
-				cv::Point2f CNormal;
-				cv::Point2f Nt(2 * curve.at<float> (1, 0) * t + curve.at<float> (1, 1), (-1) * (2 * curve.at<float> (0, 0) * t + curve.at<float> (0, 1)));
-				float absNt = std::sqrt(Nt.x * Nt.x + Nt.y * Nt.y);
-
-				// above middle line
-				for (int y = std::floor(transformedImage.rows / 2.0); y >= 0; y--)
-				{
-					int count = std::floor(transformedImage.rows / 2) - y;
-					CNormal.x = C.x + count * (Nt.x / absNt);
-					CNormal.y = C.y + count * (Nt.y / absNt);
-
-					bgr meanClr(0, 0, 0);
-
-					// if point lies not outside of originalImage
-					if (!(CNormal.x < 0 || std::floor(CNormal.x + 0.5) >= originalImage_.cols || CNormal.y < 0 || std::floor(CNormal.y + 0.5)
-							>= originalImage_.rows))
-					{
-						cv::Point cNormal1, cNormal2, cNormal3, cNormal4;
-
-						// check if calculated point lies not directly on pixel
-						if (CNormal.x - (int) std::floor(CNormal.x + 0.5) != 0 || CNormal.y - (int) std::floor(CNormal.y + 0.5) != 0)
-						{
-							// calculate  mean color value of 4 nearest pixels, weighted with distance
-							cNormal1.x = std::floor(CNormal.x);
-							cNormal1.y = std::floor(CNormal.y);
-							cNormal2.x = std::floor(CNormal.x);
-							cNormal2.y = std::ceil(CNormal.y);
-							cNormal3.x = std::ceil(CNormal.x);
-							cNormal3.y = std::floor(CNormal.y);
-							cNormal4.x = std::ceil(CNormal.x);
-							cNormal4.y = std::ceil(CNormal.y);
-
-							CNormal.x -= std::floor(CNormal.x);
-							CNormal.y -= std::floor(CNormal.y);
-
-							meanClr.r = originalImage_.at<bgr> (cNormal1).r * (1 - CNormal.x) * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal3).r
-									* CNormal.x * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal2).r * (1 - CNormal.x) * CNormal.y
-									+ originalImage_.at<bgr> (cNormal4).r * CNormal.x * CNormal.y;
-							meanClr.g = originalImage_.at<bgr> (cNormal1).g * (1 - CNormal.x) * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal3).g
-									* CNormal.x * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal2).g * (1 - CNormal.x) * CNormal.y
-									+ originalImage_.at<bgr> (cNormal4).g * CNormal.x * CNormal.y;
-							meanClr.b = originalImage_.at<bgr> (cNormal1).b * (1 - CNormal.x) * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal3).b
-									* CNormal.x * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal2).b * (1 - CNormal.x) * CNormal.y
-									+ originalImage_.at<bgr> (cNormal4).b * CNormal.x * CNormal.y;
-						}
-						else
-							// CNormal(float point) lies directly on a pixel -> just take his color
-							meanClr = originalImage_.at<bgr> (CNormal.y, CNormal.x);
-					}
-					else
-						// if point that is going to be copied lies outside of original image
-						meanClr = bg_clr;
-
-					output.at<bgr> (y, x) = meanClr;
-					count++;
-					previousCNormal = CNormal;
-				}
-
-				// opposite direction
-				Nt *= -1;
-
-				// below middle line
-				for (int y = std::floor(transformedImage.rows / 2); y < transformedImage.rows; y++)
-				{
-					int count = y - std::floor(transformedImage.rows / 2);
-					CNormal.x = C.x + count * (Nt.x / absNt);
-					CNormal.y = C.y + count * (Nt.y / absNt);
-
-					bgr meanClr(0, 0, 0);
-
-					if (!(CNormal.x < 0 || std::floor(CNormal.x + 0.5) >= originalImage_.cols || std::floor(CNormal.y + 0.5) < 0 || std::floor(CNormal.y + 0.5)
-							>= originalImage_.rows))
-					{
-						// check if calculated point lies not directly on pixel
-
-						cv::Point cNormal1, cNormal2, cNormal3, cNormal4;
-						if (CNormal.x - (int) std::floor(CNormal.x + 0.5) != 0 || CNormal.y - (int) std::floor(CNormal.y + 0.5) != 0)
-						{
-							cNormal1.x = std::floor(CNormal.x);
-							cNormal1.y = std::floor(CNormal.y);
-							cNormal2.x = std::floor(CNormal.x);
-							cNormal2.y = std::ceil(CNormal.y);
-							cNormal3.x = std::ceil(CNormal.x);
-							cNormal3.y = std::floor(CNormal.y);
-							cNormal4.x = std::ceil(CNormal.x);
-							cNormal4.y = std::ceil(CNormal.y);
-							CNormal.x -= std::floor(CNormal.x);
-							CNormal.y -= std::floor(CNormal.y);
-
-							meanClr.r = originalImage_.at<bgr> (cNormal1).r * (1 - CNormal.x) * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal3).r
-									* CNormal.x * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal2).r * (1 - CNormal.x) * CNormal.y
-									+ originalImage_.at<bgr> (cNormal4).r * CNormal.x * CNormal.y;
-							meanClr.g = originalImage_.at<bgr> (cNormal1).g * (1 - CNormal.x) * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal3).g
-									* CNormal.x * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal2).g * (1 - CNormal.x) * CNormal.y
-									+ originalImage_.at<bgr> (cNormal4).g * CNormal.x * CNormal.y;
-							meanClr.b = originalImage_.at<bgr> (cNormal1).b * (1 - CNormal.x) * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal3).b
-									* CNormal.x * (1 - CNormal.y) + originalImage_.at<bgr> (cNormal2).b * (1 - CNormal.x) * CNormal.y
-									+ originalImage_.at<bgr> (cNormal4).b * CNormal.x * CNormal.y;
-
-						}
-						else
-							meanClr = originalImage_.at<bgr> (CNormal.y, CNormal.x);
-					}
-					else
-						meanClr = bg_clr;
-
-					output.at<bgr> (y, x) = meanClr;
-
-					if (std::floor(x) - std::floor(previousX) > 1)
-						skippedCols.push_back(std::floor(x - 1));
-
-					count++;
-				}
-				previousX = x;
-				if (previousC.x != C.x && previousC.y != C.y)
-					x += 1.41421356;
-				else
-					x++;
-			}
-			previousC = C;
-		}
-
-		for (unsigned int x = 0; x < skippedCols.size(); x++)
-		{
-			for (int y = 0; y < output.rows; y++)
-			{
-				bgr clr(0, 0, 0);
-				clr.r = clr.r + 0.5 * output.at<bgr> (y, skippedCols[x] - 1).r + 0.5 * output.at<bgr> (y, skippedCols[x] + 1).r;
-				clr.g = clr.g + 0.5 * output.at<bgr> (y, skippedCols[x] - 1).g + 0.5 * output.at<bgr> (y, skippedCols[x] + 1).g;
-				clr.b = clr.b + 0.5 * output.at<bgr> (y, skippedCols[x] - 1).b + 0.5 * output.at<bgr> (y, skippedCols[x] + 1).b;
-				output.at<bgr> (y, skippedCols[x]) = clr;
-			}
-		}
-	}
-	transformedImage = output;
+	bgr bg_clr = findBorderColor(newR, fontColor);
+
+	// Every column of transformedImage is one pixel further along the curve, every row one pixel further along the normal.
+	// The grid is computed once per curve and sampled with bilinear interpolation, points outside of the original image
+	// get the background color.
+	cv::Mat grid;
+	BezierCurve(curve).rectificationGrid(mint, maxt, transformedImage.size(), grid);
+	cv::remap(originalImage_, transformedImage, grid, cv::Mat(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(bg_clr.b, bg_clr.g, bg_clr.r));
 }
 
 unsigned int DetectText::calculateRealLetterHeight(cv::Point2f p, cv::Rect r, cv::Point2f normal)
@@ -5293,15 +4954,39 @@ unsigned int DetectText::calculateRealLetterHeight(cv::Point2f p, cv::Rect r, cv
 	return height;
 }
 
+void DetectText::divideThreads(int numberWorkers)
+{
+	int threads = std::max(1, resolveNumberThreads(0) / std::max(1, numberWorkers));
+	ocrThreads_ = std::min(resolveNumberThreads(ocrThreads_), threads);
+	tileThreads_ = std::min(resolveNumberThreads(tileThreads_), threads);
+	ransacThreads_ = std::min(resolveNumberThreads(ransacThreads_), threads);
+	if (threads == 1)
+		parallelPasses_ = false;
+}
+
 void DetectText::setParams(ros::NodeHandle & nh)
 {
 	int proc_meth = 0;
 	nh.getParam("processing_method", proc_meth);
 	this->processing_method_ = (ProcessingMethod)proc_meth;
+	nh.getParam("parallelPasses", this->parallelPasses_);
+	nh.getParam("ocrThreads", this->ocrThreads_);
+	nh.getParam("tileThreads", this->tileThreads_);
+	nh.getParam("ransacThreads", this->ransacThreads_);
+	nh.getParam("ocrCacheSize", this->ocrCacheSize_);
+	nh.getParam("ocrCacheMaxDistance", this->ocrCacheMaxDistance_);
+	// no cache in the evaluation: a cache shared by the copies of the detector would make the results depend on the order
+	// in which the workers read the images
+	if (ocrCacheSize_ > 0 && !eval_)
+		ocrCache_.reset(new OcrResultCache(ocrCacheSize_, ocrCacheMaxDistance_));
+	else
+		ocrCache_.reset();
 	nh.getParam("transformImages", this->transformImages);
 	nh.getParam("smoothImage", this->smoothImage);
+	nh.getParam("pyramidLevels", this->pyramidLevels_);
 	nh.getParam("maxStrokeWidthParameter", this->maxStrokeWidthParameter);
 	nh.getParam("useColorEdge", this->useColorEdge);
+	nh.getParam("compactMaps", this->compactMaps_);
 	nh.getParam("cannyThreshold1", this->cannyThreshold1);
 	nh.getParam("cannyThreshold2", this->cannyThreshold2);
 	nh.getParam("compareGradientParameter", this->compareGradientParameter_);
@@ -5345,9 +5030,17 @@ void DetectText::setParams(ros::NodeHandle & nh)
 	nh.getParam("showResult", this->debug["showResult"]);
 
 	std::cout << "processing_method:" << processing_method_ << std::endl;
+	std::cout << "parallelPasses:" << parallelPasses_ << std::endl;
+	std::cout << "ocrThreads:" << ocrThreads_ << std::endl;
+	std::cout << "tileThreads:" << tileThreads_ << std::endl;
+	std::cout << "ransacThreads:" << ransacThreads_ << std::endl;
+	std::cout << "ocrCacheSize:" << ocrCacheSize_ << std::endl;
+	std::cout << "ocrCacheMaxDistance:" << ocrCacheMaxDistance_ << std::endl;
 	std::cout << "smoothImage:" << smoothImage << std::endl;
+	std::cout << "pyramidLevels:" << pyramidLevels_ << std::endl;
 	std::cout << "maxStrokeWidthParameter:" << maxStrokeWidthParameter << std::endl;
 	std::cout << "useColorEdge:" << useColorEdge << std::endl;
+	std::cout << "compactMaps:" << compactMaps_ << std::endl;
 	std::cout << "cannyThreshold1:" << cannyThreshold1 << std::endl;
 	std::cout << "cannyThreshold2:" << cannyThreshold2 << std::endl;
 	std::cout << "compareGradientParameter:" << compareGradientParameter_ << std::endl;
@@ -5431,7 +5124,7 @@ void DetectText::overlapBoundingBoxes(std::vector<cv::Rect>& boundingBoxes)
 
 int DetectText::decideWhichBreaks(float negPosRatio, float max_Bin, float baselineStddev, unsigned int howManyNegative, unsigned int shift,
 		int maxPeakDistance, int secondMaxPeakDistance, int maxPeakNumbers, int secondMaxPeakNumbers, unsigned int boxWidth, unsigned int boxHeight,
-		unsigned int numberBinsNotZero, std::vector<Pair> wordBreaks, cv::Rect box, bool textIsRotated, float relativeY, bool steadyStructure, float sameArea)
+		unsigned int numberBinsNotZero, const std::vector<Pair>& wordBreaks, cv::Rect box, bool textIsRotated, float relativeY, bool steadyStructure, float sameArea)
 {
 	bool broke = true;
 	bool showCriterions = debug["showCriterions"];
@@ -5490,10 +5183,12 @@ int DetectText::decideWhichBreaks(float negPosRatio, float max_Bin, float baseli
 		int allDistances = 0;
 		for (unsigned int i = 0; i < wordBreaks.size(); i++)
 		{
-			std::cout << "wordBreaks[" << i << "]: " << wordBreaks[i].right << std::endl;
+			if (showCriterions)
+				std::cout << "wordBreaks[" << i << "]: " << wordBreaks[i].right << std::endl;
 			allDistances += wordBreaks[i].right;
 		}
-		std::cout << "box.width: " << box.width << std::endl;
+		if (showCriterions)
+			std::cout << "box.width: " << box.width << std::endl;
 		if (allDistances > 0.5*box.width)
 			return -1;
 	}
@@ -5889,7 +5584,7 @@ cv::Mat DetectText::filterPatch(const cv::Mat& patch)
 	return result;
 }
 
-void DetectText::breakLinesIntoWords(std::vector<cv::Rect>& boxes, std::vector<cv::RotatedRect>& lineEquations, std::vector<double>& qualityScore)
+void DetectText::breakLinesIntoWords(PassContext& pass, std::vector<cv::Rect>& boxes, std::vector<cv::RotatedRect>& lineEquations, std::vector<double>& qualityScore)
 {
 	// break text into separate lines without destroying letter boxes
 	cv::Mat output;
@@ -5905,36 +5600,25 @@ void DetectText::breakLinesIntoWords(std::vector<cv::Rect>& boxes, std::vector<c
 
 	std::string breakingWordsDisplayName = "breaking words";
 
-	if (firstPass_)
-	{
-		letters = brightLetters_;
+	letters = pass.letters;
+	if (pass.fontColor == BRIGHT)
 		breakingWordsDisplayName = "breaking bright words";
-	}
-//		for (unsigned int i = 0; i < brightLetters_.size(); i++)
-//			letters.push_back(brightLetters_[i]);
 	else
-	{
-		letters = darkLetters_;
 		breakingWordsDisplayName = "breaking dark words";
-	}
-//		for (unsigned int i = 0; i < darkLetters_.size(); i++)
-//			letters.push_back(darkLetters_[i]);
+
+	// letters of every box and the distances to their right neighbors for all boxes at once
+	std::vector<std::vector<int> > boxLetters;
+	std::vector<std::vector<Pair> > boxWordBreaks;
+	letterGaps(letters, boxes, boxLetters, boxWordBreaks);
 
 	//For every boundingBox:
 	for (unsigned int boxIndex = 0; boxIndex < boxes.size(); boxIndex++)
 	{
 		//which Letters belong to the current boundingBox
-		std::vector<int> innerLetters, currentLetters; // which ones of all found letters on the image belong to the current boundingBox
+		const std::vector<int>& currentLetters = boxLetters[boxIndex]; // which ones of all found letters on the image belong to the current boundingBox
 		double averageLetterSize = 0.;
-		for (unsigned int i = 0; i < letters.size(); i++)
-		{
-			if ((boxes[boxIndex] & letters[i]).area() == 1.0 * letters[i].area())
-			{
-				currentLetters.push_back(i);	// todo: exact method was not better, is it now?
-				//innerLetters.push_back(i);
-				averageLetterSize += sqrt(letters[i].width*letters[i].width + letters[i].height*letters[i].height);
-			}
-		}
+		for (unsigned int i = 0; i < currentLetters.size(); i++)
+			averageLetterSize += sqrt(letters[currentLetters[i]].width*letters[currentLetters[i]].width + letters[currentLetters[i]].height*letters[currentLetters[i]].height);
 		averageLetterSize /= (double)currentLetters.size();
 //		averageLetterSize /= (double)innerLetters.size();
 //		double inlierDistanceThreshold = averageLetterSize * (inlierDistanceThresholdFactor_+0.1);
@@ -5948,46 +5632,21 @@ void DetectText::breakLinesIntoWords(std::vector<cv::Rect>& boxes, std::vector<c
 //		}
 
 
-		// Determine distance to nearest neighbor
-		std::vector<Pair> wordBreaks;
-		int smallestDistanceEdge = 100000; //inf
-		int smallestDistanceEdgeIndex = 0;
-		for (unsigned int i = 0; i < currentLetters.size(); i++)
-		{
-			smallestDistanceEdge = 100000;
-			for (unsigned int j = 0; j < currentLetters.size(); j++)
-			{
-				float distanceEdge = 100000;
-
-				if (letters[currentLetters[j]].x > letters[currentLetters[i]].x)
-					distanceEdge = letters[currentLetters[j]].x - letters[currentLetters[i]].x - letters[currentLetters[i]].width;
-
-				if (distanceEdge < smallestDistanceEdge)
-				{
-					smallestDistanceEdge = distanceEdge;
-					smallestDistanceEdgeIndex = j;
-				}
-			}
-
-			if (smallestDistanceEdge != 100000) //100000 distance means there is no other letter on the right, its the last letter of a line
-				wordBreaks.push_back(Pair(letters[currentLetters[smallestDistanceEdgeIndex]].x, smallestDistanceEdge));
+		// distance to nearest neighbor
+		std::vector<Pair>& wordBreaks = boxWordBreaks[boxIndex];
 
-			if (debug["showWords"])
+		if (debug["showWords"])
+		{
+			for (unsigned int i = 0; i < currentLetters.size(); i++)
 			{
-				if (firstPass_ == true)
-				{
+				if (pass.fontColor == BRIGHT)
 					cv::rectangle(output, letters[currentLetters[i]], cv::Scalar((255), (255), (255)), 1);
-					cv::rectangle(output, letters[currentLetters[smallestDistanceEdgeIndex]], cv::Scalar((255), (255), (255)), 1);
-				}
 				else
-				{
 					cv::rectangle(output, letters[currentLetters[i]], cv::Scalar((0), (0), (0)), 1);
-					cv::rectangle(output, letters[currentLetters[smallestDistanceEdgeIndex]], cv::Scalar((0), (0), (0)), 1);
-				}
-				cv::rectangle(output, boxes[boxIndex], cv::Scalar((155), (155), (155)), 2);
-				cv::imshow(breakingWordsDisplayName.c_str(), output);
-				cvMoveWindow(breakingWordsDisplayName.c_str(), 0, 0);
 			}
+			cv::rectangle(output, boxes[boxIndex], cv::Scalar((155), (155), (155)), 2);
+			cv::imshow(breakingWordsDisplayName.c_str(), output);
+			cvMoveWindow(breakingWordsDisplayName.c_str(), 0, 0);
 		}
 
 		//Sort wordBreaks
@@ -6060,15 +5719,7 @@ void DetectText::breakLinesIntoWords(std::vector<cv::Rect>& boxes, std::vector<c
 			std::cout << "bin: " << bin << std::endl;
 			std::cout << "max: " << max << std::endl;
 		}
-		int hist[bin];
-		int newHistogram[bin];
-
-		//reset histogram
-		for (unsigned int i = 0; i < (unsigned int)bin; i++)
-		{
-			hist[i] = 0;
-			newHistogram[i] = 0;
-		}
+		std::vector<int> hist(bin, 0);
 
 		//shift into positive numbers:
 		int shift = (max / ((double)bin)) * std::ceil(smallestWordBreak / (-max / ((double)bin)));
@@ -6272,8 +5923,11 @@ void DetectText::breakLinesIntoWords(std::vector<cv::Rect>& boxes, std::vector<c
 			textIsRotated = true;
 		if (letterBiggerThanLast - letterSmallerThanLast >= std::ceil(currentLetters.size() * 0.5))
 			textIsRotated = true;
-		std::cout << "letterSmallerThanLast: " << letterSmallerThanLast << std::endl;
-		std::cout << "letterBiggerThanLast: " << letterBiggerThanLast << std::endl;
+		if (debug["showWords"])
+		{
+			std::cout << "letterSmallerThanLast: " << letterSmallerThanLast << std::endl;
+			std::cout << "letterBiggerThanLast: " << letterBiggerThanLast << std::endl;
+		}
 		textIsRotated = false;		// todo: hack!
 
 		// same area
@@ -6435,48 +6089,87 @@ void DetectText::breakLinesIntoWords(std::vector<cv::Rect>& boxes, std::vector<c
 // cv::Rect smallerRe(smallestX, smallestY, biggestX - smallestX, biggestY - smallestY);
 }
 
-void DetectText::showEdgeMap()
+void DetectText::letterGaps(const std::vector<cv::Rect>& letters, const std::vector<cv::Rect>& boxes, std::vector<std::vector<int> >& boxLetters,
+		std::vector<std::vector<Pair> >& wordBreaks)
 {
-	if (firstPass_)
+	boxLetters.assign(boxes.size(), std::vector<int>());
+	wordBreaks.assign(boxes.size(), std::vector<Pair>());
+
+	// (x, index) of all letters sorted by their left border
+	std::vector<std::pair<int, int> > lettersX(letters.size());
+	for (unsigned int i = 0; i < letters.size(); i++)
+		lettersX[i] = std::make_pair(letters[i].x, static_cast<int>(i));
+	std::sort(lettersX.begin(), lettersX.end());
+
+	std::vector<std::pair<int, int> > inside; // letters of the current box, sorted by x
+	for (unsigned int b = 0; b < boxes.size(); b++)
 	{
-		cv::imwrite("edgemap.png", edgemap_);
+		// a letter inside the box starts within the x range of the box
+		const cv::Rect& box = boxes[b];
+		inside.clear();
+		std::vector<std::pair<int, int> >::const_iterator it = std::lower_bound(lettersX.begin(), lettersX.end(), std::make_pair(box.x, -1));
+		for (; it != lettersX.end() && it->first < box.x + box.width; ++it)
+			if ((box & letters[it->second]).area() == letters[it->second].area())
+				inside.push_back(*it);
+
+		std::vector<int>& currentLetters = boxLetters[b];
+		for (unsigned int i = 0; i < inside.size(); i++)
+			currentLetters.push_back(inside[i].second);
+		std::sort(currentLetters.begin(), currentLetters.end());
+
+		// the nearest letter right of a letter is the first one in x order with a larger x
+		for (unsigned int i = 0; i < currentLetters.size(); i++)
+		{
+			const cv::Rect& letter = letters[currentLetters[i]];
+			std::vector<std::pair<int, int> >::const_iterator next = std::upper_bound(inside.begin(), inside.end(), std::make_pair(letter.x, INT_MAX));
+			if (next != inside.end()) // no other letter on the right: last letter of a line
+				wordBreaks[b].push_back(Pair(next->first, next->first - letter.x - letter.width));
+		}
 	}
 }
-void DetectText::showCcmap(cv::Mat& ccmap)
+
+void DetectText::showEdgeMap()
+{
+	cv::imwrite("edgemap.png", edgemap_);
+}
+void DetectText::showCcmap(const PassContext& pass)
 {
 
-	cv::Mat ccmapLetters = ccmap * (1.0 / static_cast<float> (nComponent_));
-	for (size_t i = 0; i < nComponent_; ++i)
+	cv::Mat ccmapLetters;
+	pass.ccmap.convertTo(ccmapLetters, CV_32FC1, 1.0 / static_cast<float> (pass.nComponent));
+	for (size_t i = 0; i < pass.nComponent; ++i)
 	{
-		cv::Rect *itr = &labeledRegions_[i];
+		const cv::Rect *itr = &pass.labeledRegions[i];
 		rectangle(ccmapLetters, cv::Point(itr->x, itr->y), cv::Point(itr->x + itr->width, itr->y + itr->height), cv::Scalar(0.5));
 	}
-	if (firstPass_)
-		imwrite("ccmap1.jpg", ccmapLetters * nComponent_);
+	if (pass.fontColor == BRIGHT)
+		imwrite("ccmap1.jpg", ccmapLetters * pass.nComponent);
 	else
-		imwrite("ccmap2.jpg", ccmapLetters * nComponent_);
+		imwrite("ccmap2.jpg", ccmapLetters * pass.nComponent);
 }
-void DetectText::showSwtmap(cv::Mat& swtmap)
+void DetectText::showSwtmap(const PassContext& pass)
 {
-	if (firstPass_)
-		imwrite("swtmap1.jpg", swtmap * 10);
+	cv::Mat strokeWidths;
+	StrokeWidthTransform::toPixels(pass.swtmap, strokeWidths);
+	if (pass.fontColor == BRIGHT)
+		imwrite("swtmap1.jpg", strokeWidths * 10);
 	else
-		imwrite("swtmap2.jpg", swtmap * 10);
+		imwrite("swtmap2.jpg", strokeWidths * 10);
 }
-void DetectText::showLetterDetection()
+void DetectText::showLetterDetection(const PassContext& pass)
 {
 	cv::Mat output = originalImage_.clone();
 	cv::Scalar scalar;
-	if (firstPass_)
+	if (pass.fontColor == BRIGHT)
 		scalar = cv::Scalar(0, 255, 0);
 	else
 		scalar = cv::Scalar(0, 0, 255);
 
-	for (size_t i = 0; i < nComponent_; ++i)
+	for (size_t i = 0; i < pass.nComponent; ++i)
 	{
-		if (isLetterRegion_[i])
+		if (pass.isLetterRegion[i])
 		{
-			cv::Rect *itr = &labeledRegions_[i];
+			const cv::Rect *itr = &pass.labeledRegions[i];
 			rectangle(output, cv::Point(itr->x, itr->y), cv::Point(itr->x + itr->width, itr->y + itr->height), scalar, 2);
 			std::stringstream ss;
 			std::string s;
@@ -6485,29 +6178,29 @@ void DetectText::showLetterDetection()
 			imwrite(s, originalImage_(*itr));
 		}
 	}
-	if (firstPass_)
+	if (pass.fontColor == BRIGHT)
 		imwrite(outputPrefix_ + "_letters1.jpg", output);
 	else
 		imwrite(outputPrefix_ + "_letters2.jpg", output);
 }
-void DetectText::showLetterGroup()
+void DetectText::showLetterGroup(const PassContext& pass)
 {
 	cv::Mat output = originalImage_.clone();
 	cv::Scalar scalar;
-	if (firstPass_)
+	if (pass.fontColor == BRIGHT)
 		scalar = cv::Scalar(0, 255, 0);
 	else
 		scalar = cv::Scalar(0, 0, 255);
 
-	for (size_t i = 0; i < nComponent_; ++i)
+	for (size_t i = 0; i < pass.nComponent; ++i)
 	{
-		//if (isGrouped_[i]) isGrouped_[i] doesnt exist anymore, letterGroups_ has to be searched for i
+		//if (isGrouped_[i]) isGrouped_[i] doesnt exist anymore, pass.letterGroups has to be searched for i
 		// {
-		cv::Rect *itr = &labeledRegions_[i];
+		const cv::Rect *itr = &pass.labeledRegions[i];
 		rectangle(output, cv::Point(itr->x, itr->y), cv::Point(itr->x + itr->width, itr->y + itr->height), scalar, 2);
 		// }
 	}
-	if (firstPass_)
+	if (pass.fontColor == BRIGHT)
 		imwrite(outputPrefix_ + "_group1.jpg", output);
 	else
 		imwrite(outputPrefix_ + "_group2.jpg", output);
@@ -6,10 +6,13 @@
 #include <ros/ros.h>
 #include <image_transport/image_transport.h>
 #include <sensor_msgs/image_encodings.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 #include <pr2_mechanism_controllers/BaseOdometryState.h>
 
 #include <boost/thread/condition.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 
 #include <pcl/ros/conversions.h>
 #include <pcl/point_cloud.h>
@@ -26,6 +29,162 @@ namespace enc = sensor_msgs::image_encodings;
 
 static const char WINDOW[] = "Image window";
 
+/* holds the most recent camera frame until a streaming worker takes it
+ * a new frame replaces a frame that no worker has taken yet, so busy workers never process stale images
+ */
+class LatestFrameSlot
+{
+public:
+	LatestFrameSlot() :
+		closed_(false), received_(0), dropped_(0)
+	{
+	}
+
+	void put(const sensor_msgs::ImageConstPtr& frame)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (frame_)
+			dropped_++;
+		frame_ = frame;
+		received_++;
+		frameAvailable_.notify_one();
+	}
+
+	// blocks until a frame is available, returns false if the slot was closed
+	bool take(sensor_msgs::ImageConstPtr& frame)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		while (!frame_ && !closed_)
+			frameAvailable_.wait(lock);
+		if (closed_)
+			return false;
+		frame = frame_;
+		frame_.reset();
+		return true;
+	}
+
+	void close()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		closed_ = true;
+		frameAvailable_.notify_all();
+	}
+
+	void statistics(unsigned long& received, unsigned long& dropped)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		received = received_;
+		dropped = dropped_;
+	}
+
+private:
+	boost::mutex mutex_;
+	boost::condition_variable frameAvailable_;
+	sensor_msgs::ImageConstPtr frame_;
+	bool closed_;
+	unsigned long received_, dropped_;
+};
+
+/* mask of the image areas that are searched for text, derived from the point cloud registered to the color image:
+ * planar surfaces within reach that are not horizontal (no floor, ceiling or table tops), areas without depth (sky, far background) are left out
+ * horizontal is judged in the camera frame (y axis pointing down), so the camera is expected to look roughly level
+ */
+class SurfaceMask
+{
+public:
+	SurfaceMask() :
+		min_distance_(0.3), max_distance_(3.0), max_age_(1.0)
+	{
+	}
+
+	void setRange(double minDistance, double maxDistance)
+	{
+		min_distance_ = minDistance;
+		max_distance_ = maxDistance;
+	}
+
+	void update(const sensor_msgs::PointCloud2::ConstPtr& msg)
+	{
+		pcl::PointCloud<pcl::PointXYZ> cloud;
+		pcl::fromROSMsg(*msg, cloud);
+		if (cloud.height <= 1)
+		{
+			ROS_WARN_ONCE("SurfaceMask: the point cloud is not organized, no text regions can be derived from it");
+			return;
+		}
+
+		// every cell of cellSize x cellSize points whose points lie on a plane (small variation along the normal)
+		const int cellSize = 8;
+		const double maxSurfaceVariation = 0.02; // smallest eigenvalue / sum of eigenvalues of the covariance
+		const double maxVerticalNormal = 0.8; // |y| of the unit normal, larger = horizontal surface
+		cv::Mat mask(cloud.height, cloud.width, CV_8UC1, cv::Scalar(0));
+		for (int cy = 0; cy + cellSize <= (int)cloud.height; cy += cellSize)
+		{
+			for (int cx = 0; cx + cellSize <= (int)cloud.width; cx += cellSize)
+			{
+				double n = 0., sum[3] = {0., 0., 0.}, sumProducts[3][3] = {{0., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}};
+				for (int y = cy; y < cy + cellSize; y++)
+				{
+					for (int x = cx; x < cx + cellSize; x++)
+					{
+						const pcl::PointXYZ& point = cloud.points[y * cloud.width + x];
+						if (!pcl_isfinite(point.z) || point.z < min_distance_ || point.z > max_distance_)
+							continue;
+						double p[3] = {point.x, point.y, point.z};
+						n++;
+						for (int i = 0; i < 3; i++)
+						{
+							sum[i] += p[i];
+							for (int j = 0; j < 3; j++)
+								sumProducts[i][j] += p[i] * p[j];
+						}
+					}
+				}
+				if (n < cellSize * cellSize / 2)
+					continue;
+
+				cv::Mat covariance(3, 3, CV_64FC1);
+				for (int i = 0; i < 3; i++)
+					for (int j = 0; j < 3; j++)
+						covariance.at<double>(i, j) = sumProducts[i][j] / n - sum[i] * sum[j] / (n * n);
+				cv::Mat eigenvalues, eigenvectors;
+				cv::eigen(covariance, eigenvalues, eigenvectors); // descending eigenvalues, the last eigenvector is the normal
+				double eigenvalueSum = eigenvalues.at<double>(0) + eigenvalues.at<double>(1) + eigenvalues.at<double>(2);
+				if (eigenvalueSum <= 0. || eigenvalues.at<double>(2) / eigenvalueSum > maxSurfaceVariation)
+					continue;
+				if (fabs(eigenvectors.at<double>(2, 1)) > maxVerticalNormal)
+					continue;
+				mask(cv::Rect(cx, cy, cellSize, cellSize)).setTo(cv::Scalar(255));
+			}
+		}
+		// the borders of signs are depth edges, their cells are not planar
+		cv::dilate(mask, mask, cv::Mat(), cv::Point(-1, -1), cellSize);
+
+		boost::mutex::scoped_lock lock(mutex_);
+		mask_ = mask;
+		stamp_ = msg->header.stamp;
+	}
+
+	/* mask in the given image size from the point cloud closest in time to stamp
+	 * returns false if there is no point cloud within max_age_ of stamp
+	 */
+	bool get(const ros::Time& stamp, cv::Size size, cv::Mat& mask)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (mask_.empty() || fabs((stamp - stamp_).toSec()) > max_age_)
+			return false;
+		cv::resize(mask_, mask, size, 0, 0, cv::INTER_NEAREST);
+		return true;
+	}
+
+private:
+	boost::mutex mutex_;
+	cv::Mat mask_; // resolution of the point cloud
+	ros::Time stamp_;
+	double min_distance_, max_distance_; // range of the surfaces in m (depth)
+	double max_age_; // s
+};
+
 class TextReader
 {
 public:
@@ -35,6 +194,8 @@ public:
 	image_transport::Publisher image_pub_;
 	ros::Subscriber robot_state_sub_;
 	ros::Subscriber depth_sub_;
+	ros::Publisher diagnostics_pub_;
+	bool publish_diagnostics_;
 	DetectText detector;
 	ros::Time last_movement_;
 
@@ -49,6 +210,19 @@ public:
 	bool okToDetect_;
 	bool initialized_;
 
+	// streaming mode: every worker thread owns a copy of detector and takes the newest frame from frame_slot_
+	bool streaming_;
+	LatestFrameSlot frame_slot_;
+	boost::thread_group workers_;
+	boost::mutex publish_lock_;
+
+	// time budget of one detection in seconds, 0 = no limit (the detection finishes all boxes)
+	double detection_budget_;
+
+	// detection only on the surfaces found in the point cloud
+	bool depth_roi_;
+	SurfaceMask surface_mask_;
+
 	TextReader(const char* correlation, const char* dictionary) :
 		it_(nh_)//, cloud(new pcl::PointCloud<pcl::PointXYZRGB>), viewer(new pcl::visualization::PCLVisualizer("3D Viewer"))
 	{
@@ -61,8 +235,6 @@ public:
 		image_sub_ = it_.subscribe("image_color", 1, &TextReader::imageCb, this);
 		robot_state_sub_ = nh_.subscribe("/base_odometry/state", 1, &TextReader::robotStateCb, this);
 
-		//    depth_sub_ = nh_.subscribe("/camera/depth_registered/points", 1, &TextReader::depthCb, this);
-
 		detector = DetectText();
 		detector.readLetterCorrelation(correlation);
 		detector.readWordList(dictionary);
@@ -71,6 +243,10 @@ public:
 		pthread_mutex_init(&pr2_image_lock_, NULL);
 		okToDetect_ = false;
 		initialized_ = false;
+		streaming_ = false;
+		publish_diagnostics_ = false;
+		detection_budget_ = 0.;
+		depth_roi_ = false;
 
 		x_ = 0;
 		y_ = 0;
@@ -78,6 +254,143 @@ public:
 
 	~TextReader()
 	{
+		stopStreaming();
+	}
+
+	/* advertise on topic "text_detect_diagnostics" the stage times and counts of every detection
+	 */
+	void enableDiagnostics()
+	{
+		diagnostics_pub_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("text_detect_diagnostics", 1);
+		publish_diagnostics_ = true;
+	}
+
+	void publishStatistics(const DetectionStatistics& statistics, const std_msgs::Header& header)
+	{
+		if (!publish_diagnostics_)
+			return;
+
+		diagnostic_msgs::DiagnosticArray diagnostics;
+		diagnostics.header = header;
+		diagnostic_msgs::DiagnosticStatus status;
+		status.level = diagnostic_msgs::DiagnosticStatus::OK;
+		status.name = "cob_read_text: detection";
+		status.hardware_id = "none";
+		status.message = "stage times [s] and counts of the last detection";
+		if (statistics.counts[DetectionStatistics::UNREAD_BOXES] > 0)
+		{
+			status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+			status.message = "no tesseract engine could be initialized, the boxes were not read";
+		}
+		else if (statistics.counts[DetectionStatistics::SKIPPED_BOXES] > 0)
+		{
+			status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+			status.message = "partial result, boxes skipped to meet the detection budget";
+		}
+		for (int s = 0; s < DetectionStatistics::NUMBER_STAGES; s++)
+		{
+			diagnostic_msgs::KeyValue value;
+			value.key = std::string(DetectionStatistics::stageName(s)) + " [s]";
+			std::stringstream ss;
+			ss << statistics.seconds[s];
+			value.value = ss.str();
+			status.values.push_back(value);
+		}
+		for (int c = 0; c < DetectionStatistics::NUMBER_COUNTERS; c++)
+		{
+			diagnostic_msgs::KeyValue value;
+			value.key = DetectionStatistics::counterName(c);
+			std::stringstream ss;
+			ss << statistics.counts[c];
+			value.value = ss.str();
+			status.values.push_back(value);
+		}
+		diagnostics.status.push_back(status);
+		diagnostics_pub_.publish(diagnostics);
+	}
+
+	/* subscribe on topic "points" for the point cloud registered to the color image, from now on the detection
+	 * only searches the surfaces found in the latest point cloud (whole image if there is no recent one)
+	 */
+	void enableDepthRoi(double minDistance, double maxDistance)
+	{
+		surface_mask_.setRange(minDistance, maxDistance);
+		depth_sub_ = nh_.subscribe("points", 1, &TextReader::depthCb, this);
+		depth_roi_ = true;
+	}
+
+	/* detection within detection_budget_ (if set), the best boxes are read first and the rest is skipped when the time is up
+	 * with depth_roi_ only on the surfaces of the point cloud of the image time
+	 */
+	void runDetection(DetectText& textDetector, cv::Mat& image, const ros::Time& stamp)
+	{
+		ros::WallTime deadline; // zero = no deadline
+		if (detection_budget_ > 0.)
+			deadline = ros::WallTime::now() + ros::WallDuration(detection_budget_);
+
+		cv::Mat mask;
+		if (depth_roi_ && surface_mask_.get(stamp, image.size(), mask))
+			textDetector.detect(image, mask, deadline);
+		else
+			textDetector.detect(image, deadline);
+	}
+
+	/* starts numberWorkers detection threads, from now on imageCb only hands the frames to the workers
+	 * detector has to be configured (setParams, correlation, dictionary) before
+	 */
+	void startStreaming(int numberWorkers)
+	{
+		streaming_ = true;
+		for (int w = 0; w < std::max(1, numberWorkers); w++)
+			workers_.create_thread(boost::bind(&TextReader::streamingWorker, this, detector));
+	}
+
+	void stopStreaming()
+	{
+		frame_slot_.close();
+		workers_.join_all();
+	}
+
+	/* detection thread of the streaming mode
+	 * frames arriving while all workers are busy replace each other in frame_slot_, only the newest one is processed
+	 */
+	void streamingWorker(DetectText workerDetector)
+	{
+		sensor_msgs::ImageConstPtr msg;
+		while (frame_slot_.take(msg))
+		{
+			// no detection while the robot is moving, images are blurred
+			pthread_mutex_lock(&pr2_velocity_lock_);
+			bool is_steady = (ros::Time::now() - last_movement_ > ros::Duration(2));
+			bool is_moving = (x_ != 0 || y_ != 0);
+			pthread_mutex_unlock(&pr2_velocity_lock_);
+			if (!is_steady || is_moving)
+				continue;
+
+			cv_bridge::CvImagePtr frame;
+			try
+			{
+				frame = cv_bridge::toCvCopy(msg, enc::BGR8);
+			} catch (cv_bridge::Exception& e)
+			{
+				ROS_ERROR("cv_bridge exception: %s", e.what());
+				continue;
+			}
+
+			runDetection(workerDetector, frame->image, msg->header.stamp);
+
+			// publish with the time stamp of the source image
+			cv_bridge::CvImage detection(msg->header, enc::BGR8, workerDetector.getDetection());
+			unsigned long received, dropped;
+			frame_slot_.statistics(received, dropped);
+			boost::mutex::scoped_lock lock(publish_lock_);
+			image_pub_.publish(detection.toImageMsg());
+			publishStatistics(workerDetector.getStatistics(), msg->header);
+			ROS_INFO("text detection of frame %.3f done: %d texts, %lu of %lu frames dropped", msg->header.stamp.toSec(),
+					(int)workerDetector.getWords().size(), dropped, received);
+			for (unsigned int i = 0; i < workerDetector.getWords().size(); i++)
+				std::cout << workerDetector.getWords()[i] << ": x=" << workerDetector.getBoxes()[i].center.x << ", y=" << workerDetector.getBoxes()[i].center.y << std::endl;
+		}
 	}
 
 	/* call back function
@@ -98,6 +411,12 @@ public:
 	 */
 	void imageCb(const sensor_msgs::ImageConstPtr& msg)
 	{
+		if (streaming_)
+		{
+			frame_slot_.put(msg);
+			return;
+		}
+
 		try
 		{
 			pthread_mutex_trylock(&pr2_image_lock_);
@@ -117,24 +436,13 @@ public:
 		}
 	}
 
-	/* call back function for depth picture
-	 void depthCb(sensor_msgs::PointCloud2::ConstPtr recent_image)
-	 {
-	 pcl::fromROSMsg(*recent_image, *cloud);
-	 pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> color_hdl(cloud);
-	 if (!(viewer->updatePointCloud<pcl::PointXYZRGB> (cloud, color_hdl)))
-	 {
-	 viewer->addPointCloud(cloud, color_hdl, "cloud", 0);
-	 viewer->addCoordinateSystem(1.0, 0);
-	 }
-	 viewer->updatePointCloud<pcl::PointXYZRGB> (cloud, color_hdl);
-	 viewer->spinOnce(100);
-	 boost::this_thread::sleep(boost::posix_time::microseconds(100000));
-	 }
-
-	 pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;
-	 boost::shared_ptr<pcl::visualization::PCLVisualizer> viewer;
+	/* call back function
+	 * the point cloud of topic "points" updates the surfaces that are searched for text
 	 */
+	void depthCb(const sensor_msgs::PointCloud2::ConstPtr& msg)
+	{
+		surface_mask_.update(msg);
+	}
 };
 
 int main(int argc, char** argv)
@@ -151,6 +459,38 @@ int main(int argc, char** argv)
 	ros::NodeHandle nh;
 	detector.setParams(nh);
 
+	// stage times and counts of every detection on a diagnostics topic
+	bool publishDiagnostics = false;
+	nh.getParam("publishDiagnostics", publishDiagnostics);
+	if (publishDiagnostics)
+		reader.enableDiagnostics();
+
+	// time budget of every detection in seconds (0 = no limit)
+	nh.getParam("detectionBudget", reader.detection_budget_);
+
+	// detection only on planar surfaces within reach, derived from the registered point cloud
+	bool depthRoi = false;
+	double depthRoiMinDistance = 0.3, depthRoiMaxDistance = 3.0;
+	nh.getParam("depthRoi", depthRoi);
+	nh.getParam("depthRoiMinDistance", depthRoiMinDistance);
+	nh.getParam("depthRoiMaxDistance", depthRoiMaxDistance);
+	if (depthRoi)
+		reader.enableDepthRoi(depthRoiMinDistance, depthRoiMaxDistance);
+
+	// streaming mode: detection on every frame the workers can keep up with, instead of one detection every 2 s
+	bool streaming = false;
+	int streamingWorkers = 1;
+	nh.getParam("streaming", streaming);
+	nh.getParam("streamingWorkers", streamingWorkers);
+	if (streaming)
+	{
+		ROS_INFO("streaming mode with %d detection workers", std::max(1, streamingWorkers));
+		reader.startStreaming(streamingWorkers);
+		ros::spin();
+		reader.stopStreaming();
+		return 0;
+	}
+
 	ros::Rate r(1);
 	ros::Time last_detection = ros::Time::now();
 	//int32_t sys_ret;
@@ -180,12 +520,13 @@ int main(int argc, char** argv)
 
 			// do the detection
 			pthread_mutex_lock(&(reader.pr2_image_lock_));
-			detector.detect(reader.cv_ptr->image);
+			reader.runDetection(detector, reader.cv_ptr->image, reader.cv_ptr->header.stamp);
 			pthread_mutex_unlock(&(reader.pr2_image_lock_));
 
 			// publish the detection
 			reader.detection_ptr->image = detector.getDetection();
 			reader.image_pub_.publish(reader.detection_ptr->toImageMsg());
+			reader.publishStatistics(detector.getStatistics(), reader.cv_ptr->header);
 
 			// text to speech:
 			/*
@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <stack>
 #include <cstdio>
 #include <dirent.h>
@@ -107,37 +108,42 @@ double cutout(std::string label, std::string output)
 		return -1.;
 }
 
-int readInEstimates(std::vector<img> &images, std::string path, EvaluationRectangleFormat evaluationRectangleFormat, bool evaluateOCR)
+int readInEstimates(std::vector<img> &images, std::string path, EvaluationRectangleFormat evaluationRectangleFormat, bool evaluateOCR, int detectionWorkers)
 {
-	for (unsigned int imageIndex = 0; imageIndex < images.size(); imageIndex++)
+	// list of all images, run_detect processes them in one call with several detection workers
+	std::string listname = path.substr(0, path.find_last_of("/") + 1) + "read_evaluation_images.txt";
+	std::ofstream listfile(listname.c_str());
+	if (!listfile.is_open())
 	{
-		// Show progress (for large image sets)
-		std::cout << std::endl;
-		std::cout << std::endl;
-		std::cout << "Processing: image " << imageIndex << "/" << images.size() << std::endl;
-		std::cout << "[";
-		for (unsigned int i = 0; i < floor((imageIndex / (float) images.size()) * 30); i++)
-			std::cout << "|";
-		for (unsigned int i = 0; i < ceil(((images.size() - imageIndex) / (float) images.size()) * 30); i++)
-			std::cout << " ";
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
-
-		// run read_text
-		std::string imgpath = path.substr(0, path.find_last_of("/") + 1);
-		imgpath.append(images[imageIndex].img_name);
-		std::string cmd_ = ros::package::getPath("cob_read_text") + "/bin/run_detect " + imgpath + " " + ros::package::getPath("cob_read_text_data")
-				+ "/fonts/new_correlation.txt " + ros::package::getPath("cob_read_text_data") + "/dictionary/full-dictionary";//_ger";	//todo: make dictionary path a parameter
+		std::cout << "While opening file " << listname << " an error occurred." << std::endl;
+		return -1;
+	}
+	for (unsigned int imageIndex = 0; imageIndex < images.size(); imageIndex++)
+		listfile << images[imageIndex].img_name << std::endl;
+	listfile.close();
 
-		cmd_.append(" eval");
-		if (evaluateOCR == false)
-			cmd_.append(" OCRoff");
+	// run read_text
+	std::string cmd_ = ros::package::getPath("cob_read_text") + "/bin/run_detect " + listname + " " + ros::package::getPath("cob_read_text_data")
+			+ "/fonts/new_correlation.txt " + ros::package::getPath("cob_read_text_data") + "/dictionary/full-dictionary";//_ger";	//todo: make dictionary path a parameter
 
-		std::cout << "cmd_: " << cmd_ << std::endl;
+	cmd_.append(" eval");
+	if (evaluateOCR == false)
+		cmd_.append(" OCRoff");
+	std::stringstream workers;
+	workers << " workers=" << detectionWorkers;
+	cmd_.append(workers.str());
 
-		if (system(cmd_.c_str()) != 0)
-			std::cout << "Error occurred while running text_detect" << std::endl;
+	std::cout << "cmd_: " << cmd_ << std::endl;
+
+	if (system(cmd_.c_str()) != 0)
+		std::cout << "Error occurred while running text_detect" << std::endl;
 
+	cmd_ = "rm " + listname;
+	if (system(cmd_.c_str()) != 0)
+		std::cout << "Error occurred while deleting file " << listname << "!" << std::endl;
+
+	for (unsigned int imageIndex = 0; imageIndex < images.size(); imageIndex++)
+	{
 		// get read_text results
 		std::ifstream ocrfile;
 		std::string input;
@@ -539,9 +545,10 @@ void showRects(std::vector<img> &images, std::string path)
 	}
 }
 
-void calculateBoxResults(std::vector<img> &images, float alpha, EvaluationRectangleFormat evaluationRectangleFormat)
+// results of the images task, task + numberTasks, ... (every image is evaluated independently of the others)
+void calculateBoxResults(std::vector<img> &images, float alpha, EvaluationRectangleFormat evaluationRectangleFormat, int numberTasks = 1, int task = 0)
 {
-	for (unsigned int imageIndex = 0; imageIndex < images.size(); imageIndex++)
+	for (unsigned int imageIndex = task; imageIndex < images.size(); imageIndex += numberTasks)
 	{
 		unsigned int numberEstimatedRects = images[imageIndex].estimatedRects.size();
 		unsigned int numberCorrectRects = images[imageIndex].correctRects.size();
@@ -862,9 +869,10 @@ bool lineSegmentIntersection(const cv::Point2f& basePoint1, const cv::Point2f& l
 	return false;
 }
 
-void calculateWordResults(std::vector<img> &images)
+// results of the images task, task + numberTasks, ...
+void calculateWordResults(std::vector<img> &images, int numberTasks = 1, int task = 0)
 {
-	for (unsigned int imageIndex = 0; imageIndex < images.size(); imageIndex++)
+	for (unsigned int imageIndex = task; imageIndex < images.size(); imageIndex += numberTasks)
 	{
 		unsigned int foundWords = 0;
 		std::vector<std::string> brokenWords; // single words
@@ -908,6 +916,12 @@ void calculateWordResults(std::vector<img> &images)
 	}
 }
 
+void calculateResultsTask(std::vector<img> &images, float alpha, EvaluationRectangleFormat evaluationRectangleFormat, int numberTasks, int task)
+{
+	calculateBoxResults(images, alpha, evaluationRectangleFormat, numberTasks, task);
+	calculateWordResults(images, numberTasks, task);
+}
+
 std::vector<double> printAverageResults(std::vector<img> &images, std::string path)
 {
 	std::vector<double> results;
@@ -1031,12 +1045,19 @@ int main(int argc, char **argv)
 	DatabaseFormat databaseFormat = ICDAR2003;
 	EvaluationRectangleFormat evaluationRectangleFormat = UPRIGHT;
 	bool evaluateOCR = false;
+	int detectionWorkers = 1; // images detected in parallel, 0 = one per cpu core (run_detection uses 1 with debug windows)
 
 	if (argc < 2)
 	{
-		ROS_ERROR( "not enought input: eval_read_text <img_list_name.xml>");
+		ROS_ERROR( "not enought input: eval_read_text <img_list_name.xml> [workers=<n>]");
 		return 1;
 	}
+	for (int i = 2; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option.compare(0, 8, "workers=") == 0)
+			detectionWorkers = atoi(option.substr(8).c_str());
+	}
 
 	float alpha = 0.5;
 
@@ -1046,7 +1067,7 @@ int main(int argc, char **argv)
 	readInSolution(images, argv[1], databaseFormat);
 
 	//run read_text and write results in ocrImages
-	readInEstimates(images, argv[1], evaluationRectangleFormat, evaluateOCR);
+	readInEstimates(images, argv[1], evaluationRectangleFormat, evaluateOCR, detectionWorkers);
 
 	std::cout << "Number of images that were processed: " << images.size() << std::endl;
 
@@ -1060,11 +1081,9 @@ int main(int argc, char **argv)
 		std::cout << images[0].estimatedRects[i].center.x << " " << images[0].estimatedRects[i].center.y << " " << images[0].estimatedRects[i].size.width << " "
 				<< images[0].estimatedRects[i].size.height << " " << images[0].estimatedRects[i].angle << " " << images[0].estimatedTexts[i] << std::endl;
 
-	//calculate precision, recall, f
-	calculateBoxResults(images, alpha, evaluationRectangleFormat);
-
-	//calculate how many words got recognized
-	calculateWordResults(images);
+	//calculate precision, recall, f and how many words got recognized, the images in parallel
+	int numberTasks = resolveNumberThreads(0);
+	parallelTasks(numberTasks, boost::bind(&calculateResultsTask, boost::ref(images), alpha, evaluationRectangleFormat, numberTasks, _1));
 
 	//show everything
 	showRects(images, argv[1]);
@@ -18,6 +18,10 @@
 #include <pcl_ros/point_cloud.h>
 #include <pcl/pcl_base.h>
 
+// Boost
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
 // timer
 #include <iostream>
 #include "timer.h"
@@ -37,7 +41,9 @@ public:
 		offsetConcConv_(1.5),
 		lineLength_(20),
 		windowX_(600),
-		windowY_(600)
+		windowY_(600),
+		integralLineFit_(false),
+		numberThreads_(1)
 	{};
 
 	inline void setEdgeThreshold(float th)
@@ -61,25 +67,82 @@ public:
 		windowX_ = x;
 		windowY_ = y;
 	}
+	//true: lines in x-direction are fitted in O(1) from running sums over each image row instead of collecting the coordinates of every line
+	inline void setIntegralLineFit(bool integral)
+	{
+		integralLineFit_ = integral;
+	}
+	//number of threads computing bands of image rows in computeDepthEdges(), <= 0: one thread per cpu core
+	inline void setNumberThreads(int numberThreads)
+	{
+		numberThreads_ = numberThreads;
+	}
 
-	void computeDepthEdges(cv::Mat depth_image, PointCloudInPtr pointcloud, cv::Mat& edgeImage);
+	//pointcloud: organized, its coordinates are read in place (no depth image)
+	void computeDepthEdges(PointCloudInPtr pointcloud, cv::Mat& edgeImage);
+	//same, additionally returns the scalar products of the lines in x- and y-direction (CV_32FC1, 1 where no lines were fitted)
+	void computeDepthEdges(PointCloudInPtr pointcloud, cv::Mat& edgeImage, cv::Mat& scalarProductsX, cv::Mat& scalarProductsY);
 
 
 private:
 
-	void coordinatesMat(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& coordinates, bool& step);
-	void approximateLine(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotLeft, cv::Point2f dotRight, cv::Mat& abc,cv::Mat& n, cv::Mat& coordinates, bool& step);
-	void approximateLine(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& abc);
-	void scalarProduct(cv::Mat& abc1,cv::Mat& abc2,float& scalarProduct, int& concaveConvex, bool& step);
-	void approximateLineFullAndHalfDist (cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& abc);
+	//test/test_edge_detection.cpp compares the line fits with a SVD
+	friend class EdgeDetectionLineFitTest;
+
+	//view of an organized point cloud: depth z and the coordinates x and y are read from the points without copying them.
+	//(a cv::Mat cannot have a column stride of one point, so the points are accessed directly)
+	struct CloudView
+	{
+		CloudView(const PointCloudIn& cloud);
+
+		const PointInT& at(int x, int y) const
+		{
+			return points[y*width + x];
+		}
+		bool isValid(int x, int y) const
+		{
+			return valid.at<unsigned char>(y,x) != 0;
+		}
+
+		const PointInT* points;
+		int width;
+		int height;
+		cv::Mat valid;	//CV_8UC1, 1 where the point has data (no nan coordinates), computed once per frame
+	};
+
+	//prefix sums over the points of one image row, element i of the sums covers the columns 0..i-1
+	//only points with valid data are summed up, s = x+y of the point (w = s-s0 along the row), z = depth
+	struct LineSums
+	{
+		std::vector<int> count;
+		std::vector<double> s, z, ss, sz, zz;
+		std::vector<int> steps;	//number of depth steps > 0.05 between consecutive valid points
+		std::vector<int> firstValid;	//first valid column >= i (cols if none)
+		std::vector<int> lastValid;	//last valid column <= i (-1 if none)
+		std::vector<double> position;	//s of column i
+	};
+
+	//per pixel kernels: line parameters abc of the line a*w+b*z+c = 0 as float[3], coordinates in caller buffers (no allocation per pixel)
+	int coordinatesLine(const CloudView& cloud, cv::Point2f dotIni, cv::Point2f dotEnd, float* w, float* z, bool& step);
+	void approximateLine(const float* w, const float* z, int count, float* abc);
+	void approximateLine(const CloudView& cloud, cv::Point2f dotIni, cv::Point2f dotEnd, float* abc);
+	void approximateLineFullAndHalfDist (const CloudView& cloud, cv::Point2f dotIni, cv::Point2f dotEnd, float* abc);
+	float scalarProduct(const float* abc1, const float* abc2, bool step);
+	static void smallestEigenvector(const double* m, float* v);
+
+	//integral line fit: same result as approximateLine() on the coordinates of the points of a row between columns first and last
+	void computeLineSums(const CloudView& cloud, int row, LineSums& sums);
+	void approximateLine(const LineSums& sums, int first, int last, bool originAtLast, float* abc, bool& step);
+
+	void computeDepthEdgesBand(const CloudView& cloud, cv::Mat& scalarProductsX, cv::Mat& scalarProductsY, cv::Mat& concaveConvex, int rowStart, int rowEnd);
 
 	void thinEdges(cv::Mat& edgePicture, int xy);
 	void drawLines(cv::Mat& plotXY, cv::Mat& coordinates, cv::Mat& abc);
 	void drawLineAlongN(cv::Mat& plotZW, cv::Mat& coordinates, cv::Mat& n);
 
-	void deriv2nd3pts (cv::Mat threePoints, float& deriv);
+	void deriv2nd3pts (const float* z, int count, float& deriv);
 	void deriv2nd5pts (cv::Mat threePoints, float& deriv);
-	void deriv2nd (cv::Mat depth_image,PointCloudInPtr cloud, cv::Point2f dotStart, cv::Point2f dotStop, float& deriv);
+	void deriv2nd (const CloudView& cloud, cv::Point2f dotStart, cv::Point2f dotStop, float* w, float* z, float& deriv);
 
 
 	float edgeThreshold_;	//scalarproduct > edgeThreshold is set to 1 and thus not detected as edge. the larger the threshold, the more lines are detected as edges.
@@ -88,6 +151,8 @@ private:
 	int lineLength_;	//depth coordinates along two lines with length lineLength/2 are considered
 	int windowX_;	//size of visualization windows in x-direction
 	int windowY_;
+	bool integralLineFit_;	//fit lines in x-direction from running sums over the rows instead of the coordinates of every line
+	int numberThreads_;	//threads processing bands of rows in computeDepthEdges()
 };
 
 
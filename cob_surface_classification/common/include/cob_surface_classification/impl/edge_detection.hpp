@@ -10,14 +10,30 @@
 
 #define DECIDE_CURV false	//mark points on SURFACES (not only edges) as concave or convex
 
-template <typename PointInT> void
-EdgeDetection<PointInT>::coordinatesMat
-(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& coordinates, bool& step)
+template <typename PointInT>
+EdgeDetection<PointInT>::CloudView::CloudView
+(const PointCloudIn& cloud)
+: points(cloud.points.empty() ? 0 : &cloud.points[0]), width(cloud.width), height(cloud.height), valid(cloud.height, cloud.width, CV_8UC1)
+{
+	//validity mask instead of marking points without data by depth 0 in a copied depth image
+	for(int iY = 0; iY < height; iY++)
+	{
+		unsigned char* validRow = valid.ptr<unsigned char>(iY);
+		const PointInT* pointRow = points + iY*width;
+		for(int iX = 0; iX < width; iX++)
+			validRow[iX] = !(std::isnan(pointRow[iX].x) || std::isnan(pointRow[iX].y) || std::isnan(pointRow[iX].z));
+	}
+}
+
+//-------------------------------------------------------------------------------------------------------------------------
+
+template <typename PointInT> int
+EdgeDetection<PointInT>::coordinatesLine
+(const CloudView& cloud, cv::Point2f dotIni, cv::Point2f dotEnd, float* w, float* z, bool& step)
 {
 	/* consider depth coordinates along the line between dotIni and dotEnd
-	 * write them into a matrix
-	 * first column: coordinate on the line w, second column: depth z
-	 * format of one row: [coordinate along the line (w), depth coordinate (z) , 1]
+	 * write the points with valid data into w (coordinate on the line) and z (depth coordinate),
+	 * both need room for all pixels of the line. Returns the number of valid points.
 	 * --------------------------------------------------------------------------------*/
 
 	//dotIni is origin of local coordinate system, dotEnd the end point of the line
@@ -25,93 +41,44 @@ EdgeDetection<PointInT>::coordinatesMat
 	int yDist = dotEnd.y - dotIni.y;
 	//include both points -> one coordinate more than distance
 	int lineLength = std::max(std::abs(xDist),std::abs(yDist)) + 1;
-	int sign = 1;	//iteration in positive or negative direction
-	int xIter[lineLength];
-	int yIter[lineLength];
 
-	//iterate from dotIni to dotEnd. Set up indices for iteration:
+	//iterate from dotIni to dotEnd, either in x- or in y-direction
+	int xSign = 0;
+	int ySign = 0;
 	if(xDist != 0)
-	{
-		//line in x-direction
-		if(xDist <0)
-			sign = -1;
-
-		for(int i=0; i<lineLength; i ++)
-		{
-			xIter[i] = dotIni.x + i * sign;
-			yIter[i] = dotIni.y;
-		}
-	}
+		xSign = (xDist < 0) ? -1 : 1;
 	else
-	{
-		//line in y-direction
-		if(yDist <0)
-			sign = -1;
-
-		for(int i=0; i<lineLength; i ++)
-		{
-			xIter[i] = dotIni.x;
-			yIter[i] = dotIni.y + i*sign;
-		}
-	}
-
-
-	float x0,y0; //coordinates of reference point
-
-
-	int iCoord;
-
-	/*timer.start();
-		for(int itim=0;itim<10000;itim++)
-		{*/
-
-	coordinates = cv::Mat::zeros(lineLength,3,CV_32FC1);
-	iCoord = 0;
-	int iX = 0;
-	int iY = 0;
-	bool first = true;
+		ySign = (yDist < 0) ? -1 : 1;
+	int xIni = dotIni.x;
+	int yIni = dotIni.y;
 
-
-
-	while(iX < lineLength && iY < lineLength)
+	float x0 = 0, y0 = 0; //coordinates of reference point
+	int count = 0;
+	for(int i=0; i<lineLength; i++)
 	{
-		//später nicht einfach x bzw y-Koordinate betrachten, sondern (x-x0)²+(y-y0)² als w nehmen
-
-
+		int xIter = xIni + i*xSign;
+		int yIter = yIni + i*ySign;
 		//don't save points with nan-entries (no data available)
-		if(!std::isnan(pointcloud->at(xIter[iX],yIter[iY]).x))
-		{
-
-			if(first)
-			{
-				//origin of local coordinate system is the first point with valid data. Express coordinates relatively:
-				x0 = pointcloud->at(xIter[iX],yIter[iY]).x;		//x0 = pointcloud->at(xIter.pos().x,xIter.pos().y).x;
-				y0 = pointcloud->at(xIter[iX],yIter[iY]).y;
-				first = false;
-			}
-			coordinates.at<float>(iCoord,0) = (pointcloud->at(xIter[iX],yIter[iY]).x - x0)
-													+ (pointcloud->at(xIter[iX],yIter[iY]).y - y0);
-			coordinates.at<float>(iCoord,1) = depth_image.at<float>(yIter[iY], xIter[iX]);	//depth coordinate
-			coordinates.at<float>(iCoord,2) = 1.0;
-
-
-			//detect steps in depth coordinates
-			if(iCoord != 0 && std::abs(coordinates.at<float>(iCoord,1) - coordinates.at<float>(iCoord-1,1)) > 0.05)
-			{
-				step = true;
-			}
+		if(!cloud.isValid(xIter,yIter))
+			continue;
+		const PointInT& point = cloud.at(xIter,yIter);
 
-			iCoord++;
+		if(count == 0)
+		{
+			//origin of local coordinate system is the first point with valid data. Express coordinates relatively:
+			x0 = point.x;
+			y0 = point.y;
 		}
-		iX++;
-		iY++;
-	}
+		w[count] = (point.x - x0) + (point.y - y0);
+		z[count] = point.z;	//depth coordinate
 
-	if(iCoord != 0 && iCoord<lineLength)
-	{
-		coordinates.resize(iCoord);
-	}
+		//detect steps in depth coordinates
+		if(count != 0 && std::abs(z[count] - z[count-1]) > 0.05)
+			step = true;
 
+		count++;
+	}
+	return count;
 }
 
 
@@ -121,368 +88,31 @@ EdgeDetection<PointInT>::coordinatesMat
 
 template <typename PointInT> void
 EdgeDetection<PointInT>::approximateLine
-(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& abc, cv::Mat& n, cv::Mat& coordinates, bool& step)
+(const float* w, const float* z, int count, float* abc)
 {
-	//Achtung: coordinates-Matrix wird durch SVD verändert
-
-	/* consider depth coordinates between dotIni and dotEnd.
-	 *  linear regression via least squares minimisation (-> SVD)
-	 *   parameters of the approximated line: aw+bz+1 = 0
+	/* linear regression of the coordinates via least squares minimisation
+	 * parameters of the approximated line: a*w+b*z+c = 0
+	 * abc minimizes |[w z 1]*abc| with |abc| = 1 like the last right singular vector of the SVD of the coordinates matrix [w, z, 1],
+	 * it is the eigenvector to the smallest eigenvalue of coordinates^T * coordinates (3x3)
 	 * ----------------------------------------------------------*/
 
-	Timer timer;
+	abc[0] = abc[1] = abc[2] = 0;
 
+	//at least three points needed, else no line is approximated
+	if(count < 3)
+		return;
 
-	//set up coordinates matrix for points between dotIni and dotEnd
-	coordinatesMat(depth_image,  pointcloud,  dotIni,  dotEnd, coordinates, step);
-
-	//if(iCoord == 0)
-	if(coordinates.rows == 0)
-		//no valid data
-		abc = cv::Mat::zeros(1,3,CV_32FC1);
-	else
-	{
-		cv::Mat sv;	//singular values
-		cv::Mat u;	//left singular vectors
-		cv::Mat vt;	//right singular vectors, transposed, 3x3
-
-		//if there have been valid coordinates available, perform SVD
-		//last column of v = last row of v-transposed is x, so that y is minimal
-		if(coordinates.rows >2)
-		{
-			cv::SVD::compute(coordinates,sv,u,vt,cv::SVD::MODIFY_A);
-			abc =  vt.row(2);
-		}
-
-	}
-	/*}
-		timer.stop();
-		std::cout << timer.getElapsedTimeInMilliSec() /10000<< " ms for setting up coordinates-matrix + SVD (averaged over 10000 iterations)\n";*/
-
-
-
-	/*
-
-		//---------------------------------------------------------------------------------------------------
-		//PCA version
-		//---------------------------------------------------------------------------------------------------
-
-
-		//timer.start();
-		//for(int itim=0;itim<10000;itim++)
-		//{
-
-		iCoord = 0;
-		int iX = 0;
-		int iY = 0;
-		bool first = true;
-		coordinates = cv::Mat::zeros(lineLength,2,CV_32FC1);
-		cv::PCA pca;
-
-
-		while(iX < lineLength && iY < lineLength)
-		{
-			//später nicht einfach x bzw y-Koordinate betrachten, sondern (x-x0)²+(y-y0)² als w nehmen
-
-
-			//don't save points with nan-entries (no data available)
-			if(!std::isnan(pointcloud->at(xIter[iX],yIter[iY]).x))
-			{
-
-				if(first)
-				{
-					//origin of local coordinate system is the first point with valid data. Express coordinates relatively:
-					x0 = pointcloud->at(xIter[iX],yIter[iY]).x;		//x0 = pointcloud->at(xIter.pos().x,xIter.pos().y).x;
-					y0 = pointcloud->at(xIter[iX],yIter[iY]).y;
-					first = false;
-				}
-				coordinates.at<float>(iCoord,0) = (pointcloud->at(xIter[iX],yIter[iY]).x - x0)
-																			+ (pointcloud->at(xIter[iX],yIter[iY]).y - y0);
-				coordinates.at<float>(iCoord,1) = depth_image.at<float>(yIter[iY], xIter[iX]);	//depth coordinate
-				//coordinates.at<float>(iCoord,2) = 1.0;
-
-
-				//detect steps in depth coordinates
-				if(iCoord != 0 && std::abs(coordinates.at<float>(iCoord,1) - coordinates.at<float>(iCoord-1,1)) > 0.05)
-				{
-					step = true;
-				}
-
-				iCoord++;
-			}
-			iX++;
-			iY++;
-		}
-
-		if(iCoord == 0)
-			//no valid data
-			n = cv::Mat::zeros(1,2,CV_32FC1);
-		else if (iCoord == 1)
-		{
-			//coordinates already is its eigenvector
-			n = coordinates;
-		}
-		else
-		{
-			//std::cout << "iCoord: " <<iCoord << "\n";
-			if(iCoord<lineLength)
-			{
-				coordinates.resize(iCoord);
-			}
-
-
-			//PCA
-			pca(coordinates, // pass the data
-					cv::Mat(), // there is no pre-computed mean vector,
-					// so let the PCA engine to compute it
-					CV_PCA_DATA_AS_ROW, // input samples are stored as matrix rows
-					1 // retain only the first principal component (the eigenvector to the largest eigenvalue of the covariance matrix)
-			);
-			n = pca.eigenvectors.row(0); 	//eigenvector to largest eigenvalue
-
-			//directional vector should point from dotIni to dotEnd
-			if(coordinates.at<float>(1,0) < 0)
-				n *= -1;
-
-		}
-
-	 */
-	/*}
-		timer.stop();
-		std::cout << timer.getElapsedTimeInMilliSec() /10000<< " ms for setting up coordinates-matrix + PCA (averaged over 10000 iterations)\n";*/
-
-	//std::cout << "eigenvectors:\n"<< pca.eigenvectors <<"\n";
-}
-
-//-----------------------------------------------------------------------------------------------------------------------------
-//-----------------------------------------------------------------------------------------------------------------------------
-
-
-
-
-
-template <typename PointInT> void
-EdgeDetection<PointInT>::approximateLine
-(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& abc)
-{
-
-	//step-detection in den Koordinaten hier nicht mehr nötig, da durch Vergleichen der zwei Geraden für jede Seite schon auffällt, ob man auf Kante oder direkt daneben ist (?)
-
-	/*Timer timer;
-	timer.start();
-			for(int itim=0;itim<10000;itim++)
-			{*/
-
-	/* approximate depth coordinates between dotIni and dotEnd as a line */
-	/* linear approximation using only the two points
-	 * line equation: a*w + b*z + c =  0  (w refers to coordinate on the line between dotIni and dotEnd, z to depth coordinate) */
-	/* -------------------------------------------------------------------------------------------------------------------------*/
-
-	abc.at<float>(1) = 1;		//b=1
-	float z1 = depth_image.at<float>(dotIni.y, dotIni.x);
-	float z2 = depth_image.at<float>(dotEnd.y, dotEnd.x);
-
-
-	// c = -z1
-	abc.at<float>(2) = -z1;
-
-	float w2;
-
-	//don't save points with nan-entries (no data available)
-	if(std::isnan(pointcloud->at(dotIni.x,dotIni.y).z))
-	{
-		//mark as nan if dot at center is nan
-		abc.at<float>(0) =abc.at<float>(1) =abc.at<float>(2)   = std::numeric_limits<float>::quiet_NaN();
-
-	}
-	else if(std::isnan(pointcloud->at(dotEnd.x,dotEnd.y).z))
-	{
-		//mark as "no decision possible"
-		abc = cv::Mat::zeros(1,3,CV_32FC1);
-	}
-	else
-	{
-		float x0 = pointcloud->at(dotIni.x,dotIni.y).x;
-		float y0 = pointcloud->at(dotIni.x,dotIni.y).y;
-		//dotIni and dotEnd lie on line in either x- or y-direction
-		w2 = (pointcloud->at(dotEnd.x,dotEnd.y).x - x0) + (pointcloud->at(dotEnd.x,dotEnd.y).y - y0);
-		if(w2 != 0)
-		{
-			// a = -(z2-z1) /(w2-w1);
-			abc.at<float>(0) = (z1-z2) /w2;
-		}
-		else
-		{
-			std::cout << "dotIni and dotEnd are the same!\n";
-			abc = cv::Mat::zeros(1,3,CV_32FC1);
-		}
-	}
-	/*}
-			timer.stop();
-			std::cout << timer.getElapsedTimeInMilliSec() /10000<< " ms for approximating one line using 2 points  (averaged over 10000 iterations)\n";*/
-
-}
-
-//-----------------------------------------------------------------------------------------------------------------------------
-//-----------------------------------------------------------------------------------------------------------------------------
-
-
-
-
-template <typename PointInT> void
-EdgeDetection<PointInT>::scalarProduct(cv::Mat& abc1,cv::Mat& abc2,float& scalarProduct, int& concaveConvex, bool& step)
-{
-	/*Timer timer;
-	timer.start();
-	for(int itim=0;itim<10000;itim++)
-	{*/
-
-
-	//std::cout << "scalarProduct()\n";
-
-	//detect steps
-	//------------------------------------------------------------
-
-	//compute z-value at w =0
-	//compare value on left side of w=0 to value on right side
-	// P[0, -c/b]
-	float zLeft = -abc1.at<float>(2)/abc1.at<float>(1);
-	float zRight = -abc2.at<float>(2)/abc2.at<float>(1);
-
-	//there truly is a step at the central point only if there is none in the coordinates to its left and right
-	if(!step && ((zRight - zLeft) > stepThreshold_ || (zRight - zLeft) < -stepThreshold_))
-	{
-		//mark step as edge in depth data
-		scalarProduct = 0;
-	}
-
-	else
-	{
-		//if depth data is continuous: compute scalar product
-		//--------------------------------------------------------
-
-		//normal vector n=[1,(-c-a)/b]
-		float b1 = -(abc1.at<float>(0) + abc1.at<float>(2))/abc1.at<float>(1);
-		float b2 = -(abc2.at<float>(0) + abc2.at<float>(2))/abc2.at<float>(1);
-
-
-		//Richtungsvektoren der Geraden:
-		cv::Mat n1 = (cv::Mat_<float>(1,2) << 1, b1);
-		cv::Mat n2 = (cv::Mat_<float>(1,2) << 1, b2);
-
-		cv::Mat n1Norm, n2Norm;
-		cv::normalize(n1,n1Norm,1);
-		cv::normalize(n2,n2Norm,1);
-
-		//Skalarprodukt liegt zwischen 0 und 1
-		scalarProduct = n1Norm.at<float>(0) * n2Norm.at<float>(0) + n1Norm.at<float>(1) * n2Norm.at<float>(1);
-
-		/*
-			//recognize inner EDGES (not surfaces) as concave or convex
-			//convex: gradient of right line is larger than gradient of left line
-			//concave: gradient of right line is smaller than gradient of left line
-			setOffsetConcConv(0.35);
-			if(b2 > (b1 + offsetConcConv_))
-				//convex
-				concaveConvex = 255;
-			else if (b1 > b2 + offsetConcConv_)
-				//concave
-				concaveConvex = 125;
-		 */
-
-	}
-
-	/*}
-	timer.stop();
-	std::cout << timer.getElapsedTimeInMilliSec() /10000<< " ms for scalarProduct out of abc1 and abc2 (function scalarProduct()) (averaged over 10000 iterations)\n";*/
-}
-
-
-//-----------------------------------------------------------------------------------------------------------------------------
-//-----------------------------------------------------------------------------------------------------------------------------
-
-
-template <typename PointInT> void
-EdgeDetection<PointInT>::approximateLineFullAndHalfDist
-(cv::Mat& depth_image, PointCloudInPtr pointcloud, cv::Point2f dotIni, cv::Point2f dotEnd, cv::Mat& abc)
-{
-	/*cv::Point2f dot1 = dotIni;
-	cv::Point2f dot2 = dotEnd;
-
-
-	Timer timer;
-	timer.start();
-			for(int itim=0;itim<10000;itim++)
-			{
-				dotIni=dot1;
-				dotEnd = dot2;*/
-
-	//check if lines to dotEnd and dotEnd/2 go in the same direction. Only then dotIni is on an edge, else it is next to one or there is an outlier in the data.
-
-	cv::Mat abc1 (cv::Mat::zeros(1,3,CV_32FC1));	//first approximation, full distance from dotIni to dotEnd
-	cv::Mat abc2 (cv::Mat::zeros(1,3,CV_32FC1));	//second approximation, half distance from dotIni to dotEnd
-	approximateLine(depth_image,pointcloud, dotIni,dotEnd, abc1);
-
-
-	if(dotEnd.x == dotIni.x)
-		//half distance in y-direction
-		dotEnd.y = (int) (dotEnd.y - (dotEnd.y-dotIni.y)/2);
-	else if(dotEnd.y == dotEnd.y)
-		//half distance in x-direction
-		dotEnd.x = (int) (dotEnd.x - (dotEnd.x-dotIni.x)/2);
-
-
-
-	approximateLine(depth_image,pointcloud, dotIni,dotEnd, abc2);
-
-	float scalProd = 1;
-	int sinnlos2 = 0; //sinnlos, evtl noch neue Funktion scalarProduct() ohne concConv schreiben
-
-
-	//propagate information from both lines
-	if(std::isnan(abc1.at<float>(0,0)) || std::isnan(abc2.at<float>(0,0)))
-	{
-		abc.at<float>(0) =abc.at<float>(1) =abc.at<float>(2)   = std::numeric_limits<float>::quiet_NaN();
-	}
-	else if(abc1.at<float>(0) == 0 && abc1.at<float>(1) == 0)
-	{
-		//falls nan bei full distance, die Werte von halfDist übernehmen
-		abc = abc2;
-	}
-	else if(abc2.at<float>(0) == 0 && abc2.at<float>(1) == 0)
-	{
-		//falls nan bei half dist, die Werte bei fulldist übernehmen
-		abc = abc1;
-	}
-	else
+	double m[6] = {0, 0, 0, 0, 0, 0};
+	for(int i=0; i<count; i++)
 	{
-		/*bool sinnlos = false;	//noch neue Funktion scalarProduct ohne bool step schreiben
-		scalarProduct(abc1,abc2,scalProd,sinnlos2,sinnlos);
-		//std::cout <<"scalProd: " <<scalProd <<endl;
-		if(scalProd > 0.95 || scalProd < -0.95)
-		{
-			//approximations of fulldist and halfdist going in the same direction
-			abc = abc1;
-		}
-		else
-			//lines not going in the same direction -> no edge
-			abc = cv::Mat::zeros(1,3,CV_32FC1);*/
-
-		//compare the gradients of the lines:
-		if(std::abs(abc2.at<float>(0)) - std::abs(abc1.at<float>(0)) < 0.01)
-			abc = abc1;
-		else
-			//just beside an edge -> do not mark as edge
-			abc = cv::Mat::zeros(1,3,CV_32FC1);
-
-
-
+		m[0] += w[i]*w[i];
+		m[1] += w[i]*z[i];
+		m[2] += w[i];
+		m[3] += z[i]*z[i];
+		m[4] += z[i];
 	}
-
-	/*}
-	timer.stop();
-	std::cout << timer.getElapsedTimeInMilliSec() /10000<< " ms for approximating lines using two points, half and full distance. comparison of gradients instead of computing scalarProduct (averaged over 10000 iterations)\n";
-	 */
+	m[5] = count;
+	smallestEigenvector(m, abc);
 }
 
 //-----------------------------------------------------------------------------------------------------------------------------
@@ -709,18 +339,23 @@ EdgeDetection<PointInT>::drawLineAlongN(cv::Mat& plotZW, cv::Mat& coordinates, c
 
 template <typename PointInT> void
 EdgeDetection<PointInT>::deriv2nd3pts
-(cv::Mat points, float& deriv)
+(const float* z, int count, float& deriv)
 {
-	//std::cout << "points: " <<points <<endl;
-
 	//use stencil of width 3
 	//f(x)'' = (f(x+dx) + f(x-dx) - 2* f(x))/ dx²
 
 	//leave away denominator, because only magnitude is important
-	//float dx = (points.at<float>(points.rows-1,0) - points.at<float>(0,0))/2;
+	//float dx = (w[count-1] - w[0])/2;
+
+	if(count == 0)
+	{
+		//no valid data
+		deriv = 0;
+		return;
+	}
 
-	//take first and last entry of matrix (most distant points)
-	deriv = (points.at<float>(points.rows-1,1) + points.at<float>(0,1) - 2* points.at<float>((int)points.rows/2,1));	/// (dx * dx);
+	//take first and last point (most distant points)
+	deriv = (z[count-1] + z[0] - 2* z[count/2]);	/// (dx * dx);
 }
 
 //--------------------------------------------------------------------------------------------------------------------------
@@ -744,12 +379,11 @@ EdgeDetection<PointInT>::deriv2nd5pts
 
 template <typename PointInT> void
 EdgeDetection<PointInT>::deriv2nd
-(cv::Mat depth_image,PointCloudInPtr cloud, cv::Point2f dotStart, cv::Point2f dotStop, float& deriv)
+(const CloudView& cloud, cv::Point2f dotStart, cv::Point2f dotStop, float* w, float* z, float& deriv)
 {
-	cv::Mat coordinates;
-	bool step; //sinnlos
-	coordinatesMat(depth_image, cloud, dotStart, dotStop, coordinates, step);
-	deriv2nd3pts(coordinates,deriv);
+	bool step = false; //sinnlos
+	int count = coordinatesLine(cloud, dotStart, dotStop, w, z, step);
+	deriv2nd3pts(z, count, deriv);
 }
 
 
@@ -758,256 +392,466 @@ EdgeDetection<PointInT>::deriv2nd
 //-----------------------------------------------------------------------------------------------------------------------------
 
 template <typename PointInT> void
-EdgeDetection<PointInT>::computeDepthEdges
-(cv::Mat depth_image, PointCloudInPtr pointcloud, cv::Mat& edgeImage)
+EdgeDetection<PointInT>::computeLineSums
+(const CloudView& cloud, int row, LineSums& sums)
 {
+	/* running sums over the valid points of one row
+	 * a line fit between two columns then only needs the difference of two entries of each sum
+	 * ----------------------------------------------------------------------------------------*/
+
+	int cols = cloud.width;
+	sums.count.resize(cols+1);
+	sums.s.resize(cols+1);
+	sums.z.resize(cols+1);
+	sums.ss.resize(cols+1);
+	sums.sz.resize(cols+1);
+	sums.zz.resize(cols+1);
+	sums.steps.resize(cols+1);
+	sums.firstValid.resize(cols);
+	sums.lastValid.resize(cols);
+	sums.position.resize(cols);
+
+	sums.count[0] = 0;
+	sums.s[0] = sums.z[0] = sums.ss[0] = sums.sz[0] = sums.zz[0] = 0;
+	sums.steps[0] = 0;
+
+	const unsigned char* valid = cloud.valid.ptr(row);
+	int lastValid = -1;
+	float lastZ = 0;
+	for(int iX = 0; iX < cols; iX++)
+	{
+		const PointInT& point = cloud.at(iX,row);
+		sums.count[iX+1] = sums.count[iX];
+		sums.s[iX+1] = sums.s[iX];
+		sums.z[iX+1] = sums.z[iX];
+		sums.ss[iX+1] = sums.ss[iX];
+		sums.sz[iX+1] = sums.sz[iX];
+		sums.zz[iX+1] = sums.zz[iX];
+		sums.steps[iX+1] = sums.steps[iX];
+		sums.position[iX] = 0;
+
+		//don't sum up points with nan-entries (no data available)
+		if(valid[iX])
+		{
+			double s = (double)point.x + point.y;
+			double z = point.z;
+			sums.count[iX+1]++;
+			sums.s[iX+1] += s;
+			sums.z[iX+1] += z;
+			sums.ss[iX+1] += s*s;
+			sums.sz[iX+1] += s*z;
+			sums.zz[iX+1] += z*z;
+			sums.position[iX] = s;
+
+			//detect steps in depth coordinates (same threshold as in coordinatesLine())
+			if(lastValid >= 0 && std::abs(point.z - lastZ) > 0.05)
+				sums.steps[iX+1]++;
+			lastValid = iX;
+			lastZ = point.z;
+		}
+		sums.lastValid[iX] = lastValid;
+	}
 
-	bool decide_curv = DECIDE_CURV;
-
-	/*Timer timerFunc;
-		timerFunc.start();*/
-
-	//plot z over w, draw estimated lines
-	cv::Mat plotZW (cv::Mat::zeros(windowX_,windowY_,CV_32FC1));
-	//cv::Mat scalarProducts (cv::Mat::ones(depth_image.rows,depth_image.cols,CV_32FC1));
-
-	//kann gelöscht werden, wenn nach Klassifizierung verschoben
-	cv::Mat concaveConvex (cv::Mat::zeros(depth_image.rows,depth_image.cols,CV_8UC1)); 	//0:neither concave nor convex; 125:concave; 255:convex
-	cv::Mat concaveConvexY (cv::Mat::zeros(depth_image.rows,depth_image.cols,CV_8UC1)); 	//0:neither concave nor convex; 125:concave; 255:convex
+	int firstValid = cols;
+	for(int iX = cols-1; iX >= 0; iX--)
+	{
+		if(sums.lastValid[iX] == iX)
+			firstValid = iX;
+		sums.firstValid[iX] = firstValid;
+	}
+}
 
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
-	cv::Mat scalarProductsY (cv::Mat::ones(depth_image.rows,depth_image.cols,CV_32FC1));
-	cv::Mat scalarProductsX (cv::Mat::ones(depth_image.rows,depth_image.cols,CV_32FC1));
+template <typename PointInT> void
+EdgeDetection<PointInT>::approximateLine
+(const LineSums& sums, int first, int last, bool originAtLast, float* abc, bool& step)
+{
+	/* approximate the depth coordinates of the row between the columns first and last as a line a*w+b*z+c = 0,
+	 * like approximateLine() does for the coordinates of the line:
+	 * abc is the eigenvector to the smallest eigenvalue of coordinates^T * coordinates, which is set up from the running sums.
+	 * origin of w is the first valid point seen from the central point (the column last if originAtLast, else first)
+	 * --------------------------------------------------------------------------------------------------------------------*/
 
-	int iX=depth_image.cols/2;
-	int iY=depth_image.rows/2;
+	abc[0] = abc[1] = abc[2] = 0;
 
+	int count = sums.count[last+1] - sums.count[first];
+	if(count == 0)
+		//no valid data
+		return;
+
+	//steps between consecutive valid points of the line (the step to the first valid point comes from outside the line)
+	int firstPoint = sums.firstValid[first];
+	if(sums.steps[last+1] - sums.steps[firstPoint+1] > 0)
+		step = true;
+
+	//at least three points needed, like in approximateLine()
+	if(count < 3)
+		return;
+
+	double s0 = sums.position[originAtLast ? sums.lastValid[last] : firstPoint];
+	double sumS = sums.s[last+1] - sums.s[first];
+	double sumZ = sums.z[last+1] - sums.z[first];
+	double sumSS = sums.ss[last+1] - sums.ss[first];
+	double sumSZ = sums.sz[last+1] - sums.sz[first];
+	double sumZZ = sums.zz[last+1] - sums.zz[first];
+
+	//coordinates^T * coordinates with w = s-s0
+	double m[6];
+	m[0] = sumSS - 2*s0*sumS + count*s0*s0;	//sum w²
+	m[1] = sumSZ - s0*sumZ;					//sum wz
+	m[2] = sumS - count*s0;					//sum w
+	m[3] = sumZZ;							//sum z²
+	m[4] = sumZ;							//sum z
+	m[5] = count;
+	smallestEigenvector(m, abc);
+}
 
-	Timer timer;
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
+template <typename PointInT> void
+EdgeDetection<PointInT>::smallestEigenvector(const double* m, float* v)
+{
+	/* eigenvector to the smallest eigenvalue of the symmetric 3x3 matrix
+	 * [m0 m1 m2; m1 m3 m4; m2 m4 m5]
+	 * eigenvalue in closed form (trigonometric solution of the characteristic polynomial),
+	 * eigenvector as the largest cross product of two rows of (matrix - eigenvalue*I)
+	 * --------------------------------------------------------------------------------*/
 
-	//	cout << timerFunc.getElapsedTimeInMilliSec() << " ms for initial definitions before loop\n";
+	double q = (m[0] + m[3] + m[5]) / 3;
+	double d0 = m[0] - q;
+	double d1 = m[3] - q;
+	double d2 = m[5] - q;
+	double offDiagonal = m[1]*m[1] + m[2]*m[2] + m[4]*m[4];
+	double p = std::sqrt((d0*d0 + d1*d1 + d2*d2 + 2*offDiagonal) / 6);
 
+	double lambda = q;
+	if(p > 0)
+	{
+		//r = det((matrix - q*I)/p) / 2
+		double r = (d0*(d1*d2 - m[4]*m[4]) - m[1]*(m[1]*d2 - m[4]*m[2]) + m[2]*(m[1]*m[4] - d1*m[2])) / (2*p*p*p);
+		r = std::max(-1.0, std::min(1.0, r));
+		lambda = q + 2*p*std::cos(std::acos(r)/3 + 2*CV_PI/3);
+	}
 
+	double r0[3] = {m[0]-lambda, m[1], m[2]};
+	double r1[3] = {m[1], m[3]-lambda, m[4]};
+	double r2[3] = {m[2], m[4], m[5]-lambda};
+	double* rows[3][2] = {{r0, r1}, {r0, r2}, {r1, r2}};
 
-	//loop over rows
-	for(int iY = lineLength_/2; iY< depth_image.rows-lineLength_/2; iY++)
+	double best[3] = {0, 0, 0};
+	double bestNorm = 0;
+	for(int i=0; i<3; i++)
 	{
-		//loop over columns
-		for(int iX = lineLength_/2; iX< depth_image.cols-lineLength_/2; iX++)
+		const double* a = rows[i][0];
+		const double* b = rows[i][1];
+		double c[3] = {a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0]};
+		double norm = c[0]*c[0] + c[1]*c[1] + c[2]*c[2];
+		if(norm > bestNorm)
 		{
+			bestNorm = norm;
+			best[0] = c[0];
+			best[1] = c[1];
+			best[2] = c[2];
+		}
+	}
 
+	if(bestNorm > 0)
+	{
+		bestNorm = std::sqrt(bestNorm);
+		for(int i=0; i<3; i++)
+			v[i] = best[i] / bestNorm;
+	}
+	else
+	{
+		//smallest eigenvalue is not unique (rank of matrix - eigenvalue*I < 2)
+		cv::Matx33d matrix(m[0], m[1], m[2], m[1], m[3], m[4], m[2], m[4], m[5]);
+		cv::Matx31d eigenvalues;
+		cv::Matx33d eigenvectors;
+		cv::eigen(matrix, eigenvalues, eigenvectors);
+		for(int i=0; i<3; i++)
+			v[i] = eigenvectors(2,i);
+	}
+}
 
-			//scalarProduct of depth along lines in x-direction
-			//------------------------------------------------------------------------
-			cv::Point2f dotLeft(iX -lineLength_/2, iY);
-			cv::Point2f dotRight(iX +lineLength_/2, iY);
-			cv::Mat coordinates1;	//coordinates on the left side of the center point
-			cv::Mat coordinates2;	//coordinates on the right
-			cv::Mat abc1 (cv::Mat::zeros(1,3,CV_32FC1));	//line parameters a,b,c of line a*w+b*z+1=0, left line
-			cv::Mat abc2 (cv::Mat::zeros(1,3,CV_32FC1));	//right line
-			cv::Mat n1;
-			cv::Mat n2;
-			bool step = false;
-
-
-
-			// line approximation using SVD
-			// ----------------------------------------------------------
-
-
-			//boolean step will be set to true in approximateLine(), if there is a step either in coordinates1 or coordinates2
-			//-> needs to be set to false before calling approximateLine() for both sides.
-			//in scalarProduct(), boolean step will be considered when detecting a step at the central point.
-			//if there is a step at the central point, the coordinates on the right and left to it should be continuous without step!
-			//(else the step would be detected in the neighbourhood as well, leading to inaccuracies)
-
-			step = false;
-
-			//do not use point right at the center (would belong to both lines -> steps not correctly represented)
-			approximateLine(depth_image,pointcloud, cv::Point2f(iX-1,iY),dotLeft, abc1,n1, coordinates1, step);
-
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
-			//n1 wird nur gebraucht, falls PCA anstatt SVD
+template <typename PointInT> void
+EdgeDetection<PointInT>::approximateLine
+(const CloudView& cloud, cv::Point2f dotIni, cv::Point2f dotEnd, float* abc)
+{
+	/* approximate depth coordinates between dotIni and dotEnd as a line */
+	/* linear approximation using only the two points
+	 * line equation: a*w + b*z + c =  0  (w refers to coordinate on the line between dotIni and dotEnd, z to depth coordinate) */
+	/* -------------------------------------------------------------------------------------------------------------------------*/
 
-			//	timer.stop();
-			//	std::cout << timer.getElapsedTimeInMilliSec() /10000 << " ms for lineApproximation (averaged over 10000 iterations)\n";
+	const PointInT& pointIni = cloud.at(dotIni.x,dotIni.y);
+	const PointInT& pointEnd = cloud.at(dotEnd.x,dotEnd.y);
+	float z1 = pointIni.z;
+	float z2 = pointEnd.z;
+	abc[0] = 0;
+	abc[1] = 1;		//b=1
+	abc[2] = -z1;	//c = -z1
 
+	if(!cloud.isValid(dotIni.x,dotIni.y))
+	{
+		//mark as nan if dot at center is nan
+		abc[0] = abc[1] = abc[2] = std::numeric_limits<float>::quiet_NaN();
+	}
+	else if(!cloud.isValid(dotEnd.x,dotEnd.y))
+	{
+		//mark as "no decision possible"
+		abc[0] = abc[1] = abc[2] = 0;
+	}
+	else
+	{
+		float w2 = (pointEnd.x - pointIni.x) + (pointEnd.y - pointIni.y);
+		if(w2 != 0)
+			abc[0] = (z1-z2) /w2;
+		else
+			//dotIni and dotEnd are the same
+			abc[0] = abc[1] = abc[2] = 0;
+	}
+}
 
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
-			//besser den Pixel rechts bzw.links von dotMiddle betrachten, damit dotMiddle nicht zu beiden Seiten dazu gerechnet wird (sonst ungenau bei Sprung)
-			approximateLine(depth_image,pointcloud, cv::Point2f(iX+1,iY),dotRight, abc2,n2, coordinates2,step);
+template <typename PointInT> void
+EdgeDetection<PointInT>::approximateLineFullAndHalfDist
+(const CloudView& cloud, cv::Point2f dotIni, cv::Point2f dotEnd, float* abc)
+{
+	//check if lines to dotEnd and dotEnd/2 go in the same direction. Only then dotIni is on an edge, else it is next to one or there is an outlier in the data.
 
-			/*
-			//	approximate line using only two points
-			// -------------------------------------------------------------------
+	float abc1[3];	//first approximation, full distance from dotIni to dotEnd
+	float abc2[3];	//second approximation, half distance from dotIni to dotEnd
+	approximateLine(cloud, dotIni,dotEnd, abc1);
 
-			//no step detection in approximateLine from 2 points
-			step = false;
+	if(dotEnd.x == dotIni.x)
+		//half distance in y-direction
+		dotEnd.y = (int) (dotEnd.y - (dotEnd.y-dotIni.y)/2);
+	else
+		//half distance in x-direction
+		dotEnd.x = (int) (dotEnd.x - (dotEnd.x-dotIni.x)/2);
 
-			//std::cout << "left\n";
-			approximateLineFullAndHalfDist(depth_image,pointcloud, cv::Point2f(iX-1,iY),dotLeft, abc1);
-			//std::cout << "right\n";
-			approximateLineFullAndHalfDist(depth_image,pointcloud, cv::Point2f(iX+1,iY),dotRight, abc2);
+	approximateLine(cloud, dotIni,dotEnd, abc2);
 
+	//propagate information from both lines
+	const float* result = abc1;
+	if(std::isnan(abc1[0]) || std::isnan(abc2[0]))
+	{
+		abc[0] = abc[1] = abc[2] = std::numeric_limits<float>::quiet_NaN();
+		return;
+	}
+	else if(abc1[0] == 0 && abc1[1] == 0)
+		//falls nan bei full distance, die Werte von halfDist übernehmen
+		result = abc2;
+	else if(abc2[0] == 0 && abc2[1] == 0)
+		//falls nan bei half dist, die Werte bei fulldist übernehmen
+		result = abc1;
+	else if(std::abs(abc2[0]) - std::abs(abc1[0]) >= 0.01)
+	{
+		//just beside an edge -> do not mark as edge
+		abc[0] = abc[1] = abc[2] = 0;
+		return;
+	}
+	abc[0] = result[0];
+	abc[1] = result[1];
+	abc[2] = result[2];
+}
 
-			//std::cout << "abc1 (left):\n " << abc1 << "\n";
-			//std::cout << "abc2 (right):\n " << abc2 << "\n";
-			 */
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
-			/* -------------------------------------------------------------------*/
+template <typename PointInT> float
+EdgeDetection<PointInT>::scalarProduct(const float* abc1, const float* abc2, bool step)
+{
+	/* magnitude of the scalar product of the two lines with the decisions of computeDepthEdges():
+	 * 1 if a line could not be approximated, 0 if nan at the center point or a step at the center point
+	 * ------------------------------------------------------------------------------------------------*/
+
+	if(abc1[2] == 0 || abc2[2] == 0)
+		return 1;
+	if(std::isnan(abc1[0]) || std::isnan(abc2[0]))
+		return 0;
+
+	//z-value at w = 0, there truly is a step at the central point only if there is none in the coordinates to its left and right
+	float zLeft = -abc1[2]/abc1[1];
+	float zRight = -abc2[2]/abc2[1];
+	if(!step && std::abs(zRight - zLeft) > stepThreshold_)
+		return 0;
+
+	//directional vectors [1,(-c-a)/b] of the lines
+	float b1 = -(abc1[0] + abc1[2])/abc1[1];
+	float b2 = -(abc2[0] + abc2[2])/abc2[1];
+	return std::abs((1 + b1*b2) / (std::sqrt(1 + b1*b1) * std::sqrt(1 + b2*b2)));
+}
 
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
+template <typename PointInT> void
+EdgeDetection<PointInT>::computeDepthEdgesBand
+(const CloudView& cloud, cv::Mat& scalarProductsX, cv::Mat& scalarProductsY, cv::Mat& concaveConvex, int rowStart, int rowEnd)
+{
+	//scalar products of the rows rowStart..rowEnd-1, writes only to these rows of the output images
 
-			//drawLines(plotZW,coordinates1,abc1);
-			//drawLines(plotZW,coordinates2,abc2);
+	bool decide_curv = DECIDE_CURV;
+	int curvLength = 10; //entspricht stencil-Länge -1 . Muss kleiner sein als lineLength_
+	int halfLength = lineLength_/2;
 
-			//drawLineAlongN(plotZW,coordinates1,n1);
-			//drawLineAlongN(plotZW,coordinates2,n2);
+	//coordinates of one line and running sums of one row, allocated once for the whole band
+	std::vector<float> w(std::max(halfLength, 2*curvLength) + 1);
+	std::vector<float> z(w.size());
+	LineSums sums;
 
+	//loop over rows
+	for(int iY = rowStart; iY< rowEnd; iY++)
+	{
+		if(integralLineFit_)
+			computeLineSums(cloud, iY, sums);
+		float* scalProdX = scalarProductsX.ptr<float>(iY);
+		float* scalProdY = scalarProductsY.ptr<float>(iY);
 
-			float scalProdX = 1;
-			int concConv = 0;
+		//loop over columns
+		for(int iX = halfLength; iX< cloud.width-halfLength; iX++)
+		{
+			//scalarProduct of depth along lines in x-direction
+			//------------------------------------------------------------------------
+			float abc1[3];	//line parameters a,b,c of line a*w+b*z+c=0, left line
+			float abc2[3];	//right line
 
+			//boolean step will be set to true in coordinatesLine(), if there is a step either in the coordinates of the left or the right line
+			//-> needs to be set to false before approximating the lines for both sides.
+			//in scalarProduct(), boolean step will be considered when detecting a step at the central point.
+			//if there is a step at the central point, the coordinates on the right and left to it should be continuous without step!
+			//(else the step would be detected in the neighbourhood as well, leading to inaccuracies)
+			bool step = false;
 
-			if(abc1.at<float>(0,2) == 0 || abc2.at<float>(0,2) == 0)
-			{
-				//abc could not be approximated or no edge (see approximateLineFullAndHalfDist())
-				scalProdX = 1;
-			}
-			else if (std::isnan(abc1.at<float>(0,0)) || std::isnan(abc2.at<float>(0,0)) )
+			//do not use point right at the center (would belong to both lines -> steps not correctly represented)
+			if(integralLineFit_)
 			{
-				//if nan at center point, mark as edge
-				scalProdX = 0;
+				approximateLine(sums, iX-halfLength, iX-1, true, abc1, step);
+				approximateLine(sums, iX+1, iX+halfLength, false, abc2, step);
 			}
 			else
 			{
-				scalarProduct(abc1,abc2,scalProdX,concConv,step);
+				int count = coordinatesLine(cloud, cv::Point2f(iX-1,iY), cv::Point2f(iX-halfLength,iY), &w[0], &z[0], step);
+				approximateLine(&w[0], &z[0], count, abc1);
+				count = coordinatesLine(cloud, cv::Point2f(iX+1,iY), cv::Point2f(iX+halfLength,iY), &w[0], &z[0], step);
+				approximateLine(&w[0], &z[0], count, abc2);
 			}
 
-			//std::cout << "concave 125 grau, konvex 255 weiß, unbestimmt 0 schwarz: " <<concConv << "\n";
-
-			//compute magnitude of scalar product (sign only depends on which angle between the lines was considered)
-			if(scalProdX < 0)
-				scalProdX = scalProdX * (-1);
-			scalarProductsX.at<float>(iY,iX) = scalProdX;
+			//magnitude of scalar product (sign only depends on which angle between the lines was considered)
+			scalProdX[iX] = scalarProduct(abc1, abc2, step);
 
 
 			if(decide_curv)
 			{
-				int length = 10; //entspricht stencil-Länge -1 . Muss kleiner sein als lineLength_
-				cv::Point2f dotStart(iX - length, iY);
-				cv::Point2f dotStop(iX + length, iY);
+				cv::Point2f dotStart(iX - curvLength, iY);
+				cv::Point2f dotStop(iX + curvLength, iY);
 				float deriv = 0;
-				deriv2nd(depth_image,pointcloud,dotStart, dotStop,deriv);
+				deriv2nd(cloud, dotStart, dotStop, &w[0], &z[0], deriv);
 
 				float curv_threshold = 0;//0.003;
+				int concConv = 0;
 				if(deriv < -curv_threshold)
 					concConv = 125;
 				else if(deriv > curv_threshold)
 					concConv = 255;
-				else
-					concConv = 0;
 
 				concaveConvex.at<unsigned char>(iY,iX) = concConv;
 			}
 
 
-
 			//scalarProduct of depth along lines in y-direction
+			//approximate lines using only two points, no step detection
 			//------------------------------------------------------------------------
-			cv::Point2f dotDown(iX , iY-lineLength_/2);
-			cv::Point2f dotUp(iX , iY+lineLength_/2);
-			cv::Point2f dotMiddle(iX , iY );
-			cv::Mat coordinates1Y = cv::Mat::zeros(1,3,CV_32FC1);
-			cv::Mat coordinates2Y = cv::Mat::zeros(1,3,CV_32FC1);
-			cv::Mat n1Y;
-			cv::Mat n2Y;
-
-			cv::Mat abc1Y (cv::Mat::zeros(1,3,CV_32FC1));
-			cv::Mat abc2Y (cv::Mat::zeros(1,3,CV_32FC1));
-
-			//timer.start();
-
-			/* approximate lines using SVD
-			 * -----------------------------------------------------------*/
-			/*
-	step = false;
-
-	//do not use point right at the center (would belong to both lines -> steps not correctly represented)
-	approximateLine(depth_image,pointcloud, cv::Point2f(iX,iY-1),dotDown, abc1Y, n1Y,coordinates1Y, step);
-
-	//timer.stop();
-	//cout << timer.getElapsedTimeInMilliSec() << " ms for lineApproximation\n";
-
-
-
-	//besser den Pixel rechts bzw.links von dotMiddle betrachten, damit dotMiddle nicht zu beiden Seiten dazu gerechnet wird (sonst ungenau bei Sprung)
-	approximateLine(depth_image,pointcloud, cv::Point2f(iX,iY+1),dotUp, abc2Y,n2Y, coordinates2Y,step);
-			 */
-
+			approximateLineFullAndHalfDist(cloud, cv::Point2f(iX,iY-1), cv::Point2f(iX,iY-halfLength), abc1);
+			approximateLineFullAndHalfDist(cloud, cv::Point2f(iX,iY+1), cv::Point2f(iX,iY+halfLength), abc2);
+			scalProdY[iX] = scalarProduct(abc1, abc2, false);
+		}
+	}	//loop over image
+}
 
-			//std::cout << "step: " << step << "\n";
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
+template <typename PointInT> void
+EdgeDetection<PointInT>::computeDepthEdges
+(PointCloudInPtr pointcloud, cv::Mat& edgeImage)
+{
+	cv::Mat scalarProductsX, scalarProductsY;
+	computeDepthEdges(pointcloud, edgeImage, scalarProductsX, scalarProductsY);
+}
 
-			/*	approximate line using only two points
-			 * -------------------------------------------------------------------*/
+//-----------------------------------------------------------------------------------------------------------------------------
+//-----------------------------------------------------------------------------------------------------------------------------
 
-			//no step detection in approximateLine from 2 points
-			step = false;
+template <typename PointInT> void
+EdgeDetection<PointInT>::computeDepthEdges
+(PointCloudInPtr pointcloud, cv::Mat& edgeImage, cv::Mat& scalarProductsX, cv::Mat& scalarProductsY)
+{
 
-			approximateLineFullAndHalfDist(depth_image,pointcloud, cv::Point2f(iX,iY-1),dotDown, abc1Y);
-			approximateLineFullAndHalfDist(depth_image,pointcloud, cv::Point2f(iX,iY+1),dotUp, abc2Y);
+	bool decide_curv = DECIDE_CURV;
 
+	//coordinates are read from the points in place, points without data are marked once per frame
+	CloudView cloud(*pointcloud);
 
+	/*Timer timerFunc;
+		timerFunc.start();*/
 
-			/* -------------------------------------------------------------------*/
+	//plot z over w, draw estimated lines
+	cv::Mat plotZW (cv::Mat::zeros(windowX_,windowY_,CV_32FC1));
+	//cv::Mat scalarProducts (cv::Mat::ones(cloud.height,cloud.width,CV_32FC1));
 
-			//drawLines(plotZW,coordinates1Y,abc1Y);
-			//drawLines(plotZW,coordinates2Y,abc2Y);
+	//kann gelöscht werden, wenn nach Klassifizierung verschoben
+	cv::Mat concaveConvex (cv::Mat::zeros(cloud.height,cloud.width,CV_8UC1)); 	//0:neither concave nor convex; 125:concave; 255:convex
+	cv::Mat concaveConvexY (cv::Mat::zeros(cloud.height,cloud.width,CV_8UC1)); 	//0:neither concave nor convex; 125:concave; 255:convex
 
-			float scalProdY = 1;
-			int concConvY = 0;
-			if(abc1Y.at<float>(0,2) == 0 || abc2Y.at<float>(0,2) == 0)
-			{
-				//abc could not be approximated or no edge (see approximateLineFullAndHalfDist())
-				scalProdY = 1;
-			}
-			else if (std::isnan(abc1Y.at<float>(0,0)) || std::isnan(abc2Y.at<float>(0,0)) )
-			{
-				//if nan at center point, mark as edge
-				scalProdY = 0;
-			}
-			else
-			{
-				scalarProduct(abc1Y,abc2Y,scalProdY,concConv,step);
-			}
 
-			//std::cout << "scalarProduct: " <<scalProdX << "\n";
-			//std::cout << "concave 125 grau, konvex 255 weiß: " <<concConv << "\n";
+	scalarProductsY.create(cloud.height,cloud.width,CV_32FC1);
+	scalarProductsY.setTo(1);
+	scalarProductsX.create(cloud.height,cloud.width,CV_32FC1);
+	scalarProductsX.setTo(1);
 
-			//compute magnitude of scalar product (sign only depends on which angle between the lines was considered)
-			if(scalProdY < 0)
-				scalProdY = scalProdY * (-1);
-			scalarProductsY.at<float>(iY,iX) = scalProdY;
 
+	//	cout << timerFunc.getElapsedTimeInMilliSec() << " ms for initial definitions before loop\n";
 
-			//concaveConvexY.at<unsigned char>(iY,iX) = concConvY;
 
 
-			//Minimum:
-			//scalarProducts.at<float>(iY,iX) = (scalProdX < scalProdY)? scalProdX : scalProdY;
+	//process bands of rows in parallel threads. Every pixel of the scalar products only depends on the input point cloud,
+	//so the bands need no overlap and the result is the same as with one thread
+	int rowStart = lineLength_/2;
+	int rowEnd = cloud.height-lineLength_/2;
+	int numberThreads = (numberThreads_ > 0) ? numberThreads_ : std::max(1, (int)boost::thread::hardware_concurrency());
+	numberThreads = std::min(numberThreads, rowEnd-rowStart);
+	if(numberThreads <= 1)
+		computeDepthEdgesBand(cloud, scalarProductsX, scalarProductsY, concaveConvex, rowStart, rowEnd);
+	else
+	{
+		boost::thread_group threads;
+		for(int iThread = 0; iThread < numberThreads; iThread++)
+		{
+			int bandStart = rowStart + (rowEnd-rowStart)*iThread/numberThreads;
+			int bandEnd = rowStart + (rowEnd-rowStart)*(iThread+1)/numberThreads;
+			threads.create_thread(boost::bind(&EdgeDetection<PointInT>::computeDepthEdgesBand, this, boost::cref(cloud),
+					boost::ref(scalarProductsX), boost::ref(scalarProductsY), boost::ref(concaveConvex), bandStart, bandEnd));
 		}
-	}	//loop over image
+		threads.join_all();
+	}
 
 
 	/*	//thin edges in x- and y-direction separately
 	thinEdges(scalarProductsX, 0);
 	thinEdges(scalarProductsY, 1);
 
-	for(int iY = lineLength_/2; iY< depth_image.rows-lineLength_/2; iY++)
+	for(int iY = lineLength_/2; iY< cloud.height-lineLength_/2; iY++)
 	{
-		for(int iX = lineLength_/2; iX< depth_image.cols-lineLength_/2; iX++)
+		for(int iX = lineLength_/2; iX< cloud.width-lineLength_/2; iX++)
 		{
 			//Minimum:
 			edgeImage.at<float>(iY,iX) = std::min(scalarProductsX.at<float>(iY,iX), scalarProductsY.at<float>(iY,iX));
@@ -100,6 +100,8 @@
 
 // boost
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 
 // point cloud
 #include <pcl/point_types.h>
@@ -124,6 +126,64 @@
 
 
 
+// Single-slot queue between two stages of the processing pipeline.
+// A new frame replaces a frame that has not been taken yet (the older one is dropped),
+// so a slow stage sheds load instead of building up a backlog of old frames.
+template <typename T>
+class LatestFrameSlot
+{
+public:
+	LatestFrameSlot()
+	: full_(false), closed_(false)
+	{}
+
+	// returns true if a frame that was not taken yet has been dropped
+	bool put(const T& item)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		bool dropped = full_;
+		item_ = item;
+		full_ = true;
+		condition_.notify_one();
+		return dropped;
+	}
+
+	// waits for the next frame, returns false when the slot has been closed
+	bool take(T& item)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		while (!full_ && !closed_)
+			condition_.wait(lock);
+		if (closed_)
+			return false;
+		item = item_;
+		item_ = T();
+		full_ = false;
+		return true;
+	}
+
+	void close()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		closed_ = true;
+		condition_.notify_all();
+	}
+
+	bool closed()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return closed_;
+	}
+
+private:
+	boost::mutex mutex_;
+	boost::condition_variable condition_;
+	T item_;
+	bool full_;
+	bool closed_;
+};
+
+
 class SurfaceClassificationNode
 {
 public:
@@ -135,6 +195,32 @@ public:
 		it_ = 0;
 		sync_input_ = 0;
 
+		s_.rec_mode = RECORD_MODE;
+		s_.comp_mode = COMPUTATION_MODE;
+		s_.seg = SEG;
+		s_.seg_without_edges = SEG_WITHOUT_EDGES;
+		s_.seg_refine = SEG_REFINE;
+		s_.classify = CLASSIFY;
+		s_.normal_vis = NORMAL_VIS;
+		s_.seg_vis = SEG_VIS;
+		s_.seg_without_edges_vis= SEG_WITHOUT_EDGES_VIS;
+		s_.class_vis = CLASS_VIS;
+
+		//fit the depth lines from running sums, a SVD for every pixel is too slow for live data
+		edge_detection_.setIntegralLineFit(true);
+		//bands of image rows on all cpu cores
+		edge_detection_.setNumberThreads(0);
+
+		//computation mode: every stage runs on its own thread, so frame N is classified while the edges of frame N+1 are computed
+		if(COMPUTATION_MODE)
+		{
+			stages_.create_thread(boost::bind(&SurfaceClassificationNode::edgeStage, this));
+			stages_.create_thread(boost::bind(&SurfaceClassificationNode::normalStage, this));
+			stages_.create_thread(boost::bind(&SurfaceClassificationNode::segmentationStage, this));
+			stages_.create_thread(boost::bind(&SurfaceClassificationNode::classificationStage, this));
+			stages_.create_thread(boost::bind(&SurfaceClassificationNode::visualizationStage, this));
+		}
+
 		it_ = new image_transport::ImageTransport(node_handle_);
 		colorimage_sub_.subscribe(*it_, "colorimage_in", 1);
 		pointcloud_sub_.subscribe(node_handle_, "pointcloud_in", 1);
@@ -150,6 +236,13 @@ public:
 			delete it_;
 		if (sync_input_ != 0)
 			delete sync_input_;
+
+		edgeInput_.close();
+		normalInput_.close();
+		segmentationInput_.close();
+		classificationInput_.close();
+		visualizationInput_.close();
+		stages_.join_all();
 	}
 
 
@@ -172,55 +265,25 @@ public:
 
 		ROS_INFO("Input Callback");
 
-		struct switches
-		{
-			bool rec_mode;
-			bool comp_mode;
-
-			bool seg;
-			bool seg_without_edges;
-			bool seg_refine;
-			bool classify;
-
-			bool normal_vis;
-			bool seg_vis;
-			bool seg_without_edges_vis;
-			bool class_vis;
-
-		};
-
-		switches s;
-		s.rec_mode = RECORD_MODE;
-		s.comp_mode = COMPUTATION_MODE;
-		s.seg = SEG;
-		s.seg_without_edges = SEG_WITHOUT_EDGES;
-		s.seg_refine = SEG_REFINE;
-		s.classify = CLASSIFY;
-		s.normal_vis = NORMAL_VIS;
-		s.seg_vis = SEG_VIS;
-		s.seg_without_edges_vis= SEG_WITHOUT_EDGES_VIS;
-		s.class_vis = CLASS_VIS;
-
 		// convert color image to cv::Mat
-		cv_bridge::CvImageConstPtr color_image_ptr;
-		cv::Mat color_image;
-		convertColorImageMessageToMat(color_image_msg, color_image_ptr, color_image);
+		FramePtr frame(new Frame);
+		convertColorImageMessageToMat(color_image_msg, frame->color_image_ptr, frame->color_image);
 
-		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZRGB>);
-		pcl::fromROSMsg(*pointcloud_msg, *cloud);
+		frame->cloud.reset(new pcl::PointCloud<pcl::PointXYZRGB>);
+		pcl::fromROSMsg(*pointcloud_msg, *frame->cloud);
 
 
 		//record scene
 		//----------------------------------------
 		if(RECORD_MODE)
 		{
-			cv::imshow("image", color_image);
+			cv::imshow("image", frame->color_image);
 			int key = cv::waitKey(50);
 			std::cout <<key<<"\n";
 			//record if "r" is pressed while "image"-window is activated
 			if(key == 1048690)
 			{
-				rec_.saveImage(color_image,*cloud);
+				rec_.saveImage(frame->color_image,*frame->cloud);
 			}
 
 		}
@@ -229,36 +292,11 @@ public:
 
 		else if(COMPUTATION_MODE)
 		{
-
-
-
-
-
-			//visualization
-			//zeichne Fadenkreuz
-			int lineLength = 30;
-			cv::line(color_image,cv::Point2f(color_image.cols/2 -lineLength/2, color_image.rows/2),cv::Point2f(color_image.cols/2 +lineLength/2, color_image.rows/2),CV_RGB(0,1,0),1);
-			cv::line(color_image,cv::Point2f(color_image.cols/2 , color_image.rows/2 +lineLength/2),cv::Point2f(color_image.cols/2 , color_image.rows/2 -lineLength/2),CV_RGB(0,1,0),1);
-			cv::imshow("image", color_image);
-			cv::waitKey(10);
-
 			// get color image from point cloud
 			/*pcl::PointCloud<pcl::PointXYZRGB> point_cloud_src;
 		pcl::fromROSMsg(*pointcloud_msg, point_cloud_src);
 		pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr pc_ptr(&point_cloud_src);*/
 
-
-			pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
-			pcl::PointCloud<pcl::Normal>::Ptr normalsWithoutEdges(new pcl::PointCloud<pcl::Normal>);
-			pcl::PointCloud<PointLabel>::Ptr labels(new pcl::PointCloud<PointLabel>);
-			pcl::PointCloud<PointLabel>::Ptr labelsWithoutEdges(new pcl::PointCloud<PointLabel>);
-			ST::Graph::Ptr graph(new ST::Graph);
-			ST::Graph::Ptr graphWithoutEdges(new ST::Graph);
-
-
-
-
-
 			//		cv::Mat color_image = cv::Mat::zeros(point_cloud_src.height, point_cloud_src.width, CV_8UC3);
 			//		for (unsigned int v=0; v<point_cloud_src.height; v++)
 			//		{
@@ -270,28 +308,63 @@ public:
 			//			}
 			//		}
 
-			//compute depth_image: greyvalue represents depth z
-			cv::Mat depth_image = cv::Mat::zeros(cloud->height, cloud->width, CV_32FC1);
-			for (unsigned int v=0; v<cloud->height; v++)
-			{
-				for (unsigned int u=0; u<cloud->width; u++)
-				{
-					//bei Aufruf aus der Matrix ist der Index (Zeile,Spalte), also (y-Wert,x-Wert)!!!
-					pcl::PointXYZRGB point = cloud->at(u,v);
-					if(std::isnan(point.z) == false)
-						depth_image.at< float >(v,u) = point.z;
-				}
-			}
-
-			cv::imshow("depth_image", depth_image);
-			cv::waitKey(10);
+			frame->normals.reset(new pcl::PointCloud<pcl::Normal>);
+			frame->normalsWithoutEdges.reset(new pcl::PointCloud<pcl::Normal>);
+			frame->labels.reset(new pcl::PointCloud<PointLabel>);
+			frame->labelsWithoutEdges.reset(new pcl::PointCloud<PointLabel>);
+			frame->graph.reset(new ST::Graph);
+			frame->graphWithoutEdges.reset(new ST::Graph);
 
+			//the callback only hands the frame to the pipeline, it never waits for a slow stage
+			forward(edgeInput_, frame, "edge detection");
+		}
+	}//inputCallback()
 
 
+private:
 
+	// data of one frame on its way through the stages, only the stage holding the frame accesses it
+	struct Frame
+	{
+		cv_bridge::CvImageConstPtr color_image_ptr;
+		cv::Mat color_image;
+		pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud;
+		cv::Mat edgeImage;
+		pcl::PointCloud<pcl::Normal>::Ptr normals;
+		pcl::PointCloud<pcl::Normal>::Ptr normalsWithoutEdges;
+		pcl::PointCloud<PointLabel>::Ptr labels;
+		pcl::PointCloud<PointLabel>::Ptr labelsWithoutEdges;
+		ST::Graph::Ptr graph;
+		ST::Graph::Ptr graphWithoutEdges;
+	};
+	typedef boost::shared_ptr<Frame> FramePtr;
+
+	// passes a frame to the next stage, an older frame still waiting there is dropped
+	void forward(LatestFrameSlot<FramePtr>& slot, const FramePtr& frame, const char* stage)
+	{
+		if(slot.put(frame))
+			ROS_DEBUG("SurfaceClassificationNode: %s is busy, dropped the oldest frame", stage);
+	}
 
+	void edgeStage()
+	{
+		FramePtr frame;
+		while(edgeInput_.take(frame))
+		{
+			frame->edgeImage = cv::Mat::ones(frame->cloud->height,frame->cloud->width,CV_32FC1);
+			edge_detection_.computeDepthEdges(frame->cloud, frame->edgeImage);
+			//cv::imshow("edge_image", edgeImage);
+			//cv::waitKey(10);
 
+			forward(normalInput_, frame, "normal estimation");
+		}
+	}
 
+	void normalStage()
+	{
+		FramePtr frame;
+		while(normalInput_.take(frame))
+		{
 			/*
 
 		oneWithoutEdges_.setInputCloud(cloud);
@@ -300,34 +373,106 @@ public:
 		oneWithoutEdges_.setSkipDistantPointThreshold(8);	//PUnkte mit einem Abstand in der Tiefe von 8 werden nicht mehr zur Nachbarschaft gezählt
 		oneWithoutEdges_.compute(*normalsWithoutEdges);*/
 
-
-			cv::Mat edgeImage = cv::Mat::ones(depth_image.rows,depth_image.cols,CV_32FC1);
-			edge_detection_.computeDepthEdges( depth_image, cloud, edgeImage);
-			//cv::imshow("edge_image", edgeImage);
-			//cv::waitKey(10);
-
 			//Timer timer;
 			//timer.start();
 			//for(int i=0; i<10; i++)
 			//{
 
-
-
-			one_.setInputCloud(cloud);
+			one_.setInputCloud(frame->cloud);
 			one_.setPixelSearchRadius(8,1,1);	//call before calling computeMaskManually()!!!
-			one_.computeMaskManually_increasing(cloud->width);
-			one_.setEdgeImage(edgeImage);
-			one_.setOutputLabels(labels);
+			one_.computeMaskManually_increasing(frame->cloud->width);
+			one_.setEdgeImage(frame->edgeImage);
+			one_.setOutputLabels(frame->labels);
 			one_.setSameDirectionThres(0.94);
 			one_.setSkipDistantPointThreshold(8);	//PUnkte mit einem Abstand in der Tiefe von 8 werden nicht mehr zur Nachbarschaft gezählt
-			one_.compute(*normals);
+			one_.compute(*frame->normals);
 
 			//}timer.stop();
 			//std::cout << timer.getElapsedTimeInMilliSec() << " ms for normalEstimation on the whole image, averaged over 10 iterations\n";
 
+			forward(segmentationInput_, frame, "segmentation");
+		}
+	}
 
+	void segmentationStage()
+	{
+		FramePtr frame;
+		while(segmentationInput_.take(frame))
+		{
+			if(s_.seg)
+			{
+				seg_.setInputCloud(frame->cloud);
+				seg_.setNormalCloudIn(frame->normals);
+				seg_.setLabelCloudInOut(frame->labels);
+				seg_.setClusterGraphOut(frame->graph);
+				seg_.performInitialSegmentation();
+			}
+			if(s_.seg_without_edges)
+			{
+				segWithoutEdges_.setInputCloud(frame->cloud);
+				segWithoutEdges_.setNormalCloudIn(frame->normalsWithoutEdges);
+				segWithoutEdges_.setLabelCloudInOut(frame->labelsWithoutEdges);
+				segWithoutEdges_.setClusterGraphOut(frame->graphWithoutEdges);
+				segWithoutEdges_.performInitialSegmentation();
+			}
 
-			if(s.normal_vis)
+			if(s_.seg_refine)
+			{
+				//merge segments with similar curvature characteristics
+				segRefined_.setInputCloud(frame->cloud);
+				segRefined_.setClusterGraphInOut(frame->graph);
+				segRefined_.setLabelCloudInOut(frame->labels);
+				segRefined_.setNormalCloudIn(frame->normals);
+				//segRefined_.setCurvThres()
+				segRefined_.refineUsingCurvature();
+				//segRefined_.printCurvature(color_image);
+			}
+
+			forward(classificationInput_, frame, "classification");
+		}
+	}
+
+	void classificationStage()
+	{
+		FramePtr frame;
+		while(classificationInput_.take(frame))
+		{
+			if(s_.classify)
+			{
+				//classification
+
+				cc_.setClusterHandler(frame->graph->clusters());
+				cc_.setNormalCloudInOut(frame->normals);
+				cc_.setLabelCloudIn(frame->labels);
+				cc_.setPointCloudIn(frame->cloud);
+				cc_.setMaskSizeSmooth(14);
+				cc_.classify();
+			}
+
+			forward(visualizationInput_, frame, "visualization");
+		}
+	}
+
+	// all windows are shown by this thread, while a viewer is open the other stages go on and newer frames replace the waiting one,
+	// the viewers also return when the node shuts down (closed input), otherwise the destructor would wait for them
+	// (normals and segmentation are shown as they are at the end of the pipeline, i.e. after refinement and classification)
+	void visualizationStage()
+	{
+		FramePtr frame;
+		while(visualizationInput_.take(frame))
+		{
+			pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud = frame->cloud;
+			cv::Mat& color_image = frame->color_image;
+
+			//visualization
+			//zeichne Fadenkreuz
+			int lineLength = 30;
+			cv::line(color_image,cv::Point2f(color_image.cols/2 -lineLength/2, color_image.rows/2),cv::Point2f(color_image.cols/2 +lineLength/2, color_image.rows/2),CV_RGB(0,1,0),1);
+			cv::line(color_image,cv::Point2f(color_image.cols/2 , color_image.rows/2 +lineLength/2),cv::Point2f(color_image.cols/2 , color_image.rows/2 -lineLength/2),CV_RGB(0,1,0),1);
+			cv::imshow("image", color_image);
+			cv::waitKey(10);
+
+			if(s_.normal_vis)
 			{
 
 				// visualize normals
@@ -337,12 +482,12 @@ public:
 
 
 				viewerNormals.addPointCloud<pcl::PointXYZRGB> (cloud, rgbNormals, "cloud");
-				viewerNormals.addPointCloudNormals<pcl::PointXYZRGB,pcl::Normal>(cloud, normals,2,0.005,"normals");
+				viewerNormals.addPointCloudNormals<pcl::PointXYZRGB,pcl::Normal>(cloud, frame->normals,2,0.005,"normals");
 				viewerNormals.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 3, "cloud");
 				//viewer.addCoordinateSystem (1.0);
 				//viewer.initCameraParameters ();
 
-				while (!viewerNormals.wasStopped ())
+				while (!viewerNormals.wasStopped () && !visualizationInput_.closed())
 				{
 					viewerNormals.spinOnce();
 
@@ -350,28 +495,11 @@ public:
 				viewerNormals.removePointCloud("cloud");
 			}
 
-			if(s.seg)
-			{
-				seg_.setInputCloud(cloud);
-				seg_.setNormalCloudIn(normals);
-				seg_.setLabelCloudInOut(labels);
-				seg_.setClusterGraphOut(graph);
-				seg_.performInitialSegmentation();
-			}
-			if(s.seg_without_edges)
-			{
-				segWithoutEdges_.setInputCloud(cloud);
-				segWithoutEdges_.setNormalCloudIn(normalsWithoutEdges);
-				segWithoutEdges_.setLabelCloudInOut(labelsWithoutEdges);
-				segWithoutEdges_.setClusterGraphOut(graphWithoutEdges);
-				segWithoutEdges_.performInitialSegmentation();
-			}
-
-			if(s.seg_vis)
+			if(s_.seg_vis)
 			{
 				pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmented(new pcl::PointCloud<pcl::PointXYZRGB>);
 				*segmented = *cloud;
-				graph->clusters()->mapClusterColor(segmented);
+				frame->graph->clusters()->mapClusterColor(segmented);
 
 
 
@@ -381,7 +509,7 @@ public:
 				viewer.setBackgroundColor (0.0, 0.0, 0);
 				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgb(segmented);
 				viewer.addPointCloud<pcl::PointXYZRGB> (segmented,rgb,"seg");
-				while (!viewer.wasStopped ())
+				while (!viewer.wasStopped () && !visualizationInput_.closed())
 				{
 					viewer.spinOnce();
 
@@ -389,18 +517,18 @@ public:
 				}
 				viewer.removePointCloud("seg");
 			}
-			if(s.seg_without_edges_vis)
+			if(s_.seg_without_edges_vis)
 			{
 				pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmentedWithoutEdges(new pcl::PointCloud<pcl::PointXYZRGB>);
 				pcl::copyPointCloud<pcl::PointXYZRGB,pcl::PointXYZRGB>(*cloud, *segmentedWithoutEdges);
-				graphWithoutEdges->clusters()->mapClusterColor(segmentedWithoutEdges);
+				frame->graphWithoutEdges->clusters()->mapClusterColor(segmentedWithoutEdges);
 
 				pcl::visualization::PCLVisualizer viewerWithoutEdges("segmentationWithoutEdges");
 
 				viewerWithoutEdges.setBackgroundColor (0.0, 0.0, 0);
 				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbWithoutEdges(segmentedWithoutEdges);
 				viewerWithoutEdges.addPointCloud<pcl::PointXYZRGB> (segmentedWithoutEdges,rgbWithoutEdges,"segWithoutEdges");
-				while (!viewerWithoutEdges.wasStopped ())
+				while (!viewerWithoutEdges.wasStopped () && !visualizationInput_.closed())
 				{
 					viewerWithoutEdges.spinOnce();
 
@@ -411,22 +539,9 @@ public:
 
 
 
-			if(s.seg_refine)
-			{
-				//merge segments with similar curvature characteristics
-				segRefined_.setInputCloud(cloud);
-				segRefined_.setClusterGraphInOut(graph);
-				segRefined_.setLabelCloudInOut(labels);
-				segRefined_.setNormalCloudIn(normals);
-				//segRefined_.setCurvThres()
-				segRefined_.refineUsingCurvature();
-				//segRefined_.printCurvature(color_image);
-			}
-
-
 			/*	pcl::PointCloud<pcl::PointXYZRGB>::Ptr segmentedRef(new pcl::PointCloud<pcl::PointXYZRGB>);
 			 *segmentedRef = *cloud;
-		graph->clusters()->mapClusterColor(segmentedRef);
+		frame->graph->clusters()->mapClusterColor(segmentedRef);
 
 
 		// visualize segmentation
@@ -445,24 +560,13 @@ public:
 		viewer.removePointCloud("seg");*/
 
 
-			if(s.classify)
-			{
-				//classification
-
-				cc_.setClusterHandler(graph->clusters());
-				cc_.setNormalCloudInOut(normals);
-				cc_.setLabelCloudIn(labels);
-				cc_.setPointCloudIn(cloud);
-				cc_.setMaskSizeSmooth(14);
-				cc_.classify();
-			}
-			if(s.class_vis)
+			if(s_.class_vis)
 			{
 
 				pcl::PointCloud<pcl::PointXYZRGB>::Ptr classified(new pcl::PointCloud<pcl::PointXYZRGB>);
 				*classified = *cloud;
-				graph->clusters()->mapTypeColor(classified);
-				graph->clusters()->mapClusterBorders(classified);
+				frame->graph->clusters()->mapTypeColor(classified);
+				frame->graph->clusters()->mapClusterBorders(classified);
 
 				// visualize classification
 				pcl::visualization::PCLVisualizer viewerClass("classification");
@@ -470,7 +574,7 @@ public:
 				pcl::visualization::PointCloudColorHandlerRGBField<pcl::PointXYZRGB> rgbClass(classified);
 				viewerClass.addPointCloud<pcl::PointXYZRGB> (classified,rgbClass,"class");
 
-				while (!viewerClass.wasStopped ())
+				while (!viewerClass.wasStopped () && !visualizationInput_.closed())
 				{
 					viewerClass.spinOnce();
 
@@ -478,12 +582,9 @@ public:
 				}
 				viewerClass.removePointCloud("class");
 			}
+		}
+	}
 
-		}//if(comp_mode)
-	}//inputCallback()
-
-
-private:
 	ros::NodeHandle node_handle_;
 
 	// messages
@@ -510,6 +611,33 @@ private:
 
 	cob_3d_segmentation::ClusterClassifier<ST::CH, ST::Point, ST::Normal, ST::Label> cc_;
 
+	//switches for execution of processing steps
+	struct switches
+	{
+		bool rec_mode;
+		bool comp_mode;
+
+		bool seg;
+		bool seg_without_edges;
+		bool seg_refine;
+		bool classify;
+
+		bool normal_vis;
+		bool seg_vis;
+		bool seg_without_edges_vis;
+		bool class_vis;
+
+	};
+	switches s_;
+
+	//pipeline (computation mode): one thread per stage, each reading the frames from its single-slot input
+	boost::thread_group stages_;
+	LatestFrameSlot<FramePtr> edgeInput_;
+	LatestFrameSlot<FramePtr> normalInput_;
+	LatestFrameSlot<FramePtr> segmentationInput_;
+	LatestFrameSlot<FramePtr> classificationInput_;
+	LatestFrameSlot<FramePtr> visualizationInput_;
+
 };
 
 int main (int argc, char** argv)
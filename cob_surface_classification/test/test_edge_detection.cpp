@@ -0,0 +1,293 @@
+/*
+ * test_edge_detection.cpp
+ *
+ *  Checks that the depth edges computed in parallel bands of image rows are the same as with one thread
+ *  and that the closed-form and the integral line fits give the line of a SVD of the coordinates.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <cob_surface_classification/edge_detection.h>
+
+
+typedef pcl::PointCloud<pcl::PointXYZRGB> Cloud;
+
+//organized cloud of a pinhole camera: plane, depth step, bend in x- and y-direction and holes without data
+Cloud::Ptr syntheticCloud(int width, int height)
+{
+	Cloud::Ptr cloud(new Cloud);
+	cloud->width = width;
+	cloud->height = height;
+	cloud->is_dense = false;
+	cloud->points.resize(width*height);
+
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float focalLength = 525;
+	for(int v = 0; v < height; v++)
+	{
+		for(int u = 0; u < width; u++)
+		{
+			float z;
+			if(u < 60)
+				z = 1.0 + 0.002*u;			//inclined plane
+			else if(u < 110)
+				z = 1.5;					//step
+			else
+				z = 1.5 - 0.004*(u-110);	//bend
+			if(v >= 70)
+				z += 0.003*(v-70);			//bend in y-direction
+
+			pcl::PointXYZRGB& p = cloud->points[v*width + u];
+			p.x = (u - width/2) * z / focalLength;
+			p.y = (v - height/2) * z / focalLength;
+			p.z = z;
+
+			//holes: a block and scattered pixels
+			bool hole = (u >= 20 && u < 30 && v >= 30 && v < 40) || (u*7 + v*13) % 97 == 0;
+			if(hole)
+				p.x = p.y = p.z = nan;
+		}
+	}
+	return cloud;
+}
+
+//bit for bit comparison (NaN compares equal to itself)
+bool identical(const cv::Mat& a, const cv::Mat& b)
+{
+	if(a.size() != b.size() || a.type() != b.type())
+		return false;
+	for(int iY = 0; iY < a.rows; iY++)
+		if(std::memcmp(a.ptr(iY), b.ptr(iY), a.cols*a.elemSize()) != 0)
+			return false;
+	return true;
+}
+
+void compareBandsWithSerial(bool integralLineFit)
+{
+	Cloud::Ptr cloud = syntheticCloud(160, 120);
+
+	EdgeDetection<pcl::PointXYZRGB> serial;
+	serial.setIntegralLineFit(integralLineFit);
+	serial.setNumberThreads(1);
+	cv::Mat edgeImage = cv::Mat::ones(cloud->height, cloud->width, CV_32FC1);
+	cv::Mat serialX, serialY;
+	serial.computeDepthEdges(cloud, edgeImage, serialX, serialY);
+
+	//the test is only meaningful if the step is detected
+	ASSERT_GT(cv::countNonZero(serialX < 0.5), 0);
+
+	//band borders at different rows, including bands shorter than a line
+	const int numberThreads[] = {2, 3, 7, 64};
+	for(size_t i = 0; i < sizeof(numberThreads)/sizeof(numberThreads[0]); i++)
+	{
+		EdgeDetection<pcl::PointXYZRGB> bands;
+		bands.setIntegralLineFit(integralLineFit);
+		bands.setNumberThreads(numberThreads[i]);
+		cv::Mat bandsX, bandsY;
+		bands.computeDepthEdges(cloud, edgeImage, bandsX, bandsY);
+
+		EXPECT_TRUE(identical(serialX, bandsX)) << numberThreads[i] << " threads, x-direction";
+		EXPECT_TRUE(identical(serialY, bandsY)) << numberThreads[i] << " threads, y-direction";
+	}
+}
+
+TEST(EdgeDetection, BandsEqualSerial)
+{
+	compareBandsWithSerial(false);
+}
+
+TEST(EdgeDetection, BandsEqualSerialIntegralLineFit)
+{
+	compareBandsWithSerial(true);
+}
+
+//access to the line fits of EdgeDetection (friend)
+class EdgeDetectionLineFitTest : public testing::Test
+{
+protected:
+	typedef EdgeDetection<pcl::PointXYZRGB> Detection;
+
+	static void closedFormLine(const float* w, const float* z, int count, float* abc)
+	{
+		Detection detection;
+		detection.approximateLine(w, z, count, abc);
+	}
+
+	//line through the points of a row between the columns from and to (in this order), like computeDepthEdgesBand():
+	//integral fit from the running sums and the coordinates collected by coordinatesLine()
+	static void integralLine(const Cloud& cloud, int row, int from, int to, float* abc, bool& step)
+	{
+		Detection detection;
+		Detection::CloudView view(cloud);
+		Detection::LineSums sums;
+		detection.computeLineSums(view, row, sums);
+		detection.approximateLine(sums, std::min(from, to), std::max(from, to), from > to, abc, step);
+	}
+	static int coordinatesLine(const Cloud& cloud, int row, int from, int to, float* w, float* z, bool& step)
+	{
+		Detection detection;
+		Detection::CloudView view(cloud);
+		return detection.coordinatesLine(view, cv::Point2f(from, row), cv::Point2f(to, row), w, z, step);
+	}
+};
+
+//line of the former implementation: last right singular vector of the coordinates matrix [w z 1],
+//smallestSingularValues: the two smallest singular values (residual of the best line and gap to the next one)
+void svdLine(const float* w, const float* z, int count, float* abc, float* smallestSingularValues)
+{
+	cv::Mat coordinates(count, 3, CV_32FC1);
+	for(int i=0; i<count; i++)
+	{
+		coordinates.at<float>(i,0) = w[i];
+		coordinates.at<float>(i,1) = z[i];
+		coordinates.at<float>(i,2) = 1;
+	}
+	cv::Mat sv, u, vt;
+	cv::SVD::compute(coordinates, sv, u, vt, cv::SVD::MODIFY_A);
+	for(int i=0; i<3; i++)
+		abc[i] = vt.at<float>(2,i);
+	smallestSingularValues[0] = sv.at<float>(2);
+	smallestSingularValues[1] = sv.at<float>(1);
+}
+
+//abc is a best line of the coordinates like the SVD line:
+//unit length, residual |[w z 1]*abc| of the smallest singular value and, if the best line is unique, the same line up to the sign
+void expectSvdLine(const float* w, const float* z, int count, const float* abc, float tolerance)
+{
+	float svdAbc[3], sv[2];
+	svdLine(w, z, count, svdAbc, sv);
+
+	double norm = std::sqrt((double)abc[0]*abc[0] + (double)abc[1]*abc[1] + (double)abc[2]*abc[2]);
+	EXPECT_NEAR(1, norm, 1e-5);
+
+	double residual = 0;
+	for(int i=0; i<count; i++)
+	{
+		double d = (double)abc[0]*w[i] + (double)abc[1]*z[i] + abc[2];
+		residual += d*d;
+	}
+	EXPECT_LE(std::sqrt(residual), sv[0] + tolerance*(1 + sv[1]));
+
+	if(sv[1] - sv[0] > 0.01*sv[1])
+	{
+		double dot = (double)abc[0]*svdAbc[0] + (double)abc[1]*svdAbc[1] + (double)abc[2]*svdAbc[2];
+		EXPECT_NEAR(1, std::abs(dot), tolerance);
+	}
+}
+
+TEST_F(EdgeDetectionLineFitTest, ClosedFormEqualsSvdRandom)
+{
+	cv::RNG rng(12345);
+	float w[20], z[20], abc[3];
+	for(int trial = 0; trial < 1000; trial++)
+	{
+		//depth along a line of up to 10 cm with noise of a few mm, like the lines of the edge detection
+		int count = rng.uniform(3, 21);
+		double slope = rng.uniform(-2.0, 2.0), offset = rng.uniform(0.5, 3.0), noise = rng.uniform(0.0, 0.005);
+		for(int i=0; i<count; i++)
+		{
+			w[i] = rng.uniform(-0.1, 0.1);
+			z[i] = offset + slope*w[i] + rng.uniform(-noise, noise);
+		}
+		closedFormLine(w, z, count, abc);
+		expectSvdLine(w, z, count, abc, 1e-4);
+	}
+}
+
+TEST_F(EdgeDetectionLineFitTest, ClosedFormEqualsSvdDegenerate)
+{
+	float abc[3];
+
+	//collinear points
+	float wLine[] = {0, 0.002, 0.004, 0.006, 0.008, 0.010, 0.012};
+	float zLine[] = {1.0, 1.001, 1.002, 1.003, 1.004, 1.005, 1.006};
+	closedFormLine(wLine, zLine, 7, abc);
+	expectSvdLine(wLine, zLine, 7, abc, 1e-4);
+
+	//flat depth
+	float zFlat[] = {1.5, 1.5, 1.5, 1.5, 1.5, 1.5, 1.5};
+	closedFormLine(wLine, zFlat, 7, abc);
+	expectSvdLine(wLine, zFlat, 7, abc, 1e-4);
+
+	//two points, each repeated
+	float wTwo[] = {0, 0, 0.01, 0.01};
+	float zTwo[] = {2.0, 2.0, 2.02, 2.02};
+	closedFormLine(wTwo, zTwo, 4, abc);
+	expectSvdLine(wTwo, zTwo, 4, abc, 1e-4);
+
+	//same w, different depth (line along the depth axis)
+	float wSame[] = {0, 0, 0, 0};
+	float zSame[] = {1.0, 1.1, 1.2, 1.3};
+	closedFormLine(wSame, zSame, 4, abc);
+	expectSvdLine(wSame, zSame, 4, abc, 1e-4);
+
+	//one point repeated: the best line is not unique, only the residual can be compared
+	float wPoint[] = {0, 0, 0, 0, 0};
+	float zPoint[] = {1.2, 1.2, 1.2, 1.2, 1.2};
+	closedFormLine(wPoint, zPoint, 5, abc);
+	expectSvdLine(wPoint, zPoint, 5, abc, 1e-4);
+}
+
+TEST_F(EdgeDetectionLineFitTest, IntegralEqualsSvd)
+{
+	//rows of random depth with steps and holes
+	const int width = 120, height = 8, halfLength = 10;
+	cv::RNG rng(54321);
+	Cloud cloud;
+	cloud.width = width;
+	cloud.height = height;
+	cloud.points.resize(width*height);
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	for(int v = 0; v < height; v++)
+	{
+		double z = rng.uniform(0.5, 3.0), slope = rng.uniform(-0.01, 0.01);
+		for(int u = 0; u < width; u++)
+		{
+			if(rng.uniform(0, 30) == 0)
+				z += rng.uniform(-0.3, 0.3);	//step
+			if(v == height-1)
+				slope = 0;						//flat depth
+			z += slope + rng.uniform(-0.001, 0.001)*(v != height-1);
+			pcl::PointXYZRGB& p = cloud.points[v*width + u];
+			p.x = (u - width/2) * z / 525;
+			p.y = (v - height/2) * z / 525;
+			p.z = z;
+			if(rng.uniform(0, 8) == 0)
+				p.x = p.y = p.z = nan;
+		}
+	}
+
+	float w[halfLength], z[halfLength], abc[3];
+	for(int v = 0; v < height; v++)
+	{
+		for(int u = halfLength; u < width-halfLength; u++)
+		{
+			//left line (origin at the central point) and right line, like in computeDepthEdgesBand()
+			int froms[2] = {u-1, u+1};
+			int tos[2] = {u-halfLength, u+halfLength};
+			for(int side = 0; side < 2; side++)
+			{
+				bool integralStep = false, step = false;
+				integralLine(cloud, v, froms[side], tos[side], abc, integralStep);
+				int count = coordinatesLine(cloud, v, froms[side], tos[side], w, z, step);
+				EXPECT_EQ(step, integralStep) << "row " << v << ", column " << u;
+				if(count < 3)
+				{
+					EXPECT_TRUE(abc[0] == 0 && abc[1] == 0 && abc[2] == 0);
+					continue;
+				}
+				expectSvdLine(w, z, count, abc, 1e-3);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}